@@ -0,0 +1,358 @@
+#include "city_generator.h"
+
+#include "geo.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace transport_catalogue::benchmark {
+
+namespace {
+
+// Прямоугольник координат, в котором размещаются остановки
+constexpr double MIN_LATITUDE = 55.5;
+constexpr double MAX_LATITUDE = 56.0;
+constexpr double MIN_LONGITUDE = 37.3;
+constexpr double MAX_LONGITUDE = 37.9;
+// Среднее число остановок в ячейке сетки, по которой выбираются соседние остановки
+constexpr double STOPS_PER_CELL = 4;
+// Попыток найти соседнюю остановку, отличную от текущей, прежде чем взять случайную
+constexpr int NEIGHBOUR_ATTEMPTS = 8;
+// Дорожное расстояние больше расстояния по прямой в [MIN_ROAD_FACTOR, MAX_ROAD_FACTOR) раз
+constexpr double MIN_ROAD_FACTOR = 1.1;
+constexpr double MAX_ROAD_FACTOR = 1.5;
+constexpr int MAX_TILE_ZOOM = 3;
+
+// splitmix64: в отличие от распределений стандартной библиотеки, последовательность одинакова на всех платформах
+class Random {
+public:
+    explicit Random(uint64_t seed)
+        : state_(seed) {}
+
+    uint64_t Next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Равномерно в [0, count); count > 0
+    size_t Uniform(size_t count) {
+        return static_cast<size_t>(Next() % count);
+    }
+
+    // Равномерно в [min, max]
+    size_t Uniform(size_t min, size_t max) {
+        return min + Uniform(max - min + 1);
+    }
+
+    // Равномерно в [0, 1)
+    double Real() {
+        return static_cast<double>(Next() >> 11) * 0x1.0p-53;
+    }
+
+    double Real(double min, double max) {
+        return min + (max - min) * Real();
+    }
+
+private:
+    uint64_t state_;
+};
+
+string GetStopName(size_t index) {
+    return "Stop "s + to_string(index);
+}
+
+string GetBusName(size_t index) {
+    return "Bus "s + to_string(index);
+}
+
+// Равномерная сетка над прямоугольником координат; в ячейке хранятся номера попавших в неё остановок
+class StopGrid {
+public:
+    explicit StopGrid(const vector<geo::Coordinates>& stops)
+        : side_(max<size_t>(1, static_cast<size_t>(sqrt(static_cast<double>(stops.size()) / STOPS_PER_CELL))))
+        , cells_(side_ * side_) {
+        for (size_t i = 0; i < stops.size(); ++i) {
+            const auto [row, col] = GetCell(stops[i]);
+            cells_[row * side_ + col].push_back(i);
+        }
+    }
+
+    // Случайная остановка из ячейки pos или соседних с ней; nullopt, если там нет остановок
+    optional<size_t> GetNeighbour(geo::Coordinates pos, Random& random) const {
+        const auto [row, col] = GetCell(pos);
+        const size_t row_begin = row > 0 ? row - 1 : 0;
+        const size_t col_begin = col > 0 ? col - 1 : 0;
+        const size_t row_end = min(side_, row + 2);
+        const size_t col_end = min(side_, col + 2);
+
+        size_t count = 0;
+        for (size_t r = row_begin; r < row_end; ++r) {
+            for (size_t c = col_begin; c < col_end; ++c) {
+                count += cells_[r * side_ + c].size();
+            }
+        }
+        if (count == 0) {
+            return nullopt;
+        }
+        size_t choice = random.Uniform(count);
+        for (size_t r = row_begin; r < row_end; ++r) {
+            for (size_t c = col_begin; c < col_end; ++c) {
+                const auto& cell = cells_[r * side_ + c];
+                if (choice < cell.size()) {
+                    return cell[choice];
+                }
+                choice -= cell.size();
+            }
+        }
+        return nullopt;
+    }
+
+private:
+    pair<size_t, size_t> GetCell(geo::Coordinates pos) const {
+        const auto to_cell = [this](double value, double min, double max) {
+            const double cell = floor((value - min) / (max - min) * static_cast<double>(side_));
+            return static_cast<size_t>(clamp(cell, 0., static_cast<double>(side_ - 1)));
+        };
+        return {to_cell(pos.lat, MIN_LATITUDE, MAX_LATITUDE), to_cell(pos.lng, MIN_LONGITUDE, MAX_LONGITUDE)};
+    }
+
+    size_t side_;
+    vector<vector<size_t>> cells_;
+};
+
+struct City {
+    vector<geo::Coordinates> stops;
+    // Дорожные расстояния от каждой остановки: номер соседней остановки и расстояние в метрах
+    vector<vector<pair<size_t, int>>> distances;
+    vector<vector<size_t>> routes;
+    vector<bool> is_roundtrip;
+};
+
+City BuildCity(const CityConfig& config, Random& random) {
+    City city;
+    city.stops.reserve(config.stops);
+    for (size_t i = 0; i < config.stops; ++i) {
+        city.stops.push_back({random.Real(MIN_LATITUDE, MAX_LATITUDE), random.Real(MIN_LONGITUDE, MAX_LONGITUDE)});
+    }
+    city.distances.resize(config.stops);
+    const StopGrid grid(city.stops);
+
+    unordered_map<uint64_t, int> distances;
+    const auto add_distance = [&](size_t from, size_t to) {
+        const uint64_t key = static_cast<uint64_t>(from) * config.stops + to;
+        if (distances.count(key) > 0) {
+            return;
+        }
+        const double straight = geo::ComputeDistance(city.stops[from], city.stops[to]);
+        const int road = max(1, static_cast<int>(lround(straight * random.Real(MIN_ROAD_FACTOR, MAX_ROAD_FACTOR))));
+        distances.emplace(key, road);
+        city.distances[from].emplace_back(to, road);
+    };
+
+    for (size_t bus = 0; bus < config.buses; ++bus) {
+        auto& route = city.routes.emplace_back();
+        const size_t length = random.Uniform(config.min_route_stops, config.max_route_stops);
+        route.push_back(random.Uniform(config.stops));
+        while (route.size() < length) {
+            const size_t current = route.back();
+            optional<size_t> next;
+            for (int attempt = 0; attempt < NEIGHBOUR_ATTEMPTS && (!next || *next == current); ++attempt) {
+                next = grid.GetNeighbour(city.stops[current], random);
+            }
+            if (!next || *next == current) {
+                if (config.stops == 1) {
+                    // Сеть из одной остановки: маршрут из неё одной
+                    break;
+                }
+                next = (current + 1 + random.Uniform(config.stops - 1)) % config.stops;
+            }
+            add_distance(current, *next);
+            route.push_back(*next);
+        }
+
+        const bool roundtrip = random.Real() < config.roundtrip_ratio;
+        if (roundtrip && route.size() > 1) {
+            add_distance(route.back(), route.front());
+            route.push_back(route.front());
+        }
+        city.is_roundtrip.push_back(roundtrip);
+    }
+
+    for (auto& stop_distances : city.distances) {
+        sort(stop_distances.begin(), stop_distances.end());
+    }
+    return city;
+}
+
+void WriteBaseRequests(const City& city, json::Writer& writer) {
+    writer.Key("base_requests").StartArray();
+    for (size_t i = 0; i < city.stops.size(); ++i) {
+        writer.StartDict()
+                .Key("latitude").Value(city.stops[i].lat)
+                .Key("longitude").Value(city.stops[i].lng)
+                .Key("name").Value(GetStopName(i));
+        // Названия соседних остановок сортируются как строки, чтобы ключи словаря шли по порядку
+        vector<pair<string, int>> road_distances;
+        for (const auto& [to, distance] : city.distances[i]) {
+            road_distances.emplace_back(GetStopName(to), distance);
+        }
+        sort(road_distances.begin(), road_distances.end());
+        writer.Key("road_distances").StartDict();
+        for (const auto& [name, distance] : road_distances) {
+            writer.Key(name).Value(distance);
+        }
+        writer.EndDict()
+                .Key("type").Value("Stop"sv)
+            .EndDict();
+    }
+    for (size_t i = 0; i < city.routes.size(); ++i) {
+        writer.StartDict()
+                .Key("is_roundtrip").Value(static_cast<bool>(city.is_roundtrip[i]))
+                .Key("name").Value(GetBusName(i));
+        writer.Key("stops").StartArray();
+        for (const size_t stop : city.routes[i]) {
+            writer.Value(GetStopName(stop));
+        }
+        writer.EndArray()
+                .Key("type").Value("Bus"sv)
+            .EndDict();
+    }
+    writer.EndArray();
+}
+
+void WriteRenderSettings(json::Writer& writer) {
+    writer.Key("render_settings").StartDict()
+            .Key("bus_label_font_size").Value(20)
+            .Key("bus_label_offset").StartArray().Value(7.).Value(15.).EndArray()
+            .Key("color_palette").StartArray()
+                .Value("green"sv)
+                .StartArray().Value(255).Value(160).Value(0).EndArray()
+                .Value("red"sv)
+                .StartArray().Value(10).Value(20).Value(30).Value(0.5).EndArray()
+            .EndArray()
+            .Key("height").Value(1200.)
+            .Key("line_width").Value(14.)
+            .Key("padding").Value(50.)
+            .Key("stop_label_font_size").Value(20)
+            .Key("stop_label_offset").StartArray().Value(7.).Value(-3.).EndArray()
+            .Key("stop_radius").Value(5.)
+            .Key("underlayer_color").StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray()
+            .Key("underlayer_width").Value(3.)
+            .Key("width").Value(1200.)
+        .EndDict();
+}
+
+void WriteRoutingSettings(json::Writer& writer) {
+    writer.Key("routing_settings").StartDict()
+            .Key("bus_velocity").Value(40)
+            .Key("bus_wait_time").Value(6)
+        .EndDict();
+}
+
+// Название существующей остановки или маршрута либо, с вероятностью not_found, несуществующее
+string PickName(size_t count, double not_found, string (*get_name)(size_t), Random& random) {
+    if (count == 0 || random.Real() < not_found) {
+        return "Missing "s + to_string(random.Uniform(1000));
+    }
+    return get_name(random.Uniform(count));
+}
+
+void WriteStatRequests(const CityConfig& config, json::Writer& writer, Random& random) {
+    const RequestMix& mix = config.mix;
+    const double weights[] = {mix.stop, mix.bus, mix.route, mix.map, mix.map_tile};
+    double total_weight = 0;
+    for (const double weight : weights) {
+        if (weight < 0) {
+            throw invalid_argument("Request mix weights must not be negative");
+        }
+        total_weight += weight;
+    }
+    if (config.stat_requests > 0 && total_weight <= 0) {
+        throw invalid_argument("Request mix is empty");
+    }
+
+    writer.Key("stat_requests").StartArray();
+    for (size_t i = 0; i < config.stat_requests; ++i) {
+        const int id = static_cast<int>(i + 1);
+        double choice = random.Real() * total_weight;
+        size_t type = 0;
+        while (type + 1 < size(weights) && (weights[type] == 0 || choice >= weights[type])) {
+            choice -= weights[type];
+            ++type;
+        }
+
+        writer.StartDict();
+        switch (type) {
+        case 0:
+            writer.Key("id").Value(id)
+                .Key("name").Value(PickName(config.stops, mix.not_found, GetStopName, random))
+                .Key("type").Value("Stop"sv);
+            break;
+        case 1:
+            writer.Key("id").Value(id)
+                .Key("name").Value(PickName(config.buses, mix.not_found, GetBusName, random))
+                .Key("type").Value("Bus"sv);
+            break;
+        case 2:
+            writer.Key("from").Value(PickName(config.stops, 0, GetStopName, random))
+                .Key("id").Value(id)
+                .Key("to").Value(PickName(config.stops, 0, GetStopName, random))
+                .Key("type").Value("Route"sv);
+            break;
+        case 3:
+            writer.Key("id").Value(id)
+                .Key("type").Value("Map"sv);
+            break;
+        default: {
+            const int zoom = static_cast<int>(random.Uniform(0, MAX_TILE_ZOOM));
+            const size_t tiles = size_t{1} << zoom;
+            writer.Key("id").Value(id)
+                .Key("type").Value("MapTile"sv)
+                .Key("x").Value(static_cast<int>(random.Uniform(tiles)))
+                .Key("y").Value(static_cast<int>(random.Uniform(tiles)))
+                .Key("zoom").Value(zoom);
+            break;
+        }
+        }
+        writer.EndDict();
+    }
+    writer.EndArray();
+}
+
+}  // namespace
+
+string GenerateCity(const CityConfig& config, const json::PrintSettings& print_settings) {
+    if (config.min_route_stops == 0 || config.min_route_stops > config.max_route_stops) {
+        throw invalid_argument("Invalid route length range");
+    }
+    if (config.buses > 0 && config.stops == 0) {
+        throw invalid_argument("Buses require at least one stop");
+    }
+
+    Random random(config.seed);
+    const City city = BuildCity(config, random);
+
+    json::OutputBuffer buffer;
+    json::Writer writer(buffer, print_settings);
+    writer.StartDict();
+    WriteBaseRequests(city, writer);
+    WriteRenderSettings(writer);
+    WriteRoutingSettings(writer);
+    WriteStatRequests(config, writer, random);
+    writer.EndDict();
+    return buffer.Release();
+}
+
+}  // namespace transport_catalogue::benchmark
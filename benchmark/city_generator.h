@@ -0,0 +1,44 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace transport_catalogue::benchmark {
+
+/*
+ * Генератор синтетических входных данных: случайная сеть остановок в прямоугольнике
+ * координат и маршруты, которые переходят между соседними остановками, как в настоящем городе.
+ * Результат определяется только параметрами и seed и не зависит от платформы и стандартной библиотеки
+ */
+
+// Относительные доли типов запросов в stat_requests; нулевая доля исключает тип
+struct RequestMix {
+    double stop = 25;
+    double bus = 30;
+    double route = 44;
+    double map = 0;
+    double map_tile = 1;
+    // Доля запросов Stop и Bus с несуществующим названием, от 0 до 1
+    double not_found = 0.05;
+};
+
+struct CityConfig {
+    size_t stops = 1000;
+    size_t buses = 200;
+    // Число остановок маршрута без учёта обратного пути
+    size_t min_route_stops = 5;
+    size_t max_route_stops = 25;
+    // Доля кольцевых маршрутов, от 0 до 1
+    double roundtrip_ratio = 0.5;
+    size_t stat_requests = 1000;
+    RequestMix mix;
+    uint64_t seed = 1;
+};
+
+// Входной документ в формате программы: base_requests, render_settings, routing_settings, stat_requests
+std::string GenerateCity(const CityConfig& config, const json::PrintSettings& print_settings = {});
+
+}  // namespace transport_catalogue::benchmark
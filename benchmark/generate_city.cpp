@@ -0,0 +1,130 @@
+/*
+ * Выводит в stdout синтетический входной документ для transport-catalogue.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -I transport-catalogue -o generate_city benchmark/generate_city.cpp \
+ *       benchmark/city_generator.cpp transport-catalogue/json.cpp transport-catalogue/json_writer.cpp \
+ *       transport-catalogue/geo.cpp
+ * Пример: ./generate_city --stops 10000 --buses 2000 --stat-requests 50000 --mix stop=1,bus=1,route=2 > city.json
+ */
+
+#include "city_generator.h"
+
+#include <charconv>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace transport_catalogue;
+
+namespace {
+
+template <typename Value>
+optional<Value> ParseNumber(string_view arg) {
+    Value value{};
+    const auto [ptr, ec] = from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (ec != errc{} || ptr != arg.data() + arg.size()) {
+        return nullopt;
+    }
+    return value;
+}
+
+// Разбирает доли вида stop=25,bus=30,route=40,map=0,tile=5,missing=0.05; не упомянутые типы получают долю 0
+optional<benchmark::RequestMix> ParseMix(string_view arg) {
+    benchmark::RequestMix mix{0, 0, 0, 0, 0, 0};
+    while (!arg.empty()) {
+        const size_t comma = arg.find(',');
+        const string_view item = arg.substr(0, comma);
+        arg = comma == string_view::npos ? string_view{} : arg.substr(comma + 1);
+
+        const size_t eq = item.find('=');
+        if (eq == string_view::npos) {
+            return nullopt;
+        }
+        const string_view name = item.substr(0, eq);
+        const auto value = ParseNumber<double>(item.substr(eq + 1));
+        if (!value || *value < 0) {
+            return nullopt;
+        }
+        if (name == "stop"sv) {
+            mix.stop = *value;
+        } else if (name == "bus"sv) {
+            mix.bus = *value;
+        } else if (name == "route"sv) {
+            mix.route = *value;
+        } else if (name == "map"sv) {
+            mix.map = *value;
+        } else if (name == "tile"sv) {
+            mix.map_tile = *value;
+        } else if (name == "missing"sv) {
+            mix.not_found = *value;
+        } else {
+            return nullopt;
+        }
+    }
+    return mix;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    benchmark::CityConfig config;
+    json::PrintSettings print_settings;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        bool valid = true;
+        if (arg == "--compact"sv) {
+            print_settings.compact = true;
+        } else if (!has_value) {
+            valid = false;
+        } else if (arg == "--stops"sv) {
+            const auto value = ParseNumber<size_t>(argv[++i]);
+            valid = value.has_value();
+            config.stops = value.value_or(0);
+        } else if (arg == "--buses"sv) {
+            const auto value = ParseNumber<size_t>(argv[++i]);
+            valid = value.has_value();
+            config.buses = value.value_or(0);
+        } else if (arg == "--min-route-stops"sv) {
+            const auto value = ParseNumber<size_t>(argv[++i]);
+            valid = value.has_value();
+            config.min_route_stops = value.value_or(0);
+        } else if (arg == "--max-route-stops"sv) {
+            const auto value = ParseNumber<size_t>(argv[++i]);
+            valid = value.has_value();
+            config.max_route_stops = value.value_or(0);
+        } else if (arg == "--roundtrip-ratio"sv) {
+            const auto value = ParseNumber<double>(argv[++i]);
+            valid = value.has_value();
+            config.roundtrip_ratio = value.value_or(0);
+        } else if (arg == "--stat-requests"sv) {
+            const auto value = ParseNumber<size_t>(argv[++i]);
+            valid = value.has_value();
+            config.stat_requests = value.value_or(0);
+        } else if (arg == "--mix"sv) {
+            const auto value = ParseMix(argv[++i]);
+            valid = value.has_value();
+            config.mix = value.value_or(benchmark::RequestMix{});
+        } else if (arg == "--seed"sv) {
+            const auto value = ParseNumber<uint64_t>(argv[++i]);
+            valid = value.has_value();
+            config.seed = value.value_or(0);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            cerr << "Invalid argument: "s << arg << endl;
+            return 1;
+        }
+    }
+
+    try {
+        cout << benchmark::GenerateCity(config, print_settings);
+    } catch (const exception& e) {
+        cerr << "Exception: "s << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * Замеряет время этапов обработки на синтетических городах разного размера.
+ * Каждый замер выводится отдельной строкой JSON, чтобы результаты версий можно было сравнивать скриптом.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o pipeline_benchmark benchmark/pipeline_benchmark.cpp \
+ *       benchmark/city_generator.cpp $(find transport-catalogue -name '*.cpp' ! -name main.cpp)
+ * Пример: ./pipeline_benchmark --sizes 100,1000,10000 --threads 1,2,4 --runs 5 > results.jsonl
+ */
+
+#include "city_generator.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace transport_catalogue;
+
+namespace {
+
+struct BenchmarkConfig {
+    vector<size_t> sizes = {100, 1000, 10000, 100000};
+    vector<unsigned> threads = {1, 2, 4, 8};
+    // Число маршрутов на одну остановку
+    double buses_per_stop = 0.2;
+    size_t stat_requests = 10000;
+    size_t runs = 3;
+    // Способ поиска маршрутов выбирается по размеру сети и числу запросов Route, но и с лучшим из них
+    // тысячи запросов к городу из 10000 остановок обрабатываются минуту. Для больших городов этап
+    // пропускается, а из stat_requests исключаются запросы Route
+    size_t router_max_stops = 3000;
+    uint64_t seed = 1;
+};
+
+// Параметры замера, общие для всех этапов одного города
+struct CaseInfo {
+    size_t stops = 0;
+    size_t buses = 0;
+    size_t stat_requests = 0;
+    bool route_requests = false;
+    uint64_t seed = 0;
+};
+
+struct Measurement {
+    vector<double> times_ms;
+    // Объём входных или выходных данных этапа, если он имеет смысл
+    size_t bytes = 0;
+};
+
+// Выполняет prepare и body runs раз; в замер попадает только время body, которое возвращает объём данных
+Measurement Measure(size_t runs, const function<void()>& prepare, const function<size_t()>& body) {
+    Measurement result;
+    for (size_t run = 0; run < runs; ++run) {
+        prepare();
+        const auto start = chrono::steady_clock::now();
+        result.bytes = body();
+        const auto finish = chrono::steady_clock::now();
+        result.times_ms.push_back(chrono::duration<double, milli>(finish - start).count());
+    }
+    return result;
+}
+
+// Поток, который отбрасывает данные и только считает их объём: ответы на крупные запросы карты
+// не помещаются в память целиком
+class CountingBuffer : public streambuf {
+public:
+    size_t GetSize() const {
+        return size_;
+    }
+
+protected:
+    streamsize xsputn(const char*, streamsize count) override {
+        size_ += static_cast<size_t>(count);
+        return count;
+    }
+
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            ++size_;
+        }
+        return traits_type::not_eof(c);
+    }
+
+private:
+    size_t size_ = 0;
+};
+
+class ResultWriter {
+public:
+    explicit ResultWriter(ostream& out)
+        : out_(out) {}
+
+    void Write(const CaseInfo& info, string_view stage, unsigned threads, const Measurement& measurement) {
+        vector<double> times = measurement.times_ms;
+        sort(times.begin(), times.end());
+        Write(info, stage, threads, [&](json::Writer& writer) {
+            writer.Key("best_ms").Value(times.front());
+            writer.Key("bytes").Value(static_cast<double>(measurement.bytes));
+            writer.Key("median_ms").Value(times[times.size() / 2]);
+            writer.Key("runs").Value(static_cast<int>(times.size()));
+        });
+    }
+
+    void WriteSkipped(const CaseInfo& info, string_view stage, string_view reason) {
+        Write(info, stage, 1, [&](json::Writer& writer) {
+            writer.Key("skipped").Value(reason);
+        });
+    }
+
+private:
+    // Ключи записи выводятся в лексикографическом порядке
+    void Write(const CaseInfo& info, string_view stage, unsigned threads,
+               const function<void(json::Writer&)>& write_result) {
+        json::OutputBuffer buffer;
+        json::Writer writer(buffer, json::PrintSettings{10, true});
+        writer.StartDict();
+        writer.Key("buses").Value(static_cast<int>(info.buses));
+        writer.Key("hardware_threads").Value(static_cast<int>(thread::hardware_concurrency()));
+        writer.Key("route_requests").Value(info.route_requests);
+        write_result(writer);
+        writer.Key("seed").Value(static_cast<double>(info.seed));
+        writer.Key("stage").Value(stage);
+        writer.Key("stat_requests").Value(static_cast<int>(info.stat_requests));
+        writer.Key("stops").Value(static_cast<int>(info.stops));
+        writer.Key("threads").Value(static_cast<int>(threads));
+        writer.EndDict();
+        out_ << buffer.View() << endl;
+    }
+
+    ostream& out_;
+};
+
+void RunCase(const BenchmarkConfig& config, size_t stops, ResultWriter& results) {
+    benchmark::CityConfig city;
+    city.stops = stops;
+    city.buses = max<size_t>(1, static_cast<size_t>(static_cast<double>(stops) * config.buses_per_stop));
+    city.stat_requests = config.stat_requests;
+    city.seed = config.seed;
+    const bool build_router = stops <= config.router_max_stops;
+    if (!build_router) {
+        city.mix.route = 0;
+    }
+    const string text = benchmark::GenerateCity(city, json::PrintSettings{10, true});
+
+    const CaseInfo info{city.stops, city.buses, city.stat_requests, build_router, city.seed};
+
+    // Массивы base_requests и stat_requests длиннее parallel_min_bytes разбираются в threads потоков
+    string input;
+    optional<json::Document> parsed;
+    for (const unsigned threads : config.threads) {
+        json::ParseSettings parse_settings;
+        parse_settings.threads = threads;
+        results.Write(info, "parse"sv, threads, Measure(config.runs, [&] {
+            parsed.reset();
+            input = text;
+        }, [&] {
+            parsed = json::LoadBuffer(move(input), parse_settings);
+            return text.size();
+        }));
+    }
+    const json::Document& doc = *parsed;
+
+    optional<database::TransportCatalogue> catalogue;
+    results.Write(info, "base_requests"sv, 1, Measure(config.runs, [&] {
+        catalogue.reset();
+        catalogue.emplace();
+    }, [&] {
+        processing::JsonReader(*catalogue).ProcessBaseRequests(doc);
+        return size_t{0};
+    }));
+
+    processing::JsonReader settings_reader(*catalogue);
+    const map_renderer::RenderSettings render_settings = settings_reader.ProcessRenderSettings(doc);
+    const routing::RoutingSettings routing_settings = settings_reader.ProcessRouterSettings(doc);
+    const routing::RoutingLoad routing_load = settings_reader.ProcessRoutingLoad(doc);
+
+    // Без запросов Route маршрутизатору достаточно пустого справочника
+    database::TransportCatalogue empty_catalogue;
+    optional<routing::Router> router;
+    if (build_router) {
+        results.Write(info, "router_build"sv, 1, Measure(config.runs, [&] {
+            router.reset();
+        }, [&] {
+            router.emplace(routing_settings, *catalogue, routing_load);
+            return size_t{0};
+        }));
+    } else {
+        results.WriteSkipped(info, "router_build"sv, "router_max_stops"sv);
+        router.emplace(routing_settings, empty_catalogue);
+    }
+
+    // Полная карта без кэшей: раскладка, фрагменты маршрутов и остановок, сборка SVG
+    for (const unsigned threads : config.threads) {
+        optional<map_renderer::MapRenderer> renderer;
+        results.Write(info, "render_map"sv, threads, Measure(config.runs, [&] {
+            renderer.emplace(render_settings, *catalogue);
+            renderer->SetThreads(threads);
+        }, [&] {
+            return renderer->GetMapSvg().size();
+        }));
+    }
+
+    // Новые JsonReader и MapRenderer на каждый прогон, чтобы не сказывались кэши результатов и карты
+    for (const unsigned threads : config.threads) {
+        optional<processing::JsonReader> reader;
+        optional<map_renderer::MapRenderer> renderer;
+        results.Write(info, "stat_requests"sv, threads, Measure(config.runs, [&] {
+            reader.emplace(*catalogue);
+            reader->SetThreads(threads);
+            renderer.emplace(render_settings, *catalogue);
+            renderer->SetThreads(threads);
+        }, [&] {
+            CountingBuffer counter;
+            ostream out(&counter);
+            json::OutputBuffer buffer(out);
+            json::Writer writer(buffer);
+            reader->ProcessStatRequests(doc, *renderer, *router, writer);
+            buffer.Flush();
+            return counter.GetSize();
+        }));
+    }
+
+    // Вывод разобранного документа через json::Print
+    results.Write(info, "print"sv, 1, Measure(config.runs, [] {}, [&] {
+        CountingBuffer counter;
+        ostream out(&counter);
+        json::Print(doc, out);
+        return counter.GetSize();
+    }));
+}
+
+template <typename Value>
+optional<Value> ParseNumber(string_view arg) {
+    Value value{};
+    const auto [ptr, ec] = from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (ec != errc{} || ptr != arg.data() + arg.size()) {
+        return nullopt;
+    }
+    return value;
+}
+
+// Список положительных чисел через запятую
+template <typename Value>
+optional<vector<Value>> ParseList(string_view arg) {
+    vector<Value> values;
+    while (!arg.empty()) {
+        const size_t comma = arg.find(',');
+        const auto value = ParseNumber<Value>(arg.substr(0, comma));
+        if (!value || *value == 0) {
+            return nullopt;
+        }
+        values.push_back(*value);
+        arg = comma == string_view::npos ? string_view{} : arg.substr(comma + 1);
+    }
+    if (values.empty()) {
+        return nullopt;
+    }
+    return values;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    optional<string> output_path;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Invalid argument: "s << arg << endl;
+            return 1;
+        }
+        const string_view value = argv[++i];
+        bool valid = true;
+        if (arg == "--sizes"sv) {
+            const auto sizes = ParseList<size_t>(value);
+            valid = sizes.has_value();
+            config.sizes = sizes.value_or(config.sizes);
+        } else if (arg == "--threads"sv) {
+            const auto threads = ParseList<unsigned>(value);
+            valid = threads.has_value();
+            config.threads = threads.value_or(config.threads);
+        } else if (arg == "--buses-per-stop"sv) {
+            const auto ratio = ParseNumber<double>(value);
+            valid = ratio.has_value() && *ratio >= 0;
+            config.buses_per_stop = ratio.value_or(0);
+        } else if (arg == "--stat-requests"sv) {
+            const auto count = ParseNumber<size_t>(value);
+            valid = count.has_value();
+            config.stat_requests = count.value_or(0);
+        } else if (arg == "--runs"sv) {
+            const auto runs = ParseNumber<size_t>(value);
+            valid = runs.has_value() && *runs > 0;
+            config.runs = runs.value_or(1);
+        } else if (arg == "--router-max-stops"sv) {
+            const auto count = ParseNumber<size_t>(value);
+            valid = count.has_value();
+            config.router_max_stops = count.value_or(0);
+        } else if (arg == "--seed"sv) {
+            const auto seed = ParseNumber<uint64_t>(value);
+            valid = seed.has_value();
+            config.seed = seed.value_or(0);
+        } else if (arg == "--output"sv) {
+            output_path = string(value);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            cerr << "Invalid argument: "s << arg << ' ' << value << endl;
+            return 1;
+        }
+    }
+
+    ofstream file;
+    if (output_path) {
+        file.open(*output_path);
+        if (!file) {
+            cerr << "Cannot open "s << *output_path << endl;
+            return 1;
+        }
+    }
+    ResultWriter results(output_path ? file : cout);
+
+    try {
+        for (const size_t stops : config.sizes) {
+            RunCase(config, stops, results);
+        }
+    } catch (const exception& e) {
+        cerr << "Exception: "s << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/sh
+# Сравнивает ответы текущей сборки с ответами сборки из коммита base на синтетических городах.
+# Каждый способ поиска и способ, выбранный по умолчанию, должны отвечать побайтно так же,
+# как исходный graph::Router<double>.
+# Запуск из корня репозитория: tests/check_output_identity.sh [коммит] [каталог сборки]
+set -e
+
+base=${1:-$(git rev-list --max-parents=0 HEAD)}
+build_dir=${2:-_identity_build}
+flags="-std=c++17 -O2 -pthread"
+mkdir -p "$build_dir/base"
+
+git archive "$base" transport-catalogue | tar -x -C "$build_dir/base"
+g++ $flags -o "$build_dir/transport_catalogue_base" "$build_dir"/base/transport-catalogue/*.cpp
+g++ $flags -o "$build_dir/transport_catalogue" transport-catalogue/*.cpp
+g++ $flags -I transport-catalogue -o "$build_dir/generate_city" benchmark/generate_city.cpp \
+    benchmark/city_generator.cpp transport-catalogue/json.cpp transport-catalogue/json_writer.cpp \
+    transport-catalogue/geo.cpp
+
+failed=0
+for seed in 1 2 3 4 5; do
+    city="$build_dir/city_$seed.json"
+    "$build_dir/generate_city" --stops 150 --buses 30 --stat-requests 3000 \
+        --mix stop=1,bus=1,route=4,map=0.02 --seed "$seed" > "$city"
+    "$build_dir/transport_catalogue_base" < "$city" > "$build_dir/expected.json"
+    for engine in default all_pairs on_demand hierarchy; do
+        if [ "$engine" = default ]; then
+            "$build_dir/transport_catalogue" < "$city" > "$build_dir/actual.json"
+        else
+            "$build_dir/transport_catalogue" --router-engine "$engine" < "$city" > "$build_dir/actual.json"
+        fi
+        if cmp -s "$build_dir/expected.json" "$build_dir/actual.json"; then
+            echo "seed $seed engine $engine: identical"
+        else
+            echo "seed $seed engine $engine: differs"
+            failed=1
+        fi
+    done
+done
+exit $failed
@@ -0,0 +1,122 @@
+/*
+ * Тесты двоичного формата: документ восстанавливается после кодирования, а повреждённые данные,
+ * приходящие извне, отвергаются исключением json::ParsingError.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o json_binary_test tests/json_binary_test.cpp \
+ *       transport-catalogue/json.cpp transport-catalogue/json_binary.cpp
+ */
+
+#include "test_documents.h"
+#include "test_framework.h"
+
+#include "json.h"
+#include "json_binary.h"
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+const string SAMPLE = R"({
+    "base_requests": [
+        {"type": "Stop", "name": "A \"quoted\"\n", "latitude": 55.5, "longitude": -37.25, "is_roundtrip": false},
+        {"type": "Bus", "name": "14", "stops": ["A", "B", "A"], "is_roundtrip": true, "empty": [], "none": null}
+    ],
+    "numbers": [0, -17, 2147483647, -2147483648, 1e3, 2.5E-2, 123456789012],
+    "": {}
+})";
+
+// Значения из перечисления тегов в json_binary.cpp
+constexpr char TAG_INT = 3;
+constexpr char TAG_STRING = 5;
+constexpr char TAG_STRING_REF = 6;
+constexpr char TAG_ARRAY = 7;
+
+string MakeBinary(string_view body) {
+    return string(json::binary::MAGIC) + string(body);
+}
+
+string MakeBinary(initializer_list<char> body) {
+    return MakeBinary(string(body));
+}
+
+void TestRoundTrip() {
+    for (const string& text : {SAMPLE, testing::MakeCityText("[{\"id\": 1, \"type\": \"Map\"}]")}) {
+        const json::Document doc = json::LoadBuffer(text);
+        const string encoded = json::binary::Encode(doc);
+        CHECK(json::binary::IsBinary(encoded));
+        CHECK(encoded.size() < text.size());
+        CHECK(json::binary::Decode(encoded) == doc);
+    }
+}
+
+void TestRepeatedStringsReferenced() {
+    // Вторая строка "A" кодируется номером в таблице строк, а не байтами строки
+    const string encoded = json::binary::Encode(json::LoadBuffer(R"(["A", "A"])"));
+    CHECK_EQUAL(encoded, MakeBinary("\x07\x02\x05\x01"s "A\x06\x00"s));
+}
+
+void TestTruncatedInput() {
+    const string encoded = json::binary::Encode(json::LoadBuffer(SAMPLE));
+    for (size_t size = 0; size < encoded.size(); ++size) {
+        CHECK_THROWS(json::binary::Decode(encoded.substr(0, size)), json::ParsingError);
+    }
+    // Обрыв внутри varint: у последнего байта установлен признак продолжения
+    CHECK_THROWS(json::binary::Decode(MakeBinary({TAG_INT, '\x80'})), json::ParsingError);
+    // varint длиннее 64 бит
+    CHECK_THROWS(json::binary::Decode(MakeBinary(string(1, TAG_INT) + string(10, '\xFF') + '\x01')), json::ParsingError);
+}
+
+void TestBadStringReference() {
+    CHECK_THROWS(json::binary::Decode(MakeBinary({TAG_STRING_REF, 0})), json::ParsingError);
+    // Ссылка на строку, которая ещё не встречалась
+    CHECK_THROWS(json::binary::Decode(MakeBinary({TAG_ARRAY, 2, TAG_STRING, 1, 'A', TAG_STRING_REF, 1})),
+                 json::ParsingError);
+    // Ключ словаря не строка
+    CHECK_THROWS(json::binary::Decode(MakeBinary({'\x08', 1, TAG_INT, 2, TAG_INT, 2})), json::ParsingError);
+}
+
+void TestTrailingData() {
+    const string encoded = json::binary::Encode(json::LoadBuffer(SAMPLE));
+    CHECK_THROWS(json::binary::Decode(encoded + '\0'), json::ParsingError);
+    CHECK_THROWS(json::binary::Decode(MakeBinary({TAG_INT, 2, TAG_INT, 2})), json::ParsingError);
+}
+
+void TestCountExceedsRemainingBytes() {
+    // Массив объявляет 100 элементов, а данных осталось на один: память под них не резервируется
+    CHECK_THROWS(json::binary::Decode(MakeBinary({TAG_ARRAY, 100, 0})), json::ParsingError);
+    CHECK_THROWS(json::binary::Decode(MakeBinary(string(1, TAG_ARRAY) + string(9, '\xFF') + '\x01')),
+                 json::ParsingError);
+    CHECK_THROWS(json::binary::Decode(MakeBinary({TAG_STRING, 5, 'a', 'b'})), json::ParsingError);
+}
+
+void TestInvalidValues() {
+    CHECK_THROWS(json::binary::Decode("{}"s), json::ParsingError);
+    CHECK_THROWS(json::binary::Decode(MakeBinary("\x09"s)), json::ParsingError);
+    // Целое за пределами int
+    CHECK_THROWS(json::binary::Decode(MakeBinary({TAG_INT, '\x80', '\x80', '\x80', '\x80', '\x10'})), json::ParsingError);
+
+    // Глубокая вложенность отвергается до переполнения стека
+    string nested;
+    for (int i = 0; i < 100000; ++i) {
+        nested += {TAG_ARRAY, 1};
+    }
+    CHECK_THROWS(json::binary::Decode(MakeBinary(nested + '\0')), json::ParsingError);
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestRoundTrip);
+    RUN_TEST(runner, TestRepeatedStringsReferenced);
+    RUN_TEST(runner, TestTruncatedInput);
+    RUN_TEST(runner, TestBadStringReference);
+    RUN_TEST(runner, TestTrailingData);
+    RUN_TEST(runner, TestCountExceedsRemainingBytes);
+    RUN_TEST(runner, TestInvalidValues);
+    return runner.GetExitCode();
+}
@@ -0,0 +1,131 @@
+/*
+ * Тесты обработки документа: ответы выводятся только для полностью декодированных запросов,
+ * в том числе при обработке в несколько потоков.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o json_reader_test tests/json_reader_test.cpp \
+ *       $(find transport-catalogue -name '*.cpp' ! -name main.cpp)
+ */
+
+#include "test_documents.h"
+#include "test_framework.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "transport_catalogue.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace transport_catalogue;
+
+namespace {
+
+// Выход ProcessDocument; если обработка выбросила исключение, в вывод не должно попасть ничего
+string ProcessCity(string_view stat_requests, unsigned threads = 1, const json::PrintSettings& print_settings = {}) {
+    const json::Document doc = testing::MakeCityDocument(stat_requests);
+    database::TransportCatalogue catalogue;
+    processing::JsonReader reader(catalogue);
+    reader.SetThreads(threads);
+    ostringstream output;
+    try {
+        reader.ProcessDocument(doc, output, print_settings);
+    } catch (...) {
+        CHECK_EQUAL(output.str(), ""s);
+        throw;
+    }
+    return output.str();
+}
+
+void TestAnswersAllRequests() {
+    const string output = ProcessCity(R"([
+        {"id": 1, "type": "Stop", "name": "Bridge"},
+        {"id": 2, "type": "Bus", "name": "24"},
+        {"id": 3, "type": "Route", "from": "Airport", "to": "East"}
+    ])");
+    const json::Document answers_doc = json::LoadBuffer(output);
+    const auto& answers = answers_doc.GetRoot().AsArray();
+    CHECK_EQUAL(answers.size(), 3u);
+    CHECK_EQUAL(answers[2].AsMap().at("request_id"s).AsInt(), 3);
+}
+
+void TestMissingFieldLeavesNoOutput() {
+    CHECK_THROWS(ProcessCity(R"([
+        {"id": 1, "type": "Stop", "name": "Bridge"},
+        {"id": 2, "type": "MapTile", "x": 0, "y": 0}
+    ])"), out_of_range);
+}
+
+void TestWrongFieldTypeLeavesNoOutput() {
+    CHECK_THROWS(ProcessCity(R"([
+        {"id": 1, "type": "Bus", "name": "14"},
+        {"id": "2", "type": "Stop", "name": "Bridge"}
+    ])"), logic_error);
+}
+
+// Массив из count запросов о маршрутах и остановках; запрос с номером broken заменён на bad_request
+string MakeManyRequests(int count, int broken = -1, string_view bad_request = {}) {
+    static const string NAMES[] = {"Airport"s, "Bridge"s, "Center"s, "Docks"s, "East"s, "Forest"s};
+    string requests = "[";
+    for (int i = 0; i < count; ++i) {
+        requests += (i > 0) ? ", " : "";
+        if (i == broken) {
+            requests += bad_request;
+        } else if (i % 3 == 0) {
+            requests += R"({"id": )" + to_string(i) + R"(, "type": "Stop", "name": ")" + NAMES[i % 6] + R"("})";
+        } else {
+            requests += R"({"id": )" + to_string(i) + R"(, "type": "Route", "from": ")" + NAMES[i % 6]
+                + R"(", "to": ")" + NAMES[(i / 6) % 6] + R"("})";
+        }
+    }
+    return requests + "]";
+}
+
+void TestParallelMatchesSerial() {
+    const string requests = MakeManyRequests(300);
+    const string serial = ProcessCity(requests);
+    CHECK_EQUAL(ProcessCity(requests, 4), serial);
+    CHECK_EQUAL(json::LoadBuffer(serial).GetRoot().AsArray().size(), 300u);
+}
+
+void TestParallelErrorLeavesNoOutput() {
+    // Ошибка в одном из последних блоков: предыдущие блоки не должны попасть в вывод
+    const string missing_zoom = MakeManyRequests(300, 250, R"({"id": 250, "type": "MapTile", "x": 0, "y": 0})"sv);
+    CHECK_THROWS(ProcessCity(missing_zoom, 4), out_of_range);
+    const string wrong_type = MakeManyRequests(300, 299, R"({"id": 299, "type": "Route", "from": 1, "to": "East"})"sv);
+    CHECK_THROWS(ProcessCity(wrong_type, 4), logic_error);
+}
+
+void TestStatsKeysSorted() {
+    json::PrintSettings settings;
+    settings.compact = true;
+    const string output = ProcessCity(R"([
+        {"id": 1, "type": "Route", "from": "Airport", "to": "East"},
+        {"id": 2, "type": "Bus", "name": "14"},
+        {"id": 3, "type": "Stop", "name": "Bridge"},
+        {"id": 4, "type": "Stats"}
+    ])", 1, settings);
+
+    // json::Dict упорядочен по ключам, поэтому повторный вывод разобранного ответа совпадает с исходным,
+    // только если все ключи выведены по алфавиту
+    ostringstream reprinted;
+    json::Print(json::LoadBuffer(output), reprinted, settings);
+    CHECK_EQUAL(reprinted.str(), output);
+    CHECK(output.find("\"phases\""s) != string::npos);
+    CHECK(output.find("\"estimates\""s) != string::npos);
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestAnswersAllRequests);
+    RUN_TEST(runner, TestMissingFieldLeavesNoOutput);
+    RUN_TEST(runner, TestWrongFieldTypeLeavesNoOutput);
+    RUN_TEST(runner, TestParallelMatchesSerial);
+    RUN_TEST(runner, TestParallelErrorLeavesNoOutput);
+    RUN_TEST(runner, TestStatsKeysSorted);
+    return runner.GetExitCode();
+}
@@ -0,0 +1,144 @@
+/*
+ * Тесты ленточного представления JSON: значения совпадают с json::Document, контейнеры пропускаются
+ * целиком, некорректный текст отвергается. Запросы из ленты декодируются так же, как из словаря.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o json_tape_test tests/json_tape_test.cpp \
+ *       transport-catalogue/json.cpp transport-catalogue/json_tape.cpp transport-catalogue/requests.cpp
+ */
+
+#include "test_framework.h"
+
+#include "json.h"
+#include "json_tape.h"
+#include "requests.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+
+using namespace std;
+using namespace transport_catalogue::requesting;
+
+namespace {
+
+const string SAMPLE = R"({
+    "base_requests": [
+        {"type": "Stop", "name": "A \"quoted\"\n", "latitude": 55.5, "longitude": -37.25, "is_roundtrip": false},
+        {"type": "Bus", "name": "14", "stops": ["A", "B", "C"], "is_roundtrip": true, "empty": [], "none": null}
+    ],
+    "numbers": [0, -17, 1e3, 2.5E-2, 123456789012],
+    "unicode": "é\t\\",
+    "nested": [[[]], {"a": {"b": [1, {}]}}, "after"]
+})";
+
+// Значение ленты совпадает с узлом документа, включая тип числа и порядок ключей словаря
+bool Matches(const json::tape::Value& value, const json::Node& node) {
+    if (node.IsNull()) {
+        return value.IsNull();
+    } else if (node.IsBool()) {
+        return value.IsBool() && value.AsBool() == node.AsBool();
+    } else if (node.IsInt()) {
+        return value.IsInt() && value.AsInt() == node.AsInt();
+    } else if (node.IsPureDouble()) {
+        return value.IsPureDouble() && value.AsDouble() == node.AsDouble();
+    } else if (node.IsString()) {
+        return value.IsString() && value.AsString() == node.AsString();
+    } else if (node.IsArray()) {
+        if (!value.IsArray() || value.AsArray().size() != node.AsArray().size()) {
+            return false;
+        }
+        auto it = value.AsArray().begin();
+        for (const auto& item : node.AsArray()) {
+            if (!Matches(*it, item)) {
+                return false;
+            }
+            ++it;
+        }
+        return it == value.AsArray().end();
+    }
+    if (!value.IsMap() || value.AsMap().size() != node.AsMap().size()) {
+        return false;
+    }
+    for (const auto& [key, item] : node.AsMap()) {
+        if (value.AsMap().count(key) != 1 || !Matches(value.AsMap().at(key), item)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestMatchesDocument() {
+    const json::tape::Document tape = json::tape::Document::Parse(SAMPLE);
+    CHECK(Matches(tape.GetRoot(), json::LoadBuffer(SAMPLE).GetRoot()));
+}
+
+void TestContainersSkipped() {
+    const json::tape::Document tape = json::tape::Document::Parse(SAMPLE);
+    const auto nested = tape.GetRoot().AsMap().at("nested"sv).AsArray();
+    CHECK_EQUAL(nested.size(), 3u);
+    // Третий элемент находится переходом через два вложенных контейнера
+    CHECK_EQUAL(nested[2].AsString(), "after"sv);
+    CHECK(nested[0].AsArray()[0].AsArray().empty());
+    CHECK_THROWS(nested[3], out_of_range);
+    CHECK_THROWS(tape.GetRoot().AsMap().at("missing"sv), out_of_range);
+    CHECK_THROWS(nested[2].AsInt(), logic_error);
+}
+
+void TestInvalidInput() {
+    for (const string& text : {"[1, 2"s, "{\"a\" 1}"s, "\"unterminated"s, "nul"s, "[1,]"s, "[1] x"s,
+                               "{\"a\": 01}"s, "[\"bad \\q escape\"]"s, "{1: 2}"s, ""s}) {
+        CHECK_THROWS(json::tape::Document::Parse(text), json::ParsingError);
+    }
+}
+
+void TestDecodeMatchesDict() {
+    const string requests[] = {
+        R"({"id": 1, "type": "Stop", "name": "Airport"})",
+        R"({"type": "Bus", "name": "14", "id": 2})",
+        R"({"id": 3, "type": "Route", "from": "A \"x\"", "to": "B"})",
+        R"({"id": 4, "type": "RouteMap", "from": "A", "to": "B"})",
+        R"({"id": 5, "type": "MapTile", "bbox": [0, 1.5, 20, 30]})",
+        R"({"id": 6, "type": "MapTile", "zoom": 2, "x": 1, "y": 3})",
+        R"({"id": 7, "type": "Map"})",
+        R"({"id": 8, "type": "Stats"})",
+        R"({"id": 9, "type": "Unknown"})",
+    };
+    for (const string& text : requests) {
+        const json::Document doc = json::LoadBuffer(text);
+        const json::tape::Document tape = json::tape::Document::Parse(text);
+        const StatRequest from_dict = DecodeStatRequest(doc.GetRoot().AsMap());
+        const StatRequest from_tape = DecodeStatRequest(tape.GetRoot().AsMap());
+        CHECK(GetRequestType(from_tape) == GetRequestType(from_dict));
+        if (const auto* route = get_if<RouteRequest>(&from_tape)) {
+            CHECK_EQUAL(route->from, "A \"x\""sv);
+            CHECK_EQUAL(route->to, get<RouteRequest>(from_dict).to);
+        }
+        if (const auto* tile = get_if<MapTileRequest>(&from_tape)) {
+            const auto& expected = get<MapTileRequest>(from_dict);
+            CHECK_EQUAL(tile->bbox.has_value(), expected.bbox.has_value());
+            CHECK(!tile->bbox || (tile->bbox->min_y == expected.bbox->min_y && tile->bbox->max_x == expected.bbox->max_x));
+            CHECK_EQUAL(tile->zoom, expected.zoom);
+            CHECK_EQUAL(tile->y, expected.y);
+        }
+    }
+
+    // Из повторяющихся ключей действует первый, как в json::Dict
+    const string duplicate = R"({"id": 1, "type": "Stop", "name": "first", "name": "second"})";
+    const json::tape::Document tape = json::tape::Document::Parse(duplicate);
+    CHECK_EQUAL(get<StopRequest>(DecodeStatRequest(tape.GetRoot().AsMap())).name, "first"sv);
+
+    const json::tape::Document missing = json::tape::Document::Parse(R"({"id": 1, "type": "Route", "from": "A"})");
+    CHECK_THROWS(DecodeStatRequest(missing.GetRoot().AsMap()), out_of_range);
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestMatchesDocument);
+    RUN_TEST(runner, TestContainersSkipped);
+    RUN_TEST(runner, TestInvalidInput);
+    RUN_TEST(runner, TestDecodeMatchesDict);
+    return runner.GetExitCode();
+}
@@ -0,0 +1,145 @@
+/*
+ * Тесты разбора JSON: загрузка из буфера без копирования строк и ключей и параллельный разбор массивов.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o json_test tests/json_test.cpp \
+ *       transport-catalogue/json.cpp
+ */
+
+#include "test_framework.h"
+
+#include "json.h"
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <variant>
+
+using namespace std;
+
+namespace {
+
+const string SAMPLE = R"({
+    "base_requests": [
+        {"type": "Stop", "name": "A \"quoted\"\n", "latitude": 55.5, "longitude": -37.25, "is_roundtrip": false},
+        {"type": "Bus", "name": "14", "stops": ["A", "B", "C"], "is_roundtrip": true, "empty": [], "none": null}
+    ],
+    "numbers": [0, -17, 1e3, 2.5E-2, 123456789012],
+    "unicode": "é\t\\",
+    "key \"escaped\"": 1
+})";
+
+json::Document LoadStream(const string& text) {
+    istringstream input(text);
+    return json::Load(input);
+}
+
+void TestBufferMatchesStream() {
+    const json::Document from_buffer = json::LoadBuffer(SAMPLE);
+    CHECK(from_buffer == LoadStream(SAMPLE));
+}
+
+void TestPlainStringsReferenceBuffer() {
+    const json::Document doc = json::LoadBuffer(SAMPLE);
+    const auto& bus = doc.GetRoot().AsMap().at("base_requests"s).AsArray().at(1).AsMap();
+    // Строки без escape-последовательностей не копируются
+    CHECK(holds_alternative<json::StringRef>(bus.at("name"s).GetValue()));
+    CHECK_EQUAL(bus.at("name"s).AsString(), "14"sv);
+
+    // Строки с escape-последовательностями раскодируются в копию
+    const auto& stop = doc.GetRoot().AsMap().at("base_requests"s).AsArray().at(0).AsMap();
+    CHECK_EQUAL(stop.at("name"s).AsString(), "A \"quoted\"\n"sv);
+    CHECK_EQUAL(doc.GetRoot().AsMap().at("unicode"s).AsString(), "\xc3\xa9\t\\"sv);
+}
+
+void TestKeysReferenceBuffer() {
+    const json::Document doc = json::LoadBuffer(SAMPLE);
+    const auto& bus = doc.GetRoot().AsMap().at("base_requests"s).AsArray().at(1).AsMap();
+    // Ключ и значение "name": "14" ссылаются на соседние участки текста
+    const auto name = bus.find("name"sv);
+    CHECK(name != bus.end());
+    CHECK(name->first.View().data() + "name\": \""sv.size()
+          == get<json::StringRef>(name->second.GetValue()).data.data());
+
+    // Ключи с escape-последовательностями раскодируются, ключи из потока копируются
+    CHECK_EQUAL(doc.GetRoot().AsMap().at("key \"escaped\""s).AsInt(), 1);
+    const json::Document from_stream = LoadStream(SAMPLE);
+    CHECK_EQUAL(from_stream.GetRoot().AsMap().count("key \"escaped\""sv), 1u);
+}
+
+void TestCopyKeepsBufferAlive() {
+    optional<json::Document> original = json::LoadBuffer(SAMPLE);
+    const json::Document copy = *original;
+    original.reset();
+    const auto& bus = copy.GetRoot().AsMap().at("base_requests"s).AsArray().at(1).AsMap();
+    CHECK_EQUAL(bus.begin()->first.View(), "empty"sv);
+    const auto& stops = bus.at("stops"s).AsArray();
+    CHECK_EQUAL(stops.size(), 3u);
+    CHECK_EQUAL(stops.at(2).AsString(), "C"sv);
+}
+
+void TestNumbers() {
+    const json::Document doc = json::LoadBuffer(SAMPLE);
+    const auto& numbers = doc.GetRoot().AsMap().at("numbers"s).AsArray();
+    CHECK(numbers.at(0).IsInt());
+    CHECK_EQUAL(numbers.at(1).AsInt(), -17);
+    CHECK(numbers.at(2).IsPureDouble());
+    CHECK_EQUAL(numbers.at(2).AsDouble(), 1000.0);
+    CHECK_EQUAL(numbers.at(3).AsDouble(), 0.025);
+    // Целое вне диапазона int читается как double
+    CHECK(numbers.at(4).IsPureDouble());
+}
+
+void TestInvalidInput() {
+    for (const string& text : {"[1, 2"s, "{\"a\" 1}"s, "\"unterminated"s, "nul"s, "[1,]x"s}) {
+        CHECK_THROWS(json::LoadBuffer(text), json::ParsingError);
+    }
+}
+
+// Разбор в несколько потоков с порогом, под который попадает любой массив верхнего уровня
+json::Document LoadParallel(const string& text) {
+    json::ParseSettings settings;
+    settings.threads = 4;
+    settings.parallel_min_bytes = 1;
+    return json::LoadBuffer(text, settings);
+}
+
+void TestParallelMatchesSerial() {
+    CHECK(LoadParallel(SAMPLE) == json::LoadBuffer(SAMPLE));
+
+    string requests = "[";
+    for (int i = 0; i < 1000; ++i) {
+        requests += (i > 0) ? ", " : "";
+        requests += R"({"id": )" + to_string(i) + R"(, "type": "Bus", "name": "a,b]\"c", "stops": [1, [2]]})";
+    }
+    requests += "]";
+    const json::Document parallel = LoadParallel(requests);
+    CHECK(parallel == json::LoadBuffer(requests));
+    CHECK_EQUAL(parallel.GetRoot().AsArray().size(), 1000u);
+
+    for (const string& text : {"[]"s, "[ ]"s, "[7]"s, "{\"a\": [], \"b\": [1, 2]}"s}) {
+        CHECK(LoadParallel(text) == json::LoadBuffer(text));
+    }
+}
+
+void TestParallelRejectsMalformedArrays() {
+    // Каждый участок между разделителями должен содержать ровно одно значение
+    for (const string& text : {"[1 2]"s, "[1, 2 3]"s, "[1,]"s, "[,1]"s, "[1,,2]"s, "[1, 2"s}) {
+        CHECK_THROWS(LoadParallel(text), json::ParsingError);
+    }
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestBufferMatchesStream);
+    RUN_TEST(runner, TestPlainStringsReferenceBuffer);
+    RUN_TEST(runner, TestKeysReferenceBuffer);
+    RUN_TEST(runner, TestCopyKeepsBufferAlive);
+    RUN_TEST(runner, TestNumbers);
+    RUN_TEST(runner, TestInvalidInput);
+    RUN_TEST(runner, TestParallelMatchesSerial);
+    RUN_TEST(runner, TestParallelRejectsMalformedArrays);
+    return runner.GetExitCode();
+}
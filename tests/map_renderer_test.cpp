@@ -0,0 +1,376 @@
+/*
+ * Тесты отрисовки карты: кэши SVG-текста карты и фрагментов, упрощение линий маршрутов,
+ * наложение найденного маршрута, размещение надписей без перекрытий, запросы к сетке объектов.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o map_renderer_test tests/map_renderer_test.cpp \
+ *       $(find transport-catalogue -name '*.cpp' ! -name main.cpp)
+ */
+
+#include "test_framework.h"
+
+#include "map_renderer.h"
+#include "spatial_index.h"
+#include "transport_catalogue.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace transport_catalogue;
+using namespace transport_catalogue::map_renderer;
+
+namespace {
+
+RenderSettings MakeSettings() {
+    RenderSettings settings;
+    settings.width = 600;
+    settings.height = 400;
+    settings.padding = 30;
+    settings.line_width = 8;
+    settings.stop_radius = 4;
+    settings.bus_label_font_size = 16;
+    settings.bus_label_offset = {7, 15};
+    settings.stop_label_font_size = 12;
+    settings.stop_label_offset = {7, -3};
+    settings.underlayer_color = svg::Rgba{255, 255, 255, 0.85};
+    settings.underlayer_width = 3;
+    settings.color_palette = {"green"s, svg::Rgb{255, 160, 0}, "red"s};
+    return settings;
+}
+
+void FillCity(database::TransportCatalogue& catalogue) {
+    catalogue.AddStop("Airport"sv, {55.60, 37.60});
+    catalogue.AddStop("Bridge"sv, {55.62, 37.62});
+    catalogue.AddStop("Center"sv, {55.64, 37.60});
+    catalogue.AddStop("Docks"sv, {55.63, 37.66});
+    catalogue.AddStop("East"sv, {55.61, 37.68});
+    catalogue.AddRoute("14"sv, {"Airport"sv, "Bridge"sv, "Center"sv, "Airport"sv}, true);
+    catalogue.AddRoute("24"sv, {"Bridge"sv, "Docks"sv, "East"sv}, false);
+}
+
+// Карта, построенная новым рендерером без кэшей
+string RenderFresh(const database::TransportCatalogue& catalogue, const RenderSettings& settings = MakeSettings()) {
+    MapRenderer renderer(settings, catalogue);
+    return renderer.GetMapSvg();
+}
+
+void TestMapSvgCachedPerVersion() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    MapRenderer renderer(MakeSettings(), catalogue);
+
+    const string* first = &renderer.GetMapSvg();
+    const string first_text = *first;
+    CHECK(first == &renderer.GetMapSvg());
+    CHECK_EQUAL(renderer.GetMapSvg(), first_text);
+
+    // Изменение справочника делает кэш недействительным
+    catalogue.AddStop("Forest"sv, {55.59, 37.64});
+    catalogue.AddRoute("750"sv, {"Airport"sv, "Forest"sv, "East"sv}, false);
+    const string& second = renderer.GetMapSvg();
+    CHECK(second != first_text);
+    CHECK_EQUAL(second, RenderFresh(catalogue));
+
+    // Новые настройки тоже
+    RenderSettings settings = MakeSettings();
+    settings.line_width = 2;
+    renderer.SetSettings(settings);
+    CHECK_EQUAL(renderer.GetMapSvg(), RenderFresh(catalogue, settings));
+}
+
+void TestStreamMatchesCachedText() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    MapRenderer renderer(MakeSettings(), catalogue);
+
+    string streamed;
+    renderer.StreamMapSvg([&streamed](string_view chunk) {
+        streamed += chunk;
+    });
+    CHECK_EQUAL(streamed, RenderFresh(catalogue));
+    CHECK_EQUAL(renderer.GetMapSvg(), streamed);
+}
+
+void TestFragmentsMatchFreshRender() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    MapRenderer renderer(MakeSettings(), catalogue);
+    renderer.GetMapSvg();
+
+    // Маршрут "16" встаёт между "14" и "24" и сдвигает цвет "24"; остановка внутри прежних границ
+    // не меняет проектор, поэтому остальные фрагменты берутся из кэша
+    catalogue.AddStop("Garden"sv, {55.62, 37.64});
+    catalogue.AddRoute("16"sv, {"Garden"sv, "Bridge"sv}, false);
+    CHECK_EQUAL(renderer.GetMapSvg(), RenderFresh(catalogue));
+
+    // Остановка за границами карты меняет проектор и положение всех элементов
+    catalogue.AddStop("Harbor"sv, {55.70, 37.75});
+    catalogue.AddRoute("8"sv, {"Harbor"sv, "East"sv}, false);
+    CHECK_EQUAL(renderer.GetMapSvg(), RenderFresh(catalogue));
+
+    // Маршрут с повторяющимся названием добавляется отдельным объектом
+    catalogue.AddRoute("24"sv, {"Docks"sv, "Center"sv}, true);
+    CHECK_EQUAL(renderer.GetMapSvg(), RenderFresh(catalogue));
+}
+
+const database::Bus* FindBus(const database::TransportCatalogue& catalogue, string_view name) {
+    const auto buses = catalogue.GetAllBuses();
+    for (const auto* bus : *buses) {
+        if (bus->name == name) {
+            return bus;
+        }
+    }
+    return nullptr;
+}
+
+// Строки SVG-текста без отступов
+vector<string> SplitLines(const string& text) {
+    vector<string> lines;
+    istringstream input(text);
+    for (string line; getline(input, line);) {
+        lines.push_back(line.substr(min(line.find_first_not_of(' '), line.size())));
+    }
+    return lines;
+}
+
+void TestRouteOverlayDrawnOverMap() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    MapRenderer renderer(MakeSettings(), catalogue);
+    const string map = renderer.GetMapSvg();
+
+    // Ожидание в Airport, "14" до Bridge, пересадка, "24" до Docks
+    const auto* airport = *catalogue.GetStopInfo("Airport"sv);
+    const auto* bridge = *catalogue.GetStopInfo("Bridge"sv);
+    const auto* docks = *catalogue.GetStopInfo("Docks"sv);
+    const vector<database::RouteLeg> legs{
+        {nullptr, {airport}},
+        {FindBus(catalogue, "14"sv), {airport, bridge}},
+        {nullptr, {bridge}},
+        {FindBus(catalogue, "24"sv), {bridge, docks}},
+    };
+    string svg;
+    renderer.StreamRouteMapSvg(legs, [&svg](string_view chunk) {
+        svg += chunk;
+    });
+
+    // Наложение выводится между картой и закрывающим тегом
+    const string footer = "</svg>"s;
+    CHECK_EQUAL(svg.substr(0, map.size() - footer.size()), map.substr(0, map.size() - footer.size()));
+    const vector<string> overlay = SplitLines(svg.substr(map.size() - footer.size()));
+    CHECK_EQUAL(overlay.size(), 8u);
+    CHECK_EQUAL(overlay.back(), footer);
+
+    // Подложки обеих поездок, затем линии цветов автобусов вдвое толще обычных
+    CHECK(overlay[0].find("stroke=\"rgba(255,255,255,0.85)\" stroke-width=\"19\""s) != string::npos);
+    CHECK(overlay[1].find("stroke=\"rgba(255,255,255,0.85)\" stroke-width=\"19\""s) != string::npos);
+    CHECK(overlay[2].find("stroke=\"green\" stroke-width=\"16\""s) != string::npos);
+    CHECK(overlay[3].find("stroke=\"rgb(255,160,0)\" stroke-width=\"16\""s) != string::npos);
+    CHECK_EQUAL(overlay[0].substr(0, overlay[0].find(" fill")), overlay[2].substr(0, overlay[2].find(" fill")));
+
+    // Отметки: посадка на "14", пересадка на "24", конец маршрута
+    CHECK(overlay[4].find("<circle"s) == 0 && overlay[4].find("stroke=\"green\""s) != string::npos);
+    CHECK(overlay[5].find("<circle"s) == 0 && overlay[5].find("stroke=\"rgb(255,160,0)\""s) != string::npos);
+    CHECK(overlay[6].find("<circle"s) == 0 && overlay[6].find("stroke=\"black\""s) != string::npos);
+
+    // Карта в кэше не изменилась
+    CHECK_EQUAL(renderer.GetMapSvg(), map);
+}
+
+// Маршрут "1" почти прямой: остановка B отклоняется от линии A—C на 0.34 пикселя карты
+void FillStraightCity(database::TransportCatalogue& catalogue) {
+    catalogue.AddStop("A"sv, {55.60, 37.60});
+    catalogue.AddStop("B"sv, {55.6001, 37.65});
+    catalogue.AddStop("C"sv, {55.60, 37.70});
+    catalogue.AddStop("D"sv, {55.70, 37.65});
+    catalogue.AddRoute("1"sv, {"A"sv, "B"sv, "C"sv}, false);
+    catalogue.AddRoute("2"sv, {"D"sv, "A"sv}, false);
+}
+
+// Точки линий маршрутов в порядке вывода
+vector<string> GetPolylines(string_view svg) {
+    static constexpr string_view PREFIX = "<polyline points=\""sv;
+    vector<string> polylines;
+    for (size_t pos = svg.find(PREFIX); pos != svg.npos; pos = svg.find(PREFIX, pos)) {
+        pos += PREFIX.size();
+        const size_t end = svg.find('"', pos);
+        polylines.emplace_back(svg.substr(pos, end - pos));
+    }
+    return polylines;
+}
+
+void TestSimplifyDropsPointsWithinTolerance() {
+    database::TransportCatalogue catalogue;
+    FillStraightCity(catalogue);
+
+    RenderSettings settings = MakeSettings();
+    const vector<string> exact = GetPolylines(RenderFresh(catalogue, settings));
+    CHECK_EQUAL(exact.size(), 2u);
+    CHECK_EQUAL(exact[0], "30,370 200,369.66 370,370 200,369.66 30,370"s);
+
+    settings.simplify_tolerance = 1;
+    const vector<string> simplified = GetPolylines(RenderFresh(catalogue, settings));
+    CHECK_EQUAL(simplified.size(), 2u);
+    // Концы и самая дальняя точка остаются, B ближе допуска и отбрасывается
+    CHECK_EQUAL(simplified[0], "30,370 370,370 30,370"s);
+    CHECK_EQUAL(simplified[1], exact[1]);
+
+    settings.simplify_tolerance = 0.3;
+    CHECK(GetPolylines(RenderFresh(catalogue, settings)) == exact);
+}
+
+void TestSimplifyToleranceScalesWithZoom() {
+    database::TransportCatalogue catalogue;
+    FillStraightCity(catalogue);
+    RenderSettings settings = MakeSettings();
+    settings.simplify_tolerance = 1;
+    MapRenderer renderer(settings, catalogue);
+
+    // Тайл нижнего левого угла: при zoom 1 допуск 0.5 пикселя, при zoom 2 — 0.25
+    const auto coarse = renderer.GetTileBounds(1, 0, 1);
+    const auto fine = renderer.GetTileBounds(2, 0, 3);
+    CHECK(coarse && fine);
+    CHECK_EQUAL(GetPolylines(renderer.GetTileSvg(*coarse)).at(0), "30,370 370,370 30,370"s);
+    CHECK_EQUAL(GetPolylines(renderer.GetTileSvg(*fine)).at(0), "30,370 200,369.66 370,370 200,369.66 30,370"s);
+}
+
+// Надпись карты: область, которую она занимает, оценённая так же, как при размещении
+struct Label {
+    string text;
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+};
+
+double GetAttribute(const string& line, string_view name) {
+    const string prefix = " "s + string(name) + "=\""s;
+    return stod(line.substr(line.find(prefix) + prefix.size()));
+}
+
+// Надписи без подложек; подложка каждой надписи выводится перед ней с атрибутом stroke
+vector<Label> GetLabels(const string& svg) {
+    vector<Label> labels;
+    size_t underlayers = 0;
+    for (const string& line : SplitLines(svg)) {
+        if (line.find("<text "s) != 0) {
+            continue;
+        }
+        if (line.find(" stroke="s) != string::npos) {
+            ++underlayers;
+            continue;
+        }
+        const size_t text_begin = line.find('>') + 1;
+        const string text = line.substr(text_begin, line.find('<', text_begin) - text_begin);
+        const double x = GetAttribute(line, "x"sv) + GetAttribute(line, "dx"sv);
+        const double y = GetAttribute(line, "y"sv) + GetAttribute(line, "dy"sv);
+        const double size = GetAttribute(line, "font-size"sv);
+        labels.push_back({text, x, y - size, x + size * static_cast<double>(text.size()), y + size / 2});
+    }
+    CHECK_EQUAL(underlayers, labels.size());
+    return labels;
+}
+
+size_t CountOverlaps(const vector<Label>& labels) {
+    size_t overlaps = 0;
+    for (size_t i = 0; i < labels.size(); ++i) {
+        for (size_t j = i + 1; j < labels.size(); ++j) {
+            const Label& a = labels[i];
+            const Label& b = labels[j];
+            overlaps += a.min_x < b.max_x && b.min_x < a.max_x && a.min_y < b.max_y && b.min_y < a.max_y;
+        }
+    }
+    return overlaps;
+}
+
+// Остановки в ряд через 27 пикселей: надписи соседних остановок на своих местах перекрываются
+void FillCrowdedCity(database::TransportCatalogue& catalogue) {
+    vector<string> names;
+    for (int i = 0; i < 8; ++i) {
+        names.push_back("Stop "s + to_string(i));
+        catalogue.AddStop(names.back(), {55.60 + 0.001 * (i % 2), 37.60 + 0.004 * i});
+    }
+    catalogue.AddStop("Far"sv, {55.65, 37.628});
+    catalogue.AddRoute("1"sv, vector<string_view>(names.begin(), names.end()), false);
+    catalogue.AddRoute("2"sv, {"Far"sv, "Stop 0"sv}, false);
+}
+
+void TestLabelsPlacedWithoutOverlap() {
+    database::TransportCatalogue catalogue;
+    FillCrowdedCity(catalogue);
+    RenderSettings settings = MakeSettings();
+
+    const vector<Label> plain = GetLabels(RenderFresh(catalogue, settings));
+    CHECK_EQUAL(plain.size(), 13u);
+    CHECK(CountOverlaps(plain) > 0);
+
+    settings.avoid_label_overlap = true;
+    const vector<Label> placed = GetLabels(RenderFresh(catalogue, settings));
+    CHECK_EQUAL(CountOverlaps(placed), 0u);
+    CHECK(placed.size() >= plain.size() / 2);
+
+    // Надписи маршрутов размещаются первыми и все выведены: первая на своём месте,
+    // надпись "2" у Stop 0 отражена, чтобы не перекрыть надпись "1"
+    for (size_t i = 0; i < 4; ++i) {
+        CHECK_EQUAL(placed[i].text, plain[i].text);
+    }
+    CHECK_EQUAL(placed[0].min_x, plain[0].min_x);
+    CHECK_EQUAL(placed[0].min_y, plain[0].min_y);
+    CHECK(placed[3].min_x < plain[3].min_x);
+}
+
+void TestSparseLabelsKeepTheirPlaces() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    // Надписи остановок выше надписей маршрутов у конечных
+    RenderSettings settings = MakeSettings();
+    settings.stop_label_offset = {7, -20};
+    const string plain = RenderFresh(catalogue, settings);
+    CHECK_EQUAL(CountOverlaps(GetLabels(plain)), 0u);
+
+    settings.avoid_label_overlap = true;
+    CHECK_EQUAL(RenderFresh(catalogue, settings), plain);
+}
+
+void TestGridIndexQuery() {
+    // Длинный горизонтальный объект 0 занимает целую строку ячеек, объекты 1..99 — точки на диагонали
+    vector<vector<Rect>> items{{Rect{0, 50, 1000, 51}}};
+    for (int i = 1; i < 100; ++i) {
+        items.push_back({Rect{i * 10., i * 10., i * 10. + 1, i * 10. + 1}});
+    }
+    const GridIndex index(Rect{0, 0, 1000, 1000}, items);
+
+    // Объект 0 попадает в ответ один раз, хотя его прямоугольник задевает все ячейки запроса
+    const vector<uint32_t> found = index.Query(Rect{0, 40, 1000, 60});
+    CHECK(is_sorted(found.begin(), found.end()));
+    CHECK(adjacent_find(found.begin(), found.end()) == found.end());
+    CHECK(!found.empty() && found.front() == 0);
+    for (uint32_t id : {4u, 5u, 6u}) {
+        CHECK(binary_search(found.begin(), found.end(), id));
+    }
+
+    // Маленький запрос не задевает ячейки объекта 0
+    const vector<uint32_t> corner = index.Query(Rect{985, 985, 995, 995});
+    CHECK(binary_search(corner.begin(), corner.end(), 98u));
+    CHECK(!binary_search(corner.begin(), corner.end(), 0u));
+    CHECK(corner.size() < items.size() / 4);
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestMapSvgCachedPerVersion);
+    RUN_TEST(runner, TestStreamMatchesCachedText);
+    RUN_TEST(runner, TestFragmentsMatchFreshRender);
+    RUN_TEST(runner, TestRouteOverlayDrawnOverMap);
+    RUN_TEST(runner, TestSimplifyDropsPointsWithinTolerance);
+    RUN_TEST(runner, TestSimplifyToleranceScalesWithZoom);
+    RUN_TEST(runner, TestLabelsPlacedWithoutOverlap);
+    RUN_TEST(runner, TestSparseLabelsKeepTheirPlaces);
+    RUN_TEST(runner, TestGridIndexQuery);
+    return runner.GetExitCode();
+}
@@ -0,0 +1,180 @@
+/*
+ * Тесты обработчика запросов: повторные запросы Bus, Route и RouteMap вычисляются один раз,
+ * запомненные маршруты привязаны к версии справочника и настройкам маршрутизатора.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o request_handler_test tests/request_handler_test.cpp \
+ *       $(find transport-catalogue -name '*.cpp' ! -name main.cpp)
+ */
+
+#include "test_documents.h"
+#include "test_framework.h"
+
+#include "json.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace transport_catalogue;
+using namespace transport_catalogue::requesting;
+using namespace transport_catalogue::routing;
+
+namespace {
+
+const RoutingSettings SETTINGS{6, 40};
+
+void FillCity(database::TransportCatalogue& catalogue) {
+    processing::JsonReader reader(catalogue);
+    reader.ProcessBaseRequests(testing::MakeCityDocument("[]"sv));
+}
+
+// Ответ на маршрутный запрос в виде JSON-текста
+string AnswerRoute(const RequestHandler& handler, const Router& router, int id, string_view from, string_view to) {
+    json::OutputBuffer buffer;
+    json::Writer writer(buffer);
+    handler.HandleRoutingRequest(RouteRequest{id, from, to}, router, writer);
+    return buffer.Release();
+}
+
+// Ответ без значения request_id, чтобы сравнивать ответы на запросы с разными id
+string WithoutId(string answer) {
+    const size_t key = answer.find("\"request_id\""s);
+    const size_t value = answer.find_first_of("0123456789"s, key);
+    answer.erase(value, answer.find_first_not_of("0123456789"s, value) - value);
+    return answer;
+}
+
+void TestDuplicatesComputedOnce() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    const RequestHandler handler(catalogue);
+    const Router router(SETTINGS, catalogue);
+
+    const string first = AnswerRoute(handler, router, 1, "Airport"sv, "East"sv);
+    const string second = AnswerRoute(handler, router, 2, "Airport"sv, "East"sv);
+    CHECK(first != second);
+    CHECK_EQUAL(WithoutId(first), WithoutId(second));
+    AnswerRoute(handler, router, 3, "East"sv, "Airport"sv);
+
+    json::OutputBuffer buffer;
+    json::Writer writer(buffer);
+    writer.StartArray();
+    handler.HandleRouteRequest(BusRequest{4, "14"sv}, writer);
+    handler.HandleRouteRequest(BusRequest{5, "14"sv}, writer);
+    handler.HandleRouteRequest(BusRequest{6, "999"sv}, writer);
+    handler.HandleRouteRequest(BusRequest{7, "999"sv}, writer);
+    writer.EndArray();
+
+    const auto stats = handler.GetCacheStats();
+    CHECK_EQUAL(stats.requests, 7u);
+    CHECK_EQUAL(stats.computed, 4u);
+}
+
+void TestCacheFollowsRouterInputs() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    const RequestHandler handler(catalogue);
+
+    auto router = make_unique<Router>(SETTINGS, catalogue);
+    const string before = AnswerRoute(handler, *router, 1, "Airport"sv, "Docks"sv);
+
+    // Маршрутизатор, построенный заново с теми же настройками, даёт те же маршруты: кэш остаётся
+    router = make_unique<Router>(SETTINGS, catalogue);
+    CHECK_EQUAL(AnswerRoute(handler, *router, 1, "Airport"sv, "Docks"sv), before);
+    CHECK_EQUAL(handler.GetCacheStats().computed, 1u);
+
+    // Другие настройки, даже если объект окажется по прежнему адресу, — другие маршруты
+    router.reset();
+    router = make_unique<Router>(RoutingSettings{20, 40}, catalogue);
+    const string slower = AnswerRoute(handler, *router, 1, "Airport"sv, "Docks"sv);
+    CHECK_EQUAL(handler.GetCacheStats().computed, 2u);
+    CHECK(slower != before);
+    CHECK_EQUAL(slower, AnswerRoute(RequestHandler(catalogue), *router, 1, "Airport"sv, "Docks"sv));
+
+    // Изменение справочника тоже сбрасывает кэш
+    catalogue.AddStop("Garden"sv, {55.62, 37.64});
+    router = make_unique<Router>(SETTINGS, catalogue);
+    CHECK_EQUAL(AnswerRoute(handler, *router, 1, "Airport"sv, "Docks"sv), before);
+    CHECK_EQUAL(handler.GetCacheStats().computed, 3u);
+}
+
+void TestPrefetchGroupsRouteQueries() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    RoutingOptions options;
+    options.engine = RoutingEngine::ON_DEMAND;
+    const Router router(SETTINGS, catalogue, {}, options);
+
+    const vector<pair<string_view, string_view>> queries{
+        {"East"sv, "Airport"sv}, {"Airport"sv, "East"sv}, {"East"sv, "Center"sv},
+        {"Airport"sv, "East"sv}, {"Lonely"sv, "Airport"sv}, {"Nowhere"sv, "East"sv},
+    };
+    for (const unsigned threads : {1u, 3u}) {
+        const RequestHandler handler(catalogue);
+        handler.PrefetchRoutes(queries, router, threads);
+        CHECK_EQUAL(handler.GetCacheStats().computed, 5u);
+        CHECK_EQUAL(handler.GetCacheStats().requests, 0u);
+
+        // Ответы берутся из кэша и совпадают с вычисленными без предварительного поиска
+        for (const auto& [from, to] : queries) {
+            CHECK_EQUAL(AnswerRoute(handler, router, 1, from, to), AnswerRoute(RequestHandler(catalogue), router, 1, from, to));
+        }
+        CHECK_EQUAL(handler.GetCacheStats().computed, 5u);
+        CHECK_EQUAL(handler.GetCacheStats().requests, queries.size());
+    }
+
+    // Маршрутизатору с матрицей всех пар порядок запросов безразличен
+    options.engine = RoutingEngine::ALL_PAIRS;
+    const Router all_pairs(SETTINGS, catalogue, {}, options);
+    const RequestHandler handler(catalogue);
+    handler.PrefetchRoutes(queries, all_pairs, 1);
+    CHECK_EQUAL(handler.GetCacheStats().computed, 0u);
+}
+
+void TestRouteMapSharesRouteCache() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    const processing::JsonReader reader(catalogue);
+    for (const RoutingEngine engine : {RoutingEngine::ALL_PAIRS, RoutingEngine::ON_DEMAND, RoutingEngine::HIERARCHY}) {
+        RoutingOptions options;
+        options.engine = engine;
+        const Router router(SETTINGS, catalogue, {}, options);
+        MapRenderer renderer(reader.ProcessRenderSettings(testing::MakeCityDocument("[]"sv)), catalogue);
+        const RequestHandler handler(catalogue);
+
+        // Маршрут вычисляется один раз для запроса Route и повторных запросов RouteMap
+        AnswerRoute(handler, router, 1, "Airport"sv, "East"sv);
+        json::OutputBuffer buffer;
+        json::Writer writer(buffer);
+        writer.StartArray();
+        handler.HandleRouteMapRequest(RouteMapRequest{2, "Airport"sv, "East"sv}, renderer, router, writer);
+        handler.HandleRouteMapRequest(RouteMapRequest{3, "Airport"sv, "East"sv}, renderer, router, writer);
+        handler.HandleRouteMapRequest(RouteMapRequest{4, "Airport"sv, "Lonely"sv}, renderer, router, writer);
+        writer.EndArray();
+
+        const auto stats = handler.GetCacheStats();
+        CHECK_EQUAL(stats.requests, 4u);
+        CHECK_EQUAL(stats.computed, 2u);
+        CHECK(buffer.View().find("\"not found\""sv) != string_view::npos);
+    }
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestDuplicatesComputedOnce);
+    RUN_TEST(runner, TestCacheFollowsRouterInputs);
+    RUN_TEST(runner, TestPrefetchGroupsRouteQueries);
+    RUN_TEST(runner, TestRouteMapSharesRouteCache);
+    return runner.GetExitCode();
+}
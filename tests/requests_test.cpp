@@ -0,0 +1,64 @@
+/*
+ * Тесты определения типа запроса по ключу "type" через совершенный хэш.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o requests_test tests/requests_test.cpp \
+ *       $(find transport-catalogue -name '*.cpp' ! -name main.cpp)
+ */
+
+#include "test_framework.h"
+
+#include "requests.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace transport_catalogue::requesting;
+
+namespace {
+
+// Проверка выполняется при компиляции: таблица строится constexpr
+static_assert(GetRequestType("RouteMap"sv) == RequestType::ROUTE_MAP);
+static_assert(GetRequestType(""sv) == RequestType::UNKNOWN);
+
+void TestAllTypesFound() {
+    for (size_t i = 0; i < REQUEST_TYPES_COUNT; ++i) {
+        const auto type = static_cast<RequestType>(i);
+        const string_view name = GetRequestTypeName(type);
+        CHECK(!name.empty());
+        CHECK(GetRequestType(name) == type);
+    }
+    CHECK(GetRequestTypeName(RequestType::UNKNOWN).empty());
+}
+
+void TestNearMissesUnknown() {
+    // Совпадают длина, первый и последний символ с известными названиями или отличаются одним символом
+    for (const string_view name : {"Sxxp"sv, "Bas"sv, "Mop"sv, "MapTale"sv, "Rxxxe"sv, "RoutxMap"sv, "Stxts"sv,
+                                   "stop"sv, "BUS"sv, "Map "sv, " Map"sv, "MapTiles"sv, "Rout"sv, "RouteMa"sv,
+                                   "Stat"sv, "S"sv, "Unknown"sv, string_view("Bus\0"sv)}) {
+        CHECK(GetRequestType(name) == RequestType::UNKNOWN);
+    }
+}
+
+void TestEveryByteValue() {
+    // Хэш берёт символы как unsigned char: байты старше 127 не должны выводить за таблицу
+    for (int c = 0; c < 256; ++c) {
+        string first = "Map"s;
+        first.front() = static_cast<char>(c);
+        CHECK(GetRequestType(first) == (c == 'M' ? RequestType::MAP : RequestType::UNKNOWN));
+        string last = "Map"s;
+        last.back() = static_cast<char>(c);
+        CHECK(GetRequestType(last) == (c == 'p' ? RequestType::MAP : RequestType::UNKNOWN));
+    }
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestAllTypesFound);
+    RUN_TEST(runner, TestNearMissesUnknown);
+    RUN_TEST(runner, TestEveryByteValue);
+    return runner.GetExitCode();
+}
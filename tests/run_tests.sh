@@ -0,0 +1,25 @@
+#!/bin/sh
+# Собирает и запускает все тесты tests/*_test.cpp.
+# Запуск из корня репозитория: tests/run_tests.sh [каталог сборки]
+set -e
+
+build_dir=${1:-_test_build}
+flags="-std=c++17 -O2 -Wall -Wextra -pthread"
+mkdir -p "$build_dir"
+
+# Исходники справочника, кроме main.cpp, собираются один раз и компонуются с каждым тестом
+objects=""
+for source in $(find transport-catalogue -name '*.cpp' ! -name main.cpp | sort); do
+    object="$build_dir/$(basename "$source" .cpp).o"
+    g++ $flags -c -o "$object" "$source"
+    objects="$objects $object"
+done
+
+failed=0
+for test in tests/*_test.cpp; do
+    name=$(basename "$test" .cpp)
+    g++ $flags -I transport-catalogue -o "$build_dir/$name" "$test" $objects
+    echo "== $name"
+    "$build_dir/$name" || failed=1
+done
+exit $failed
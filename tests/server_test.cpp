@@ -0,0 +1,211 @@
+/*
+ * Тесты сервера: ответы на отдельные строки, обслуживание потока и Unix-сокета,
+ * защита чужих файлов по пути сокета, отказ от слишком длинных строк, остановка с открытыми соединениями.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o server_test tests/server_test.cpp \
+ *       $(find transport-catalogue -name '*.cpp' ! -name main.cpp)
+ */
+
+#include "test_documents.h"
+#include "test_framework.h"
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "server.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace std;
+using namespace transport_catalogue;
+using namespace transport_catalogue::serving;
+
+namespace {
+
+// Справочник, карта и маршрутизатор тестового города
+struct City {
+    City()
+        : document(testing::MakeCityDocument("[]"sv))
+        , reader(catalogue) {
+        reader.ProcessBaseRequests(document);
+        renderer.emplace(reader.ProcessRenderSettings(document), catalogue);
+        router.emplace(reader.ProcessRouterSettings(document), catalogue);
+    }
+
+    json::Document document;
+    database::TransportCatalogue catalogue;
+    processing::JsonReader reader;
+    optional<map_renderer::MapRenderer> renderer;
+    optional<routing::Router> router;
+};
+
+string MakeSocketPath(string_view name) {
+    return "/tmp/transport_catalogue_"s + string(name) + '_' + to_string(getpid()) + ".sock"s;
+}
+
+// Запускает ServeSocket в отдельном потоке и останавливает сервер при выходе из области видимости
+class RunningServer {
+public:
+    RunningServer(Server& server, const string& path)
+        : server_(server)
+        , thread_([&server, path] {
+            server.ServeSocket(path);
+        }) {
+        // Сокет готов, когда к нему удаётся подключиться
+        for (int attempt = 0; attempt < 500 && !CanConnect(path); ++attempt) {
+            this_thread::sleep_for(10ms);
+        }
+    }
+
+    ~RunningServer() {
+        server_.Stop();
+        thread_.join();
+    }
+
+    static int Connect(const string& path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.data(), path.size());
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+private:
+    static bool CanConnect(const string& path) {
+        const int fd = Connect(path);
+        if (fd < 0) {
+            return false;
+        }
+        close(fd);
+        return true;
+    }
+
+    Server& server_;
+    thread thread_;
+};
+
+void TestHandleLine() {
+    City city;
+    Server server(city.reader, *city.renderer, *city.router);
+    const string bus = server.HandleLine(R"({"id": 1, "type": "Bus", "name": "14"})"sv);
+    CHECK(bus.find("\"request_id\":1"s) != string::npos);
+    CHECK(bus.find('\n') == string::npos);
+    CHECK_EQUAL(server.HandleLine("garbage"sv), R"({"error_message":"invalid request"})"s);
+    CHECK_EQUAL(server.HandleLine(R"({"id": 2, "type": "Unknown"})"sv), R"({"error_message":"unknown request type"})"s);
+}
+
+void TestServeStream() {
+    City city;
+    Server server(city.reader, *city.renderer, *city.router);
+    istringstream input(R"({"id": 1, "type": "Stop", "name": "Airport"})"s + "\n\n"s
+                        + R"({"id": 2, "type": "Route", "from": "Airport", "to": "East"})"s + '\n');
+    ostringstream output;
+    server.Serve(input, output);
+
+    // Пустая строка пропускается, на каждый запрос — одна строка ответа
+    istringstream lines(output.str());
+    string first;
+    string second;
+    getline(lines, first);
+    getline(lines, second);
+    CHECK_EQUAL(first, server.HandleLine(R"({"id": 1, "type": "Stop", "name": "Airport"})"sv));
+    CHECK(second.find("\"total_time\""s) != string::npos);
+    CHECK(lines.peek() == char_traits<char>::eof());
+}
+
+void TestSocketServesClient() {
+    City city;
+    Server server(city.reader, *city.renderer, *city.router);
+    const string path = MakeSocketPath("serves_client"sv);
+    ostringstream output;
+    {
+        const RunningServer running(server, path);
+        istringstream input(R"({"id": 1, "type": "Bus", "name": "24"})"s + '\n' + "garbage\n"s);
+        RunClient(path, input, output);
+    }
+    CHECK_EQUAL(output.str(), server.HandleLine(R"({"id": 1, "type": "Bus", "name": "24"})"sv) + '\n'
+                + R"({"error_message":"invalid request"})"s + '\n');
+    unlink(path.c_str());
+}
+
+void TestSocketKeepsRegularFile() {
+    City city;
+    Server server(city.reader, *city.renderer, *city.router);
+    const string path = MakeSocketPath("regular_file"sv);
+    ofstream(path) << "data"s;
+    CHECK_THROWS(server.ServeSocket(path), runtime_error);
+
+    struct stat info;
+    CHECK(stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode));
+    unlink(path.c_str());
+}
+
+void TestLongLineRejected() {
+    City city;
+    Server server(city.reader, *city.renderer, *city.router);
+    const string path = MakeSocketPath("long_line"sv);
+    ostringstream output;
+    {
+        const RunningServer running(server, path);
+        istringstream input(string(Server::MAX_LINE_SIZE + 1, 'x'));
+        RunClient(path, input, output);
+    }
+    CHECK_EQUAL(output.str(), R"({"error_message":"request is too long"})"s + '\n');
+    unlink(path.c_str());
+}
+
+void TestStopClosesOpenConnections() {
+    City city;
+    Server server(city.reader, *city.renderer, *city.router);
+    const string path = MakeSocketPath("open_connections"sv);
+    int idle = -1;
+    {
+        const RunningServer running(server, path);
+        idle = RunningServer::Connect(path);
+        CHECK(idle >= 0);
+        // Ответ на запрос означает, что соединение принято и его поток ждёт следующей строки
+        const string request = R"({"id": 1, "type": "Stop", "name": "Lonely"})"s + '\n';
+        CHECK_EQUAL(send(idle, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+        char byte = 0;
+        while (byte != '\n' && recv(idle, &byte, 1, 0) == 1) {
+        }
+        CHECK_EQUAL(byte, '\n');
+        // Деструктор RunningServer дожидается ServeSocket, хотя соединение остаётся открытым
+    }
+    // Сервер закрыл своё направление соединения
+    char byte;
+    CHECK_EQUAL(recv(idle, &byte, 1, 0), 0);
+    close(idle);
+    unlink(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestHandleLine);
+    RUN_TEST(runner, TestServeStream);
+    RUN_TEST(runner, TestSocketServesClient);
+    RUN_TEST(runner, TestSocketKeepsRegularFile);
+    RUN_TEST(runner, TestLongLineRejected);
+    RUN_TEST(runner, TestStopClosesOpenConnections);
+    return runner.GetExitCode();
+}
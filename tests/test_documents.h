@@ -0,0 +1,63 @@
+#pragma once
+
+#include "json.h"
+
+#include <string>
+#include <string_view>
+
+/*
+ * Небольшой город для тестов: шесть остановок, три маршрута, кольцевой и некольцевые.
+ * Расстояния подобраны так, что у части маршрутов есть равные по времени варианты
+ */
+
+namespace testing {
+
+inline const std::string CITY_BASE_REQUESTS = R"([
+    {"type": "Stop", "name": "Airport", "latitude": 55.60, "longitude": 37.60,
+     "road_distances": {"Bridge": 2000, "Forest": 3000}},
+    {"type": "Stop", "name": "Bridge", "latitude": 55.62, "longitude": 37.62,
+     "road_distances": {"Center": 2000, "Docks": 1500}},
+    {"type": "Stop", "name": "Center", "latitude": 55.64, "longitude": 37.60,
+     "road_distances": {"Airport": 4000}},
+    {"type": "Stop", "name": "Docks", "latitude": 55.63, "longitude": 37.66,
+     "road_distances": {"East": 1500}},
+    {"type": "Stop", "name": "East", "latitude": 55.61, "longitude": 37.68,
+     "road_distances": {"Forest": 3000}},
+    {"type": "Stop", "name": "Forest", "latitude": 55.59, "longitude": 37.64,
+     "road_distances": {}},
+    {"type": "Stop", "name": "Lonely", "latitude": 55.70, "longitude": 37.70,
+     "road_distances": {}},
+    {"type": "Bus", "name": "14", "stops": ["Airport", "Bridge", "Center", "Airport"], "is_roundtrip": true},
+    {"type": "Bus", "name": "24", "stops": ["Bridge", "Docks", "East"], "is_roundtrip": false},
+    {"type": "Bus", "name": "750", "stops": ["Airport", "Forest", "East"], "is_roundtrip": false}
+])";
+
+inline const std::string CITY_SETTINGS = R"(
+    "render_settings": {
+        "width": 600, "height": 400, "padding": 30,
+        "line_width": 8, "stop_radius": 4,
+        "bus_label_font_size": 16, "bus_label_offset": [7, 15],
+        "stop_label_font_size": 12, "stop_label_offset": [7, -3],
+        "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3,
+        "color_palette": ["green", [255, 160, 0], "red"]
+    },
+    "routing_settings": {"bus_velocity": 40, "bus_wait_time": 6}
+)";
+
+// Текст входного документа города с заданным массивом stat_requests
+inline std::string MakeCityText(std::string_view stat_requests) {
+    std::string text = "{\"base_requests\": ";
+    text += CITY_BASE_REQUESTS;
+    text += ',';
+    text += CITY_SETTINGS;
+    text += ", \"stat_requests\": ";
+    text += stat_requests;
+    text += '}';
+    return text;
+}
+
+inline json::Document MakeCityDocument(std::string_view stat_requests) {
+    return json::LoadBuffer(MakeCityText(stat_requests));
+}
+
+}  // namespace testing
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/*
+ * Проверки для тестов. Каждый тест — отдельная программа, функции-тесты запускаются через RUN_TEST.
+ * Упавшая проверка прерывает свой тест, остальные тесты выполняются; итог выводится в stderr,
+ * код возврата программы ненулевой, если упал хотя бы один тест
+ */
+
+namespace testing {
+
+class CheckFailure : public std::runtime_error {
+public:
+    using runtime_error::runtime_error;
+};
+
+class TestRunner {
+public:
+    template <typename Test>
+    void Run(Test test, std::string_view name) {
+        try {
+            test();
+            std::cerr << name << " OK" << std::endl;
+        } catch (const std::exception& e) {
+            ++failed_;
+            std::cerr << name << " failed: " << e.what() << std::endl;
+        }
+    }
+
+    int GetExitCode() const {
+        if (failed_ > 0) {
+            std::cerr << failed_ << " test(s) failed" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    int failed_ = 0;
+};
+
+inline void Check(bool value, std::string_view expression, std::string_view file, int line) {
+    if (!value) {
+        std::ostringstream message;
+        message << file << ':' << line << ": CHECK(" << expression << ')';
+        throw CheckFailure(message.str());
+    }
+}
+
+template <typename Lhs, typename Rhs>
+void CheckEqual(const Lhs& lhs, const Rhs& rhs, std::string_view lhs_expression, std::string_view rhs_expression,
+                std::string_view file, int line) {
+    if (!(lhs == rhs)) {
+        std::ostringstream message;
+        message << file << ':' << line << ": " << lhs_expression << " != " << rhs_expression
+                << " (" << lhs << " != " << rhs << ')';
+        throw CheckFailure(message.str());
+    }
+}
+
+// Проверяет, что action выбрасывает Exception
+template <typename Exception, typename Action>
+void CheckThrows(Action action, std::string_view expression, std::string_view file, int line) {
+    try {
+        action();
+    } catch (const Exception&) {
+        return;
+    }
+    std::ostringstream message;
+    message << file << ':' << line << ": " << expression << " did not throw";
+    throw CheckFailure(message.str());
+}
+
+}  // namespace testing
+
+#define CHECK(expr) ::testing::Check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+#define CHECK_EQUAL(lhs, rhs) ::testing::CheckEqual((lhs), (rhs), #lhs, #rhs, __FILE__, __LINE__)
+#define CHECK_THROWS(expr, Exception) \
+    ::testing::CheckThrows<Exception>([&] { (void)(expr); }, #expr, __FILE__, __LINE__)
+#define RUN_TEST(runner, test) (runner).Run((test), #test)
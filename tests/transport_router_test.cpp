@@ -0,0 +1,244 @@
+/*
+ * Тесты маршрутизатора: все способы поиска отвечают тем же маршрутом с той же длительностью, что и
+ * graph::Router<double>, планировщик выбирает способ по нагрузке и бюджету памяти.
+ * Сборка из корня репозитория:
+ *   g++ -std=c++17 -O2 -pthread -I transport-catalogue -o transport_router_test tests/transport_router_test.cpp \
+ *       $(find transport-catalogue -name '*.cpp' ! -name main.cpp)
+ */
+
+#include "test_documents.h"
+#include "test_framework.h"
+
+#include "graph.h"
+#include "json_reader.h"
+#include "router.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cmath>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace transport_catalogue;
+using namespace transport_catalogue::routing;
+
+namespace {
+
+const RoutingSettings SETTINGS{6, 40};
+const RoutingEngine ENGINES[] = {RoutingEngine::ALL_PAIRS, RoutingEngine::ON_DEMAND, RoutingEngine::HIERARCHY};
+
+void FillCity(database::TransportCatalogue& catalogue) {
+    processing::JsonReader reader(catalogue);
+    reader.ProcessBaseRequests(testing::MakeCityDocument("[]"sv));
+}
+
+// Сетка size x size остановок с маршрутом по каждой строке и каждому столбцу. Между соседними остановками
+// distance метров, поэтому между большинством пар остановок есть несколько маршрутов равной длительности
+void FillGridCity(database::TransportCatalogue& catalogue, int size, int distance) {
+    const auto name = [](int row, int column) {
+        return "r"s + to_string(row) + "c"s + to_string(column);
+    };
+    vector<string> names;
+    for (int row = 0; row < size; ++row) {
+        for (int column = 0; column < size; ++column) {
+            names.push_back(name(row, column));
+            catalogue.AddStop(names.back(), {55.6 + 0.01 * row, 37.6 + 0.01 * column});
+        }
+    }
+    for (int row = 0; row < size; ++row) {
+        for (int column = 0; column + 1 < size; ++column) {
+            const Stop* left = *catalogue.GetStopInfo(name(row, column));
+            const Stop* right = *catalogue.GetStopInfo(name(row, column + 1));
+            const Stop* top = *catalogue.GetStopInfo(name(column, row));
+            const Stop* bottom = *catalogue.GetStopInfo(name(column + 1, row));
+            catalogue.SetDistance(left, right, distance);
+            catalogue.SetDistance(top, bottom, distance);
+        }
+    }
+    for (int line = 0; line < size; ++line) {
+        vector<string_view> row_stops;
+        vector<string_view> column_stops;
+        for (int i = 0; i < size; ++i) {
+            row_stops.push_back(names[line * size + i]);
+            column_stops.push_back(names[i * size + line]);
+        }
+        catalogue.AddRoute("row "s + to_string(line), row_stops, false);
+        catalogue.AddRoute("column "s + to_string(line), column_stops, false);
+    }
+}
+
+Router MakeRouter(const database::TransportCatalogue& catalogue, RoutingEngine engine) {
+    RoutingOptions options;
+    options.engine = engine;
+    return Router(SETTINGS, catalogue, {}, options);
+}
+
+vector<string_view> GetStopNames(const database::TransportCatalogue& catalogue) {
+    vector<string_view> names;
+    const auto stops = catalogue.GetAllStops();
+    for (const auto* stop : *stops) {
+        names.push_back(stop->name);
+    }
+    return names;
+}
+
+// Маршрут из from в to: ожидание на from, затем чередование поездок и ожиданий, последняя поездка приходит в to
+void CheckRouteValid(const Router& router, const RouteData& route, string_view from, string_view to) {
+    if (from == to) {
+        CHECK(route.edges.empty());
+        CHECK_EQUAL(route.total_time, 0.0);
+        return;
+    }
+    CHECK(!route.edges.empty());
+    double total_time = 0;
+    for (size_t i = 0; i < route.edges.size(); ++i) {
+        const RouteEdge& edge = router.GetEdge(route.edges[i]);
+        CHECK_EQUAL(edge.span_count == 0, i % 2 == 0);
+        if (i > 0) {
+            CHECK_EQUAL(edge.from, router.GetEdge(route.edges[i - 1]).to);
+        }
+        total_time += edge.weight;
+    }
+    CHECK_EQUAL(router.GetEdge(route.edges.front()).name, string(from));
+    CHECK(abs(route.total_time - total_time) <= 1e-9 * total_time);
+    const vector<RouteLeg> legs = router.GetRouteLegs(route);
+    CHECK_EQUAL(legs.back().stops.back()->name, string(to));
+}
+
+// Поиск по запросу и иерархия выбирают тот же маршрут, что и матрица всех пар, и длительности совпадают побайтно
+void CheckEnginesAgree(const database::TransportCatalogue& catalogue) {
+    const Router all_pairs = MakeRouter(catalogue, RoutingEngine::ALL_PAIRS);
+    const Router on_demand = MakeRouter(catalogue, RoutingEngine::ON_DEMAND);
+    const Router hierarchy = MakeRouter(catalogue, RoutingEngine::HIERARCHY);
+    const vector<string_view> stops = GetStopNames(catalogue);
+    for (const string_view from : stops) {
+        for (const string_view to : stops) {
+            const auto expected = all_pairs.FindRoute(from, to);
+            const auto on_demand_route = on_demand.FindRoute(from, to);
+            const auto hierarchy_route = hierarchy.FindRoute(from, to);
+            CHECK_EQUAL(on_demand_route.has_value(), expected.has_value());
+            CHECK_EQUAL(hierarchy_route.has_value(), expected.has_value());
+            if (!expected) {
+                continue;
+            }
+            CheckRouteValid(all_pairs, *expected, from, to);
+            for (const auto* route : {&*on_demand_route, &*hierarchy_route}) {
+                CHECK(route->edges == expected->edges);
+                CHECK_EQUAL(route->total_time, expected->total_time);
+            }
+        }
+    }
+}
+
+void TestEnginesAgreeOnCity() {
+    database::TransportCatalogue catalogue;
+    FillCity(catalogue);
+    CHECK(!MakeRouter(catalogue, RoutingEngine::ON_DEMAND).FindRoute("Airport"sv, "Lonely"sv));
+    CheckEnginesAgree(catalogue);
+}
+
+void TestEnginesAgreeOnGrid() {
+    // 1000 м проезжаются за 1.5 минуты точно, 1100 м — за время, не представимое точно
+    for (const int distance : {1000, 1100}) {
+        database::TransportCatalogue catalogue;
+        FillGridCity(catalogue, 4, distance);
+        CheckEnginesAgree(catalogue);
+    }
+}
+
+void TestEnginesMatchDoubleRouter() {
+    for (const int distance : {1000, 1100}) {
+        database::TransportCatalogue catalogue;
+        FillGridCity(catalogue, 4, distance);
+        const Router router = MakeRouter(catalogue, RoutingEngine::ALL_PAIRS);
+
+        // Копия графа маршрутизатора для graph::Router<double> на всём графе
+        const vector<string_view> stops = GetStopNames(catalogue);
+        size_t edge_count = stops.size();
+        const auto buses = catalogue.GetAllBuses();
+        for (const auto* bus : *buses) {
+            edge_count += bus->stops.size() * (bus->stops.size() - 1) / 2;
+        }
+        graph::DirectedWeightedGraph<double> graph(stops.size() * 2);
+        for (graph::EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const RouteEdge& edge = router.GetEdge(edge_id);
+            graph.AddEdge({edge.name, edge.span_count, edge.from, edge.to, edge.weight});
+        }
+        const graph::Router<double> reference(graph);
+
+        for (const RoutingEngine engine : ENGINES) {
+            const Router engine_router = MakeRouter(catalogue, engine);
+            for (size_t from = 0; from < stops.size(); ++from) {
+                for (size_t to = 0; to < stops.size(); ++to) {
+                    const auto expected = reference.BuildRoute(from * 2, to * 2);
+                    const auto route = engine_router.FindRoute(stops[from], stops[to]);
+                    CHECK(expected && route);
+                    CHECK_EQUAL(route->total_time, expected->weight);
+                    CHECK(route->edges == expected->edges);
+                }
+            }
+        }
+    }
+}
+
+void TestPlanWithKnownLoad() {
+    const GraphSize small{14, 33};
+    // Матрица всех пар маленькой сети строится быстрее поисков из каждой остановки
+    CHECK(PlanRouting(small, {100, 7}, {}).engine == RoutingEngine::ALL_PAIRS);
+
+    const GraphSize large{20000, 400000};
+    // Несколько начальных остановок: их деревья маршрутов быстрее иерархии
+    CHECK(PlanRouting(large, {10, 5}, {}).engine == RoutingEngine::ON_DEMAND);
+    // Ни матрица, ни деревья всех начальных остановок не помещаются в бюджет: на каждый запрос иерархия
+    // отвечает быстрее поиска
+    const auto plan = PlanRouting(large, {100000, 10000}, {});
+    CHECK(plan.estimates[static_cast<size_t>(RoutingEngine::ALL_PAIRS)].memory > DEFAULT_ROUTER_MEMORY_BUDGET);
+    CHECK(plan.engine == RoutingEngine::HIERARCHY);
+}
+
+void TestPlanWithUnknownLoad() {
+    // Деревья из всех остановок маленькой сети помещаются в бюджет, матрица всех пар не строится,
+    // хотя тоже помещается
+    const GraphSize small{14, 33};
+    const auto small_plan = PlanRouting(small, {}, {});
+    CHECK(small_plan.estimates[static_cast<size_t>(RoutingEngine::ALL_PAIRS)].memory <= DEFAULT_ROUTER_MEMORY_BUDGET);
+    CHECK(small_plan.engine == RoutingEngine::ON_DEMAND);
+
+    // В большой сети деревья всех остановок не помещаются, иерархия помещается
+    const GraphSize large{20000, 400000};
+    CHECK(PlanRouting(large, {}, {}).engine == RoutingEngine::HIERARCHY);
+
+    // Если не помещается ничего, выбирается самый экономный способ
+    RoutingOptions tight;
+    tight.memory_budget = 1 << 20;
+    const auto tight_plan = PlanRouting(large, {}, tight);
+    for (const auto& estimate : tight_plan.estimates) {
+        CHECK(tight_plan.estimates[static_cast<size_t>(tight_plan.engine)].memory <= estimate.memory);
+    }
+}
+
+void TestPlanHonoursExplicitEngine() {
+    const GraphSize large{20000, 400000};
+    for (const RoutingEngine engine : ENGINES) {
+        RoutingOptions options;
+        options.engine = engine;
+        CHECK(PlanRouting(large, {}, options).engine == engine);
+        CHECK(PlanRouting(large, {100000, 10000}, options).engine == engine);
+    }
+}
+
+}  // namespace
+
+int main() {
+    testing::TestRunner runner;
+    RUN_TEST(runner, TestEnginesAgreeOnCity);
+    RUN_TEST(runner, TestEnginesAgreeOnGrid);
+    RUN_TEST(runner, TestEnginesMatchDoubleRouter);
+    RUN_TEST(runner, TestPlanWithKnownLoad);
+    RUN_TEST(runner, TestPlanWithUnknownLoad);
+    RUN_TEST(runner, TestPlanHonoursExplicitEngine);
+    return runner.GetExitCode();
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "graph.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Поиск маршрутов алгоритмом Дейкстры по запросу. Дерево кратчайших маршрутов из начальной вершины
+// запоминается целиком, и следующие запросы из неё обходятся без поиска. Деревья занимают
+// не больше max_cached_bytes, при переполнении кэш очищается целиком. BuildRoute можно вызывать
+// из нескольких потоков: поиск идёт без блокировки, одно дерево могут построить два потока сразу
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    DijkstraRouter(const Graph& graph, size_t max_cached_bytes);
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Веса кратчайших маршрутов из from: функция от конечной вершины, nullopt для недостижимой.
+    // Дерево маршрутов берётся из кэша или строится, как в BuildRoute
+    std::function<std::optional<Weight>(VertexId)> GetDistances(VertexId from) const;
+
+    memory::MemoryUsage GetMemoryUsage() const;
+    // Память trees_count запомненных деревьев
+    static memory::MemoryUsage EstimateMemoryUsage(size_t vertex_count, size_t trees_count);
+    // Сколько деревьев помещается в max_cached_bytes; хотя бы одно запоминается всегда
+    static size_t GetMaxCachedTrees(size_t vertex_count, size_t max_cached_bytes);
+
+private:
+    struct RouteInternalData {
+        Weight weight;
+        std::optional<EdgeId> prev_edge;
+    };
+    using RoutesTree = std::vector<std::optional<RouteInternalData>>;
+
+    std::shared_ptr<const RoutesTree> GetRoutesTree(VertexId from) const;
+    RoutesTree BuildRoutesTree(VertexId from) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    const size_t max_cached_trees_;
+    mutable std::mutex trees_mutex_;
+    mutable std::unordered_map<VertexId, std::shared_ptr<const RoutesTree>> routes_trees_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, size_t max_cached_bytes)
+    : graph_(graph)
+    , max_cached_trees_(GetMaxCachedTrees(graph.GetVertexCount(), max_cached_bytes))
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    const auto routes_tree = GetRoutesTree(from);
+    const auto& route_internal_data = routes_tree->at(to);
+    if (!route_internal_data) {
+        return std::nullopt;
+    }
+    const Weight weight = route_internal_data->weight;
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
+         edge_id;
+         edge_id = (*routes_tree)[graph_.GetEdge(*edge_id).from]->prev_edge)
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::function<std::optional<Weight>(VertexId)> DijkstraRouter<Weight>::GetDistances(VertexId from) const {
+    return [routes_tree = GetRoutesTree(from)](VertexId to) -> std::optional<Weight> {
+        if (const auto& route = routes_tree->at(to)) {
+            return route->weight;
+        }
+        return std::nullopt;
+    };
+}
+
+template <typename Weight>
+memory::MemoryUsage DijkstraRouter<Weight>::GetMemoryUsage() const {
+    std::lock_guard lock(trees_mutex_);
+    size_t bytes = memory::GetHashTableBytes(routes_trees_);
+    for (const auto& [vertex, routes_tree] : routes_trees_) {
+        bytes += sizeof(RoutesTree) + memory::GetVectorBytes(*routes_tree);
+    }
+    return {{"routes_trees", bytes}};
+}
+
+template <typename Weight>
+memory::MemoryUsage DijkstraRouter<Weight>::EstimateMemoryUsage(size_t vertex_count, size_t trees_count) {
+    return {{"routes_trees",
+             trees_count * (sizeof(RoutesTree) + vertex_count * sizeof(typename RoutesTree::value_type))}};
+}
+
+template <typename Weight>
+size_t DijkstraRouter<Weight>::GetMaxCachedTrees(size_t vertex_count, size_t max_cached_bytes) {
+    const size_t tree_bytes = sizeof(RoutesTree) + vertex_count * sizeof(typename RoutesTree::value_type);
+    return std::max<size_t>(1, max_cached_bytes / tree_bytes);
+}
+
+template <typename Weight>
+std::shared_ptr<const typename DijkstraRouter<Weight>::RoutesTree>
+    DijkstraRouter<Weight>::GetRoutesTree(VertexId from) const {
+    {
+        std::lock_guard lock(trees_mutex_);
+        if (const auto it = routes_trees_.find(from); it != routes_trees_.end()) {
+            return it->second;
+        }
+    }
+
+    auto routes_tree = std::make_shared<const RoutesTree>(BuildRoutesTree(from));
+    std::lock_guard lock(trees_mutex_);
+    if (routes_trees_.size() >= max_cached_trees_) {
+        routes_trees_.clear();
+    }
+    routes_trees_.emplace(from, routes_tree);
+    return routes_tree;
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::RoutesTree DijkstraRouter<Weight>::BuildRoutesTree(VertexId from) const {
+    RoutesTree routes_tree(graph_.GetVertexCount());
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+
+    routes_tree.at(from) = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+    queue.push({ZERO_WEIGHT, from});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (routes_tree[vertex]->weight < weight) {
+            continue;
+        }
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = weight + edge.weight;
+            auto& route = routes_tree[edge.to];
+            if (!route || candidate_weight < route->weight) {
+                route = RouteInternalData{candidate_weight, edge_id};
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+    return routes_tree;
+}
+
+}  // namespace graph
@@ -20,6 +20,13 @@ struct Bus {
     bool is_circular;
 };
     
+// Участок найденного маршрута: ожидание на остановке stops[0] (bus равен nullptr)
+// или поездка на автобусе bus через остановки stops
+struct RouteLeg {
+    const Bus* bus = nullptr;
+    std::vector<const Stop*> stops;
+};
+    
 struct BusInfo {
     std::string name;
     size_t stops_count;
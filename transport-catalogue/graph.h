@@ -1,5 +1,6 @@
 #pragma once
 
+#include "memory_usage.h"
 #include "ranges.h"
 
 #include <cstdlib>
@@ -36,6 +37,11 @@ public:
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+    memory::MemoryUsage GetMemoryUsage() const;
+    // Оценка памяти графа, построенного вызовами AddEdge, по числу вершин и рёбер.
+    // Названия рёбер считаются помещающимися во внутренний буфер строки
+    static memory::MemoryUsage EstimateMemoryUsage(size_t vertex_count, size_t edge_count);
+
 private:
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
@@ -75,4 +81,29 @@ typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
 
+template <typename Weight>
+memory::MemoryUsage DirectedWeightedGraph<Weight>::GetMemoryUsage() const {
+    size_t edges_bytes = memory::GetVectorBytes(edges_);
+    for (const auto& edge : edges_) {
+        edges_bytes += memory::GetStringBytes(edge.name);
+    }
+    size_t incidence_lists_bytes = memory::GetVectorBytes(incidence_lists_);
+    for (const auto& incidence_list : incidence_lists_) {
+        incidence_lists_bytes += memory::GetVectorBytes(incidence_list);
+    }
+    return {{"edges", edges_bytes}, {"incidence_lists", incidence_lists_bytes}};
+}
+
+template <typename Weight>
+memory::MemoryUsage DirectedWeightedGraph<Weight>::EstimateMemoryUsage(size_t vertex_count, size_t edge_count) {
+    size_t incidence_lists_bytes = vertex_count * sizeof(IncidenceList);
+    if (vertex_count > 0) {
+        // Рёбра считаются распределёнными по вершинам поровну
+        const size_t list_size = (edge_count + vertex_count - 1) / vertex_count;
+        incidence_lists_bytes += vertex_count * memory::GetGrowthCapacity(list_size) * sizeof(EdgeId);
+    }
+    return {{"edges", memory::GetGrowthCapacity(edge_count) * sizeof(Edge<Weight>)},
+            {"incidence_lists", incidence_lists_bytes}};
+}
+
 }  // namespace graph
\ No newline at end of file
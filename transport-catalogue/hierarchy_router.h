@@ -0,0 +1,500 @@
+#pragma once
+
+#include "graph.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Иерархия сокращений (contraction hierarchies). Вершины по очереди исключаются из графа, начиная с тех,
+ * исключение которых добавляет меньше всего рёбер; кратчайшие пути через исключаемую вершину заменяются
+ * рёбрами-сокращениями. Маршрут ищется двумя встречными поисками Дейкстры, которые идут только к вершинам,
+ * исключённым позже, и просматривают малую часть графа. Найденный путь раскрывается в рёбра исходного графа.
+ * Если кратчайший путь единственный, найден будет он же, что и полным поиском. BuildRoute можно вызывать
+ * из нескольких потоков: каждый поиск берёт из пула свои массивы меток
+ */
+template <typename Weight>
+class HierarchyRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit HierarchyRouter(const Graph& graph);
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    memory::MemoryUsage GetMemoryUsage() const;
+    // Оценка по числу вершин и рёбер исходного графа; число сокращений принимается равным
+    // SHORTCUTS_PER_EDGE на ребро. На синтетических городах их было от 0 до 1.2 на ребро, больше в крупных
+    static memory::MemoryUsage EstimateMemoryUsage(size_t vertex_count, size_t edge_count);
+
+    static constexpr double SHORTCUTS_PER_EDGE = 1.0;
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    // Поиск пути в обход исключаемой вершины останавливается после стольких вершин.
+    // Не найденный из-за этого обход добавляет лишнее сокращение, но не портит результат
+    static constexpr size_t WITNESS_SETTLED_LIMIT = 64;
+    static constexpr Weight ZERO_WEIGHT{};
+
+    // Ребро исходного графа с номером first или сокращение, заменяющее путь из рёбер иерархии first и second
+    struct HierarchyEdge {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first;
+        EdgeId second = NO_EDGE;
+    };
+
+    // Рёбра между ещё не исключёнными вершинами и данные поиска обходных путей
+    struct ContractionState {
+        std::vector<std::vector<EdgeId>> outgoing;
+        std::vector<std::vector<EdgeId>> incoming;
+        std::vector<bool> contracted;
+        std::vector<int> contracted_neighbours;
+        std::vector<std::optional<Weight>> witness_weights;
+        std::vector<VertexId> witness_touched;
+    };
+
+    struct Label {
+        Weight weight;
+        EdgeId edge;
+    };
+    // Метки вершин одного направления поиска; после поиска сбрасываются только задетые
+    struct Labels {
+        std::vector<std::optional<Label>> labels;
+        std::vector<VertexId> touched;
+    };
+    struct SearchState {
+        Labels forward;
+        Labels backward;
+    };
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+
+    void AddGraphEdges(const Graph& graph, ContractionState& state);
+    void Contract(ContractionState& state);
+    // Число сокращений, нужных для исключения vertex; при add они добавляются в граф
+    int ContractVertex(ContractionState& state, VertexId vertex, bool add);
+    // Расстояния от from до вершин в пределах max_weight в обход excluded, не все из них кратчайшие
+    void FindWitnesses(ContractionState& state, VertexId from, VertexId excluded, const Weight& max_weight) const;
+    void ClearWitnesses(ContractionState& state) const;
+    void AddShortcut(ContractionState& state, VertexId from, VertexId to, const Weight& weight,
+                     EdgeId first, EdgeId second);
+    int GetPriority(ContractionState& state, VertexId vertex);
+
+    // Шаг поиска в одном направлении; возвращает false, если поиск в этом направлении закончен
+    bool SearchStep(Queue& queue, Labels& labels, const Labels& opposite, bool forward,
+                    std::optional<Weight>& best_weight, VertexId& meeting) const;
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+    std::unique_ptr<SearchState> AcquireSearchState() const;
+    void ReleaseSearchState(std::unique_ptr<SearchState> state) const;
+
+    const Graph& graph_;
+    std::vector<HierarchyEdge> edges_;
+    // Рёбра к вершинам, исключённым позже: исходящие для прямого поиска и входящие для обратного
+    std::vector<std::vector<EdgeId>> upward_outgoing_;
+    std::vector<std::vector<EdgeId>> upward_incoming_;
+    // Массивы меток, освободившиеся после поисков; их не больше, чем поисков, шедших одновременно
+    mutable std::mutex search_states_mutex_;
+    mutable std::vector<std::unique_ptr<SearchState>> search_states_;
+};
+
+template <typename Weight>
+HierarchyRouter<Weight>::HierarchyRouter(const Graph& graph)
+    : graph_(graph)
+    , upward_outgoing_(graph.GetVertexCount())
+    , upward_incoming_(graph.GetVertexCount())
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    ContractionState state{
+        std::vector<std::vector<EdgeId>>(vertex_count),
+        std::vector<std::vector<EdgeId>>(vertex_count),
+        std::vector<bool>(vertex_count),
+        std::vector<int>(vertex_count),
+        std::vector<std::optional<Weight>>(vertex_count),
+        {}
+    };
+    AddGraphEdges(graph, state);
+    Contract(state);
+    edges_.shrink_to_fit();
+}
+
+template <typename Weight>
+std::optional<typename HierarchyRouter<Weight>::RouteInfo> HierarchyRouter<Weight>::BuildRoute(VertexId from,
+                                                                                               VertexId to) const {
+    std::unique_ptr<SearchState> state = AcquireSearchState();
+    Labels& forward_labels = state->forward;
+    Labels& backward_labels = state->backward;
+    Queue forward_queue;
+    Queue backward_queue;
+    forward_labels.labels[from] = Label{ZERO_WEIGHT, NO_EDGE};
+    forward_labels.touched.push_back(from);
+    backward_labels.labels[to] = Label{ZERO_WEIGHT, NO_EDGE};
+    backward_labels.touched.push_back(to);
+    forward_queue.push({ZERO_WEIGHT, from});
+    backward_queue.push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting = from;
+    bool forward_active = true;
+    bool backward_active = true;
+    while (forward_active || backward_active) {
+        const bool forward = forward_active
+            && (!backward_active || !(backward_queue.top().first < forward_queue.top().first));
+        if (forward) {
+            forward_active = SearchStep(forward_queue, forward_labels, backward_labels, true, best_weight, meeting);
+        } else {
+            backward_active = SearchStep(backward_queue, backward_labels, forward_labels, false, best_weight,
+                                         meeting);
+        }
+    }
+    std::vector<EdgeId> path;
+    if (best_weight) {
+        for (EdgeId edge_id = forward_labels.labels[meeting]->edge; edge_id != NO_EDGE;
+             edge_id = forward_labels.labels[edges_[edge_id].from]->edge) {
+            path.push_back(edge_id);
+        }
+        std::reverse(path.begin(), path.end());
+        for (EdgeId edge_id = backward_labels.labels[meeting]->edge; edge_id != NO_EDGE;
+             edge_id = backward_labels.labels[edges_[edge_id].to]->edge) {
+            path.push_back(edge_id);
+        }
+    }
+    ReleaseSearchState(std::move(state));
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId edge_id : path) {
+        UnpackEdge(edge_id, edges);
+    }
+    // Вес складывается вдоль маршрута, как при поиске из начальной вершины
+    Weight weight = ZERO_WEIGHT;
+    for (const EdgeId edge_id : edges) {
+        weight = weight + graph_.GetEdge(edge_id).weight;
+    }
+    return RouteInfo{weight, std::move(edges)};
+}
+
+template <typename Weight>
+memory::MemoryUsage HierarchyRouter<Weight>::GetMemoryUsage() const {
+    size_t upward_bytes = memory::GetVectorBytes(upward_outgoing_) + memory::GetVectorBytes(upward_incoming_);
+    for (VertexId vertex = 0; vertex < upward_outgoing_.size(); ++vertex) {
+        upward_bytes += memory::GetVectorBytes(upward_outgoing_[vertex])
+            + memory::GetVectorBytes(upward_incoming_[vertex]);
+    }
+    std::lock_guard lock(search_states_mutex_);
+    size_t search_bytes = memory::GetVectorBytes(search_states_);
+    for (const auto& state : search_states_) {
+        search_bytes += sizeof(SearchState);
+        for (const Labels* labels : {&state->forward, &state->backward}) {
+            search_bytes += memory::GetVectorBytes(labels->labels) + memory::GetVectorBytes(labels->touched);
+        }
+    }
+    return {{"edges", memory::GetVectorBytes(edges_)}, {"search_states", search_bytes},
+            {"upward_edges", upward_bytes}};
+}
+
+template <typename Weight>
+memory::MemoryUsage HierarchyRouter<Weight>::EstimateMemoryUsage(size_t vertex_count, size_t edge_count) {
+    const auto hierarchy_edges = static_cast<size_t>(static_cast<double>(edge_count) * (1 + SHORTCUTS_PER_EDGE));
+    // Меток для одного поиска; метки задетых вершин запоминаются в touched
+    const size_t search_bytes = sizeof(SearchState)
+        + 2 * vertex_count * (sizeof(std::optional<Label>) + sizeof(VertexId));
+    return {{"edges", hierarchy_edges * sizeof(HierarchyEdge)},
+            {"search_states", search_bytes},
+            {"upward_edges", 2 * vertex_count * sizeof(std::vector<EdgeId>) + hierarchy_edges * sizeof(EdgeId)}};
+}
+
+template <typename Weight>
+void HierarchyRouter<Weight>::AddGraphEdges(const Graph& graph, ContractionState& state) {
+    // Из параллельных рёбер остаётся самое лёгкое, при равных весах — с меньшим номером
+    std::unordered_map<VertexId, EdgeId> edges_by_target;
+    for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+        edges_by_target.clear();
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (edge.to == vertex) {
+                continue;
+            }
+            const auto [it, inserted] = edges_by_target.emplace(edge.to, edges_.size());
+            if (!inserted) {
+                HierarchyEdge& existing = edges_[it->second];
+                if (edge.weight < existing.weight) {
+                    existing.weight = edge.weight;
+                    existing.first = edge_id;
+                }
+                continue;
+            }
+            edges_.push_back({vertex, edge.to, edge.weight, edge_id});
+            state.outgoing[vertex].push_back(it->second);
+            state.incoming[edge.to].push_back(it->second);
+        }
+    }
+}
+
+template <typename Weight>
+void HierarchyRouter<Weight>::Contract(ContractionState& state) {
+    using PriorityItem = std::pair<int, VertexId>;
+    std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<>> queue;
+    for (VertexId vertex = 0; vertex < graph_.GetVertexCount(); ++vertex) {
+        queue.push({GetPriority(state, vertex), vertex});
+    }
+
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        // Приоритет мог вырасти после исключения соседей; тогда вершина возвращается в очередь
+        const int priority = GetPriority(state, vertex);
+        if (!queue.empty() && priority > queue.top().first) {
+            queue.push({priority, vertex});
+            continue;
+        }
+
+        upward_outgoing_[vertex] = state.outgoing[vertex];
+        upward_incoming_[vertex] = state.incoming[vertex];
+        ContractVertex(state, vertex, true);
+        state.contracted[vertex] = true;
+
+        for (const EdgeId edge_id : state.outgoing[vertex]) {
+            auto& incoming = state.incoming[edges_[edge_id].to];
+            incoming.erase(std::find(incoming.begin(), incoming.end(), edge_id));
+            ++state.contracted_neighbours[edges_[edge_id].to];
+        }
+        for (const EdgeId edge_id : state.incoming[vertex]) {
+            auto& outgoing = state.outgoing[edges_[edge_id].from];
+            outgoing.erase(std::find(outgoing.begin(), outgoing.end(), edge_id));
+            ++state.contracted_neighbours[edges_[edge_id].from];
+        }
+        state.outgoing[vertex] = {};
+        state.incoming[vertex] = {};
+    }
+}
+
+template <typename Weight>
+int HierarchyRouter<Weight>::ContractVertex(ContractionState& state, VertexId vertex, bool add) {
+    int shortcuts = 0;
+    for (const EdgeId incoming_id : state.incoming[vertex]) {
+        const VertexId from = edges_[incoming_id].from;
+        const Weight incoming_weight = edges_[incoming_id].weight;
+
+        // Обходной путь можно найти, только если в цель ведут рёбра не из vertex
+        std::optional<Weight> max_weight;
+        bool witness_possible = false;
+        for (const EdgeId outgoing_id : state.outgoing[vertex]) {
+            const HierarchyEdge& outgoing = edges_[outgoing_id];
+            if (outgoing.to == from) {
+                continue;
+            }
+            const Weight weight = incoming_weight + outgoing.weight;
+            if (!max_weight || *max_weight < weight) {
+                max_weight = weight;
+            }
+            witness_possible = witness_possible || state.incoming[outgoing.to].size() > 1;
+        }
+        if (!max_weight) {
+            continue;
+        }
+        if (witness_possible) {
+            FindWitnesses(state, from, vertex, *max_weight);
+        }
+
+        for (size_t i = 0; i < state.outgoing[vertex].size(); ++i) {
+            const EdgeId outgoing_id = state.outgoing[vertex][i];
+            const VertexId to = edges_[outgoing_id].to;
+            if (to == from) {
+                continue;
+            }
+            const Weight weight = incoming_weight + edges_[outgoing_id].weight;
+            const auto& witness_weight = state.witness_weights[to];
+            if (witness_weight && !(weight < *witness_weight)) {
+                continue;
+            }
+            ++shortcuts;
+            if (add) {
+                AddShortcut(state, from, to, weight, incoming_id, outgoing_id);
+            }
+        }
+        ClearWitnesses(state);
+    }
+    return shortcuts;
+}
+
+template <typename Weight>
+void HierarchyRouter<Weight>::FindWitnesses(ContractionState& state, VertexId from, VertexId excluded,
+                                            const Weight& max_weight) const {
+    Queue queue;
+    state.witness_weights[from] = ZERO_WEIGHT;
+    state.witness_touched.push_back(from);
+    queue.push({ZERO_WEIGHT, from});
+    size_t settled = 0;
+    while (!queue.empty() && settled < WITNESS_SETTLED_LIMIT) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (*state.witness_weights[vertex] < weight) {
+            continue;
+        }
+        if (max_weight < weight) {
+            break;
+        }
+        ++settled;
+        for (const EdgeId edge_id : state.outgoing[vertex]) {
+            const HierarchyEdge& edge = edges_[edge_id];
+            if (edge.to == excluded) {
+                continue;
+            }
+            const Weight candidate_weight = weight + edge.weight;
+            auto& witness_weight = state.witness_weights[edge.to];
+            if (!witness_weight) {
+                state.witness_touched.push_back(edge.to);
+            } else if (!(candidate_weight < *witness_weight)) {
+                continue;
+            }
+            witness_weight = candidate_weight;
+            queue.push({candidate_weight, edge.to});
+        }
+    }
+}
+
+template <typename Weight>
+void HierarchyRouter<Weight>::ClearWitnesses(ContractionState& state) const {
+    for (const VertexId vertex : state.witness_touched) {
+        state.witness_weights[vertex].reset();
+    }
+    state.witness_touched.clear();
+}
+
+template <typename Weight>
+void HierarchyRouter<Weight>::AddShortcut(ContractionState& state, VertexId from, VertexId to, const Weight& weight,
+                                          EdgeId first, EdgeId second) {
+    const EdgeId shortcut_id = edges_.size();
+    for (EdgeId& edge_id : state.outgoing[from]) {
+        if (edges_[edge_id].to != to) {
+            continue;
+        }
+        if (!(weight < edges_[edge_id].weight)) {
+            return;
+        }
+        // Заменённое ребро остаётся в edges_: на него могут ссылаться другие сокращения
+        auto& incoming = state.incoming[to];
+        *std::find(incoming.begin(), incoming.end(), edge_id) = shortcut_id;
+        edge_id = shortcut_id;
+        edges_.push_back({from, to, weight, first, second});
+        return;
+    }
+    edges_.push_back({from, to, weight, first, second});
+    state.outgoing[from].push_back(shortcut_id);
+    state.incoming[to].push_back(shortcut_id);
+}
+
+template <typename Weight>
+int HierarchyRouter<Weight>::GetPriority(ContractionState& state, VertexId vertex) {
+    const int removed = static_cast<int>(state.incoming[vertex].size() + state.outgoing[vertex].size());
+    return ContractVertex(state, vertex, false) - removed + state.contracted_neighbours[vertex];
+}
+
+template <typename Weight>
+bool HierarchyRouter<Weight>::SearchStep(Queue& queue, Labels& labels, const Labels& opposite, bool forward,
+                                         std::optional<Weight>& best_weight, VertexId& meeting) const {
+    if (queue.empty()) {
+        return false;
+    }
+    const auto [weight, vertex] = queue.top();
+    queue.pop();
+    if (labels.labels[vertex]->weight < weight) {
+        return !queue.empty();
+    }
+    // Дальнейшие вершины этого направления не могут улучшить найденный маршрут
+    if (best_weight && !(weight < *best_weight)) {
+        return false;
+    }
+    if (const auto& opposite_label = opposite.labels[vertex]) {
+        const Weight total_weight = weight + opposite_label->weight;
+        if (!best_weight || total_weight < *best_weight) {
+            best_weight = total_weight;
+            meeting = vertex;
+        }
+    }
+    for (const EdgeId edge_id : forward ? upward_outgoing_[vertex] : upward_incoming_[vertex]) {
+        const HierarchyEdge& edge = edges_[edge_id];
+        const VertexId next = forward ? edge.to : edge.from;
+        const Weight candidate_weight = weight + edge.weight;
+        auto& label = labels.labels[next];
+        if (!label) {
+            labels.touched.push_back(next);
+        } else if (!(candidate_weight < label->weight)) {
+            continue;
+        }
+        label = Label{candidate_weight, edge_id};
+        queue.push({candidate_weight, next});
+    }
+    return !queue.empty();
+}
+
+template <typename Weight>
+void HierarchyRouter<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    std::vector<EdgeId> stack = {edge_id};
+    while (!stack.empty()) {
+        const HierarchyEdge& edge = edges_[stack.back()];
+        stack.pop_back();
+        if (edge.second == NO_EDGE) {
+            edges.push_back(edge.first);
+        } else {
+            stack.push_back(edge.second);
+            stack.push_back(edge.first);
+        }
+    }
+}
+
+template <typename Weight>
+std::unique_ptr<typename HierarchyRouter<Weight>::SearchState> HierarchyRouter<Weight>::AcquireSearchState() const {
+    {
+        std::lock_guard lock(search_states_mutex_);
+        if (!search_states_.empty()) {
+            std::unique_ptr<SearchState> state = std::move(search_states_.back());
+            search_states_.pop_back();
+            return state;
+        }
+    }
+    const size_t vertex_count = graph_.GetVertexCount();
+    return std::make_unique<SearchState>(SearchState{
+        {std::vector<std::optional<Label>>(vertex_count), {}},
+        {std::vector<std::optional<Label>>(vertex_count), {}}
+    });
+}
+
+template <typename Weight>
+void HierarchyRouter<Weight>::ReleaseSearchState(std::unique_ptr<SearchState> state) const {
+    for (Labels* labels : {&state->forward, &state->backward}) {
+        for (const VertexId vertex : labels->touched) {
+            labels->labels[vertex].reset();
+        }
+        labels->touched.clear();
+    }
+    std::lock_guard lock(search_states_mutex_);
+    search_states_.push_back(std::move(state));
+}
+
+}  // namespace graph
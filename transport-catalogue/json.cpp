@@ -1,11 +1,66 @@
 #include "json.h"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <optional>
 #include <string_view>
+#include <system_error>
+#include <thread>
 
 using namespace std;
 
 namespace json {
 
+namespace {
+
+// Возвращает символ, закодированный escape-последовательностью с символом escaped_char
+char UnescapeChar(char escaped_char) {
+    // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
+    switch (escaped_char) {
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case '"':
+            return '"';
+        case '\\':
+            return '\\';
+        default:
+            // Встретили неизвестную escape-последовательность
+            throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+    }
+}
+
+// Преобразует считанную запись числа в int, а при переполнении или наличии
+// дробной/экспоненциальной части — в double
+Node ConvertNumber(string_view parsed_num, bool is_int) {
+    const char* first = parsed_num.data();
+    const char* last = parsed_num.data() + parsed_num.size();
+
+    if (is_int) {
+        // Сначала пробуем преобразовать строку в int. При переполнении
+        // код ниже преобразует строку в double
+        int int_value = 0;
+        if (const auto [ptr, ec] = from_chars(first, last, int_value); ec == errc{} && ptr == last) {
+            return Node(int_value);
+        }
+    }
+
+    double double_value = 0.;
+    if (const auto [ptr, ec] = from_chars(first, last, double_value); ec == errc{} && ptr == last) {
+        return Node(double_value);
+    }
+    throw ParsingError("Failed to convert "s + string(parsed_num) + " to number"s);
+}
+
+}  // namespace
+
 Node LoadArray(istream& input) {
     Array result;
 
@@ -75,20 +130,7 @@ Node LoadNumber(istream& input) {
         is_int = false;
     }
 
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return Node(stoi(parsed_num));
-            } catch (...) {
-                // В случае неудачи, например, при переполнении,
-                // код ниже попробует преобразовать строку в double
-            }
-        }
-        return Node(stod(parsed_num));
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
-    }
+    return ConvertNumber(parsed_num, is_int);
 }
 
 // Считывает содержимое строкового литерала JSON-документа
@@ -116,28 +158,7 @@ Node LoadString(istream& input) {
                 // Поток завершился сразу после символа обратной косой черты
                 throw ParsingError("String parsing error");
             }
-            const char escaped_char = *(it);
-            // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
-            switch (escaped_char) {
-                case 'n':
-                    s.push_back('\n');
-                    break;
-                case 't':
-                    s.push_back('\t');
-                    break;
-                case 'r':
-                    s.push_back('\r');
-                    break;
-                case '"':
-                    s.push_back('"');
-                    break;
-                case '\\':
-                    s.push_back('\\');
-                    break;
-                default:
-                    // Встретили неизвестную escape-последовательность
-                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
-            }
+            s.push_back(UnescapeChar(*it));
         } else if (ch == '\n' || ch == '\r') {
             // Строковый литерал внутри- JSON не может прерываться символами \r или \n
             throw ParsingError("Unexpected end of line"s);
@@ -163,7 +184,7 @@ Node LoadDict(istream& input) {
             throw ParsingError("Expected key in double quotes");
         }
 
-        string key = LoadString(input).AsString();
+        string key{LoadString(input).AsString()};
         input >> c;
         if (c != ':') {
             throw ParsingError("Expected ':' after key");
@@ -214,6 +235,374 @@ Node LoadNode(istream& input) {
     }
 }
 
+namespace {
+
+// Разбирает JSON-документ, целиком находящийся в памяти. Строки без escape-последовательностей
+// возвращаются как StringRef на исходный текст, остальные раскодируются в decoded.
+// Если заданы arenas и settings.threads > 1, крупные массивы верхнего уровня разбираются
+// параллельно, а каждый поток раскодирует строки в новую арену из arenas
+class BufferParser {
+public:
+    BufferParser(string_view text, deque<string>& decoded, const ParseSettings& settings = {},
+                 deque<deque<string>>* arenas = nullptr)
+        : pos_(text.data())
+        , end_(text.data() + text.size())
+        , decoded_(decoded)
+        , settings_(settings)
+        , arenas_(arenas) {
+    }
+
+    Node ParseNode() {
+        char c = 0;
+        if (!NextChar(c)) {
+            throw ParsingError("Failed to read JSON from stream"s);
+        }
+
+        if (c == '[') {
+            return ParseArray();
+        } else if (c == '{') {
+            return ParseDict();
+        } else if (isdigit(c) || c == '-') {
+            --pos_;
+            return ParseNumber();
+        } else if (c == '"') {
+            return Node(StringRef{ParseString()});
+        } else if (isalpha(c)) {
+            const char* word_begin = pos_ - 1;
+            while (pos_ != end_ && isalpha(*pos_)) {
+                ++pos_;
+            }
+            const string_view word(word_begin, pos_ - word_begin);
+
+            if (word == "null"sv) {
+                return Node(nullptr);
+            } else if (word == "true"sv) {
+                return Node(true);
+            } else if (word == "false"sv) {
+                return Node(false);
+            } else {
+                throw ParsingError("Invalid literal: "s + string(word));
+            }
+        } else {
+            throw ParsingError("Failed to read JSON from stream"s);
+        }
+    }
+
+    // Разбирает участок массива между двумя разделителями: он должен содержать ровно одно значение.
+    // Пустой участок допустим только для пустого массива
+    void ParseArraySlice(Array& result, bool allow_empty) {
+        char c = 0;
+        if (!NextChar(c)) {
+            if (!allow_empty) {
+                throw ParsingError("Failed to read JSON from stream"s);
+            }
+            return;
+        }
+        --pos_;
+        result.push_back(ParseNode());
+        if (NextChar(c)) {
+            throw ParsingError("Failed to read array from stream"s);
+        }
+    }
+
+private:
+    // Считывает очередной непробельный символ, как это делает operator>> потока
+    bool NextChar(char& c) {
+        while (pos_ != end_ && isspace(static_cast<unsigned char>(*pos_))) {
+            ++pos_;
+        }
+        if (pos_ == end_) {
+            return false;
+        }
+        c = *pos_++;
+        return true;
+    }
+
+    // Границы элементов массива, найденные предварительным просмотром текста
+    struct ArrayLayout {
+        // Начало участка каждого элемента: позиция после '[' или после разделителя
+        vector<const char*> element_begins;
+        const char* close = nullptr;
+    };
+
+    // Массивы с большей вложенностью разбираются только последовательно
+    static constexpr int MAX_PARALLEL_DEPTH = 1;
+
+    // Находит разделители и закрывающую скобку массива, начинающегося в текущей позиции,
+    // не разбирая значения. Для некорректного текста возвращает nullopt
+    optional<ArrayLayout> ScanArray() const {
+        ArrayLayout layout;
+        layout.element_begins.push_back(pos_);
+        int depth = 0;
+
+        for (const char* p = pos_; p != end_; ++p) {
+            switch (*p) {
+                case '"':
+                    // Пропускаем строку вместе с escape-последовательностями
+                    for (++p; p != end_ && *p != '"'; ++p) {
+                        if (*p == '\\' && ++p == end_) {
+                            return nullopt;
+                        }
+                    }
+                    if (p == end_) {
+                        return nullopt;
+                    }
+                    break;
+                case '[':
+                case '{':
+                    ++depth;
+                    break;
+                case ']':
+                case '}':
+                    if (depth == 0) {
+                        if (*p != ']') {
+                            return nullopt;
+                        }
+                        layout.close = p;
+                        return layout;
+                    }
+                    --depth;
+                    break;
+                case ',':
+                    if (depth == 0) {
+                        layout.element_begins.push_back(p + 1);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return nullopt;
+    }
+
+    Node ParseArrayInParallel(const ArrayLayout& layout) {
+        const auto& begins = layout.element_begins;
+        const size_t element_count = begins.size();
+        auto element_end = [&](size_t i) {
+            return (i + 1 < element_count) ? begins[i + 1] - 1 : layout.close;
+        };
+
+        // Делим элементы на участки примерно равного размера в байтах
+        const size_t total_bytes = static_cast<size_t>(layout.close - begins.front());
+        const size_t chunk_count = min<size_t>(settings_.threads, element_count);
+        vector<size_t> bounds{0};
+        for (size_t chunk = 1; chunk < chunk_count; ++chunk) {
+            const char* target = begins.front() + total_bytes * chunk / chunk_count;
+            const size_t bound = static_cast<size_t>(lower_bound(begins.begin(), begins.end(), target) - begins.begin());
+            if (bound > bounds.back() && bound < element_count) {
+                bounds.push_back(bound);
+            }
+        }
+        bounds.push_back(element_count);
+
+        const size_t parts_count = bounds.size() - 1;
+        vector<Array> parts(parts_count);
+        vector<exception_ptr> errors(parts_count);
+        vector<deque<string>*> chunk_arenas{&decoded_};
+        for (size_t chunk = 1; chunk < parts_count; ++chunk) {
+            chunk_arenas.push_back(&arenas_->emplace_back());
+        }
+
+        auto parse_chunk = [&](size_t chunk) {
+            try {
+                for (size_t i = bounds[chunk]; i < bounds[chunk + 1]; ++i) {
+                    const string_view slice(begins[i], static_cast<size_t>(element_end(i) - begins[i]));
+                    BufferParser(slice, *chunk_arenas[chunk]).ParseArraySlice(parts[chunk], element_count == 1);
+                }
+            } catch (...) {
+                errors[chunk] = current_exception();
+            }
+        };
+
+        vector<thread> workers;
+        workers.reserve(parts_count - 1);
+        for (size_t chunk = 1; chunk < parts_count; ++chunk) {
+            workers.emplace_back(parse_chunk, chunk);
+        }
+        parse_chunk(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (const auto& error : errors) {
+            if (error) {
+                rethrow_exception(error);
+            }
+        }
+
+        Array result;
+        result.reserve(element_count);
+        for (auto& part : parts) {
+            move(part.begin(), part.end(), back_inserter(result));
+        }
+        pos_ = layout.close + 1;
+        return Node(move(result));
+    }
+
+    Node ParseArray() {
+        // Массив не длиннее остатка текста: если остаток меньше порога, текст не просматриваем
+        if (arenas_ != nullptr && settings_.threads > 1 && depth_ <= MAX_PARALLEL_DEPTH
+            && static_cast<size_t>(end_ - pos_) >= settings_.parallel_min_bytes) {
+            const auto layout = ScanArray();
+            if (layout && static_cast<size_t>(layout->close - pos_) >= settings_.parallel_min_bytes) {
+                return ParseArrayInParallel(*layout);
+            }
+        }
+
+        ++depth_;
+        Array result;
+
+        char c = 0;
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == ']') {
+                closed = true;
+                break;
+            }
+            if (c != ',') {
+                --pos_;
+            }
+            result.push_back(ParseNode());
+        }
+
+        if (!closed) {
+            throw ParsingError("Failed to read array from stream"s);
+        }
+
+        --depth_;
+        return Node(move(result));
+    }
+
+    Node ParseDict() {
+        ++depth_;
+        Dict result;
+
+        char c = 0;
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == '}') {
+                closed = true;
+                break;
+            }
+            if (c == ',' && !NextChar(c)) {
+                break;
+            }
+
+            if (c != '"') {
+                throw ParsingError("Expected key in double quotes");
+            }
+
+            const StringRef key{ParseString()};
+            if (!NextChar(c) || c != ':') {
+                throw ParsingError("Expected ':' after key");
+            }
+
+            result.emplace(key, ParseNode());
+        }
+
+        if (!closed) {
+            throw ParsingError("Failed to read dictionary from stream"s);
+        }
+
+        --depth_;
+        return Node(move(result));
+    }
+
+    Node ParseNumber() {
+        const char* num_begin = pos_;
+
+        // Пропускает одну или более цифр
+        auto skip_digits = [this] {
+            if (pos_ == end_ || !isdigit(*pos_)) {
+                throw ParsingError("A digit is expected"s);
+            }
+            while (pos_ != end_ && isdigit(*pos_)) {
+                ++pos_;
+            }
+        };
+
+        if (*pos_ == '-') {
+            ++pos_;
+        }
+        // Целая часть числа; после 0 в JSON не могут идти другие цифры
+        if (pos_ != end_ && *pos_ == '0') {
+            ++pos_;
+        } else {
+            skip_digits();
+        }
+
+        bool is_int = true;
+        // Дробная часть числа
+        if (pos_ != end_ && *pos_ == '.') {
+            ++pos_;
+            skip_digits();
+            is_int = false;
+        }
+
+        // Экспоненциальная часть числа
+        if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+            ++pos_;
+            if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+                ++pos_;
+            }
+            skip_digits();
+            is_int = false;
+        }
+
+        return ConvertNumber({num_begin, static_cast<size_t>(pos_ - num_begin)}, is_int);
+    }
+
+    // Считывает строковый литерал после открывающей кавычки. Если в нём нет
+    // escape-последовательностей, возвращает ссылку на исходный текст без копирования
+    string_view ParseString() {
+        const char* str_begin = pos_;
+        while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+            if (*pos_ == '\n' || *pos_ == '\r') {
+                // Строковый литерал внутри JSON не может прерываться символами \r или \n
+                throw ParsingError("Unexpected end of line"s);
+            }
+            ++pos_;
+        }
+        if (pos_ == end_) {
+            throw ParsingError("String parsing error");
+        }
+        if (*pos_ == '"') {
+            return {str_begin, static_cast<size_t>(pos_++ - str_begin)};
+        }
+
+        // Встретили escape-последовательность: дальше раскодируем строку в отдельный буфер
+        string& s = decoded_.emplace_back(str_begin, pos_);
+        while (true) {
+            if (pos_ == end_) {
+                throw ParsingError("String parsing error");
+            }
+            const char ch = *pos_++;
+            if (ch == '"') {
+                break;
+            } else if (ch == '\\') {
+                if (pos_ == end_) {
+                    throw ParsingError("String parsing error");
+                }
+                s.push_back(UnescapeChar(*pos_++));
+            } else if (ch == '\n' || ch == '\r') {
+                throw ParsingError("Unexpected end of line"s);
+            } else {
+                s.push_back(ch);
+            }
+        }
+        return s;
+    }
+
+    const char* pos_;
+    const char* end_;
+    deque<string>& decoded_;
+    ParseSettings settings_;
+    deque<deque<string>>* arenas_;
+    // Число контейнеров, внутри которых находится текущая позиция
+    int depth_ = 0;
+};
+
+}  // namespace
+
 bool Node::IsNull() const {
     return holds_alternative<nullptr_t>(value_);
 }
@@ -243,7 +632,7 @@ bool Node::IsPureDouble() const {
 }
 
 bool Node::IsString() const {
-    return holds_alternative<string>(value_);
+    return holds_alternative<string>(value_) || holds_alternative<StringRef>(value_);
 }
 
 const Array& Node::AsArray() const {
@@ -283,11 +672,13 @@ double Node::AsDouble() const {
     throw logic_error("Not a double");
 }
 
-const string& Node::AsString() const {
-    if (!IsString()) {
-        throw logic_error("Not a string");
+string_view Node::AsString() const {
+    if (const auto* ref = get_if<StringRef>(&value_)) {
+        return ref->data;
+    } else if (const auto* str = get_if<string>(&value_)) {
+        return *str;
     }
-    return get<string>(value_);
+    throw logic_error("Not a string");
 }
 
 const Node::Value& Node::GetValue() const {
@@ -299,17 +690,38 @@ Node::Value& Node::GetValue() {
 }
 
 bool Node::operator==(const Node& other) const {
+    // Строка-копия и строка-ссылка на буфер равны, если совпадает их содержимое
+    if (IsString() && other.IsString()) {
+        return AsString() == other.AsString();
+    }
     return value_ == other.value_;
 }
 
 bool Node::operator!=(const Node& other) const {
-    return value_ != other.value_;
+    return !(*this == other);
+}
+
+bool operator==(StringRef lhs, StringRef rhs) {
+    return lhs.data == rhs.data;
+}
+
+bool operator==(const DictKey& lhs, const DictKey& rhs) {
+    return lhs.View() == rhs.View();
+}
+
+bool operator!=(const DictKey& lhs, const DictKey& rhs) {
+    return !(lhs == rhs);
 }
 
 Document::Document(Node root)
     : root_(move(root)) {
 }
 
+Document::Document(Node root, shared_ptr<const DocumentBuffer> buffer)
+    : root_(move(root))
+    , buffer_(move(buffer)) {
+}
+
 const Node& Document::GetRoot() const {
     return root_;
 }
@@ -326,81 +738,186 @@ Document Load(istream& input) {
     return Document{LoadNode(input)};
 }
 
-void PrintValue(nullptr_t, const PrintContext& ctx) {
-    ctx.out << "null"sv;
+Document LoadBuffer(string text, const ParseSettings& settings) {
+    auto buffer = make_shared<DocumentBuffer>();
+    buffer->text = move(text);
+    auto& decoded = buffer->arenas.emplace_back();
+    // Элементы списка инициализации вычисляются по порядку: разбор заканчивается до передачи buffer
+    return Document{BufferParser(buffer->text, decoded, settings, &buffer->arenas).ParseNode(), move(buffer)};
 }
 
-template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx) {
-    ctx.out << value;
+Document LoadBuffer(istream& input, const ParseSettings& settings) {
+    return LoadBuffer(string(istreambuf_iterator<char>(input), istreambuf_iterator<char>()), settings);
 }
 
-void PrintValue(string value, const PrintContext& ctx) {
-    ctx.out << '"';
-    for (const char c : value) {
-        switch (c) {
+OutputBuffer::OutputBuffer(ostream& out, size_t capacity)
+    : out_(&out)
+    , capacity_(capacity) {
+    buffer_.reserve(capacity_);
+}
+
+OutputBuffer::~OutputBuffer() {
+    Flush();
+}
+
+void OutputBuffer::PutSpaces(size_t count) {
+    static constexpr string_view SPACES = "                                "sv;
+    while (count > SPACES.size()) {
+        Write(SPACES);
+        count -= SPACES.size();
+    }
+    Write(SPACES.substr(0, count));
+}
+
+void OutputBuffer::Flush() {
+    if (out_ != nullptr && !buffer_.empty()) {
+        out_->write(buffer_.data(), static_cast<streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void OutputBuffer::WriteThrough(string_view data) {
+    Flush();
+    if (data.size() >= capacity_) {
+        // Крупный блок передаём в поток напрямую, минуя буфер
+        out_->write(data.data(), static_cast<streamsize>(data.size()));
+    } else {
+        buffer_.append(data);
+    }
+}
+
+string OutputBuffer::Release() {
+    string result = move(buffer_);
+    buffer_.clear();
+    return result;
+}
+
+// Участки без спецсимволов записываются целиком
+void PrintEscapedChars(string_view value, OutputBuffer& out) {
+    size_t run_begin = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        string_view escaped;
+        switch (value[i]) {
             case '\\':
-                ctx.out << "\\\\"sv;
+                escaped = "\\\\"sv;
                 break;
             case '"':
-                ctx.out << "\\\""sv;
+                escaped = "\\\""sv;
                 break;
             case '\n':
-                ctx.out << "\\n"sv;
+                escaped = "\\n"sv;
                 break;
             case '\t':
-                ctx.out << "\\t"sv;
+                escaped = "\\t"sv;
                 break;
             case '\r':
-                ctx.out << "\\r"sv;
+                escaped = "\\r"sv;
                 break;
             default:
-                ctx.out << c;
+                continue;
         }
+        out.Write(value.substr(run_begin, i - run_begin));
+        out.Write(escaped);
+        run_begin = i + 1;
     }
-    ctx.out << '"';
+    out.Write(value.substr(run_begin));
+}
+
+void PrintValue(nullptr_t, const PrintContext& ctx) {
+    ctx.out.Write("null"sv);
+}
+
+void PrintValue(int value, const PrintContext& ctx) {
+    array<char, numeric_limits<int>::digits10 + 3> buffer;
+    const auto result = to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    ctx.out.Write({buffer.data(), static_cast<size_t>(result.ptr - buffer.data())});
+}
+
+void PrintValue(double value, const PrintContext& ctx) {
+    // Больше max_digits10 значащих цифр не нужно для точного представления double
+    array<char, 64> buffer;
+    const int precision = min(ctx.settings.double_precision, numeric_limits<double>::max_digits10);
+    const auto result = (precision == SHORTEST_PRECISION)
+        ? to_chars(buffer.data(), buffer.data() + buffer.size(), value)
+        : to_chars(buffer.data(), buffer.data() + buffer.size(), value, chars_format::general, precision);
+    ctx.out.Write({buffer.data(), static_cast<size_t>(result.ptr - buffer.data())});
+}
+
+namespace {
+
+// Выводит строку в кавычках
+void PrintEscaped(string_view value, const PrintContext& ctx) {
+    ctx.out.Put('"');
+    PrintEscapedChars(value, ctx.out);
+    ctx.out.Put('"');
+}
+
+// Выводит начало контейнера, разделитель и конец контейнера с учётом режима вывода
+void PrintOpening(char bracket, const PrintContext& ctx) {
+    ctx.out.Put(bracket);
+    if (!ctx.settings.compact) {
+        ctx.out.Put('\n');
+    }
+}
+
+void PrintSeparator(const PrintContext& ctx) {
+    ctx.out.Write(ctx.settings.compact ? ","sv : ", \n"sv);
+}
+
+void PrintClosing(char bracket, const PrintContext& ctx) {
+    if (!ctx.settings.compact) {
+        ctx.out.Put('\n');
+        ctx.PrintIndent();
+    }
+    ctx.out.Put(bracket);
+}
+
+}  // namespace
+
+void PrintValue(const string& value, const PrintContext& ctx) {
+    PrintEscaped(value, ctx);
+}
+
+void PrintValue(StringRef value, const PrintContext& ctx) {
+    PrintEscaped(value.data, ctx);
 }
 
 void PrintValue(bool value, const PrintContext& ctx) {
-    ctx.out << boolalpha << value;
+    ctx.out.Write(value ? "true"sv : "false"sv);
 }
 
-void PrintValue(Array array, const PrintContext& ctx) {
-    ctx.out << "[\n"sv;
+void PrintValue(const Array& array, const PrintContext& ctx) {
+    PrintOpening('[', ctx);
     auto inner_ctx = ctx.Indented();
     bool first = true;
     for (const auto& elem : array) {
         if (!first) {
-            ctx.out << ", \n"sv;
+            PrintSeparator(ctx);
         }
 
         first = false;
         inner_ctx.PrintIndent();
         PrintNode(elem, inner_ctx);
     }
-    ctx.out << '\n';
-    ctx.PrintIndent();
-    ctx.out << "]"sv;
+    PrintClosing(']', ctx);
 }
 
-void PrintValue(Dict dict, const PrintContext& ctx) {
-    ctx.out << "{\n"sv;
+void PrintValue(const Dict& dict, const PrintContext& ctx) {
+    PrintOpening('{', ctx);
     auto inner_ctx = ctx.Indented();
     bool first = true;
     for (const auto& [key, node] : dict) {
         if (!first) {
-            ctx.out << ", \n"sv;
+            PrintSeparator(ctx);
         }
 
         first = false;
         inner_ctx.PrintIndent();
-        PrintValue(key, ctx);
-        ctx.out << ": ";
+        PrintEscaped(key, ctx);
+        ctx.out.Write(ctx.settings.compact ? ":"sv : ": "sv);
         PrintNode(node, inner_ctx);
     }
-    ctx.out << '\n';
-    ctx.PrintIndent();
-    ctx.out << "}"sv;
+    PrintClosing('}', ctx);
 }
 
 void PrintNode(const Node& node, const PrintContext& ctx) {
@@ -409,9 +926,11 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
     }, node.GetValue());
 }
 
-void Print(const Document& doc, ostream& output) {
-    PrintContext ctx{output};
+void Print(const Document& doc, ostream& output, const PrintSettings& settings) {
+    OutputBuffer buffer(output);
+    PrintContext ctx{buffer, settings};
     PrintNode(doc.GetRoot(), ctx);
+    buffer.Flush();
 }
 
 }  // namespace json
\ No newline at end of file
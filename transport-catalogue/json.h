@@ -1,38 +1,110 @@
 #pragma once
 
+#include <deque>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <vector>
 #include <variant>
 
 namespace json {
 
+// Точность, при которой double выводится кратчайшей записью, однозначно восстанавливающей число
+inline constexpr int SHORTEST_PRECISION = 0;
+
+struct PrintSettings {
+    // Число значащих цифр при выводе double; по умолчанию совпадает с std::ostream
+    int double_precision = 6;
+    // Компактный вывод без переносов строк и отступов
+    bool compact = false;
+};
+
+/*
+ * Буфер вывода: накапливает символы и передаёт их в поток крупными блоками.
+ * Буфер без потока хранит весь вывод в памяти, его можно забрать через Release
+ */
+class OutputBuffer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    OutputBuffer() = default;
+
+    explicit OutputBuffer(std::ostream& out, size_t capacity = DEFAULT_CAPACITY);
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    ~OutputBuffer();
+
+    void Put(char c) {
+        buffer_.push_back(c);
+        if (out_ != nullptr && buffer_.size() >= capacity_) {
+            Flush();
+        }
+    }
+
+    void Write(std::string_view data) {
+        if (out_ != nullptr && buffer_.size() + data.size() >= capacity_) {
+            WriteThrough(data);
+            return;
+        }
+        buffer_.append(data);
+    }
+
+    void PutSpaces(size_t count);
+
+    // Передаёт накопленные данные в поток; для буфера без потока ничего не делает
+    void Flush();
+
+    std::string_view View() const {
+        return buffer_;
+    }
+
+    std::string Release();
+
+private:
+    void WriteThrough(std::string_view data);
+
+    std::ostream* out_ = nullptr;
+    size_t capacity_ = DEFAULT_CAPACITY;
+    std::string buffer_;
+};
+
 struct PrintContext {
-    PrintContext(std::ostream& out)
+    PrintContext(OutputBuffer& out)
         : out(out) {
     }
 
-    PrintContext(std::ostream& out, int indent_step, int indent)
+    PrintContext(OutputBuffer& out, int indent_step, int indent)
     : out(out)
     , indent_step(indent_step)
         , indent(indent) {
     }
 
+    PrintContext(OutputBuffer& out, const PrintSettings& settings)
+        : out(out)
+        , settings(settings) {
+    }
+
     PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+        PrintContext result = *this;
+        result.indent += indent_step;
+        return result;
     }
     
     void PrintIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
+        if (!settings.compact) {
+            out.PutSpaces(static_cast<size_t>(indent));
         }
     }
 
-    std::ostream& out;
+    OutputBuffer& out;
     int indent_step = 4;
     int indent = 0;
+    PrintSettings settings;
 };
 
 class Node;
@@ -47,7 +119,53 @@ Node LoadDict(std::istream& input);
 
 Node LoadNode(std::istream& input);
 
-using Dict = std::map<std::string, Node>;
+// Строковое значение, ссылающееся на буфер документа (см. LoadBuffer), а не владеющее копией
+struct StringRef {
+    std::string_view data;
+};
+
+bool operator==(StringRef lhs, StringRef rhs);
+
+// Ключ словаря: ссылка на буфер документа, как StringRef, у документов из LoadBuffer
+// и собственная копия у документов из потока и построенных в коде
+class DictKey {
+public:
+    DictKey(std::string value)
+    : owned_(std::move(value)) {}
+
+    DictKey(const char* value)
+    : owned_(value) {}
+
+    DictKey(StringRef value)
+    : ref_(value.data) {}
+
+    std::string_view View() const {
+        return ref_.data() != nullptr ? ref_ : std::string_view(owned_);
+    }
+
+    operator std::string_view() const {
+        return View();
+    }
+
+private:
+    std::string owned_;
+    std::string_view ref_;
+};
+
+bool operator==(const DictKey& lhs, const DictKey& rhs);
+
+bool operator!=(const DictKey& lhs, const DictKey& rhs);
+
+// Сравнение ключей по тексту; позволяет искать в словаре по string_view без создания ключа
+struct DictKeyLess {
+    using is_transparent = void;
+
+    bool operator()(std::string_view lhs, std::string_view rhs) const {
+        return lhs < rhs;
+    }
+};
+
+using Dict = std::map<DictKey, Node, DictKeyLess>;
 using Array = std::vector<Node>;
 
 class ParsingError : public std::runtime_error {
@@ -57,7 +175,7 @@ public:
 
 class Node {
 public:
-    using Value = std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string>;
+    using Value = std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string, StringRef>;
 
     Node()
     : value_(nullptr) {}
@@ -83,6 +201,9 @@ public:
     Node(std::string value) 
     : value_(std::move(value)) {}
 
+    Node(StringRef value) 
+    : value_(value) {}
+
     bool IsNull() const;
 
     bool IsArray() const;
@@ -109,7 +230,7 @@ public:
 
     double AsDouble() const;
 
-    const std::string& AsString() const;
+    std::string_view AsString() const;
 
     const Value& GetValue() const;
 
@@ -123,10 +244,28 @@ private:
     Value value_;
 };
 
+// Входной текст документа и строки, раскодированные из escape-последовательностей.
+// На эти данные ссылаются строковые значения узлов, загруженных через LoadBuffer.
+// Каждый поток разбора раскодирует строки в собственную арену
+struct DocumentBuffer {
+    std::string text;
+    std::deque<std::deque<std::string>> arenas;
+};
+
+struct ParseSettings {
+    // Число потоков для разбора крупных массивов верхнего уровня:
+    // корневого массива и массивов-значений корневого словаря
+    unsigned threads = 1;
+    // Массивы меньшего размера в байтах разбираются в одном потоке
+    size_t parallel_min_bytes = 1 << 20;
+};
+
 class Document {
 public:
     explicit Document(Node root);
 
+    Document(Node root, std::shared_ptr<const DocumentBuffer> buffer);
+
     const Node& GetRoot() const;
 
     bool operator==(const Document& other) const;
@@ -135,25 +274,38 @@ public:
 
 private:
     Node root_;
+    std::shared_ptr<const DocumentBuffer> buffer_;
 };
 
 Document Load(std::istream& input);
 
+// Загружает документ, сохраняя входной текст внутри него. Строки и ключи словарей без escape-последовательностей
+// не копируются: узлы хранят StringRef и DictKey на текст. Узлы валидны, пока жива хотя бы одна копия Document
+Document LoadBuffer(std::string text, const ParseSettings& settings = {});
+
+Document LoadBuffer(std::istream& input, const ParseSettings& settings = {});
+
 void PrintValue(std::nullptr_t, const PrintContext& ctx);
 
-void PrintValue(std::string value, const PrintContext& ctx);
+void PrintValue(const std::string& value, const PrintContext& ctx);
+
+void PrintValue(StringRef value, const PrintContext& ctx);
 
 void PrintValue(bool value, const PrintContext& ctx);
 
-void PrintValue(Array array, const PrintContext& ctx);
+void PrintValue(const Array& array, const PrintContext& ctx);
+
+void PrintValue(const Dict& dict, const PrintContext& ctx);
 
-void PrintValue(Dict dict, const PrintContext& ctx);
+void PrintValue(int value, const PrintContext& ctx);
 
-template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx);
+void PrintValue(double value, const PrintContext& ctx);
 
 void PrintNode(const Node& node, const PrintContext& ctx);
 
-void Print(const Document& doc, std::ostream& output);
+// Выводит символы строки с экранированием, но без кавычек; позволяет выводить строку по частям
+void PrintEscapedChars(std::string_view value, OutputBuffer& out);
+
+void Print(const Document& doc, std::ostream& output, const PrintSettings& settings = {});
 
 }  // namespace json
\ No newline at end of file
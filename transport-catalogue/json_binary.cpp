@@ -0,0 +1,311 @@
+#include "json_binary.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace json::binary {
+
+namespace {
+
+// Таблица повторяющихся строк ограничена, чтобы при декодировании она оставалась в кэше процессора.
+// Первыми в неё попадают ключи и часто встречающиеся названия
+constexpr size_t MAX_STRING_TABLE_SIZE = 4096;
+// Вложенность контейнеров, при которой рекурсивное декодирование ещё не переполняет стек
+constexpr int MAX_DEPTH = 1000;
+
+enum class Tag : uint8_t {
+    NULL_VALUE,
+    FALSE_VALUE,
+    TRUE_VALUE,
+    INT,
+    DOUBLE,
+    STRING,
+    STRING_REF,
+    ARRAY,
+    OBJECT,
+};
+
+class Encoder {
+public:
+    explicit Encoder(string& out)
+        : out_(out) {
+    }
+
+    void EncodeNode(const Node& node) {
+        visit([this](const auto& value) {
+            EncodeValue(value);
+        }, node.GetValue());
+    }
+
+private:
+    void PutTag(Tag tag) {
+        out_.push_back(static_cast<char>(tag));
+    }
+
+    void PutVarint(uint64_t value) {
+        while (value >= 0x80) {
+            out_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void EncodeValue(nullptr_t) {
+        PutTag(Tag::NULL_VALUE);
+    }
+
+    void EncodeValue(bool value) {
+        PutTag(value ? Tag::TRUE_VALUE : Tag::FALSE_VALUE);
+    }
+
+    void EncodeValue(int value) {
+        PutTag(Tag::INT);
+        // zigzag: небольшие по модулю отрицательные числа тоже занимают мало байт
+        const auto wide = static_cast<int64_t>(value);
+        PutVarint((static_cast<uint64_t>(wide) << 1) ^ static_cast<uint64_t>(wide >> 63));
+    }
+
+    void EncodeValue(double value) {
+        PutTag(Tag::DOUBLE);
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            out_.push_back(static_cast<char>(bits >> (8 * i)));
+        }
+    }
+
+    void EncodeValue(const string& value) {
+        EncodeString(value);
+    }
+
+    void EncodeValue(StringRef value) {
+        EncodeString(value.data);
+    }
+
+    void EncodeValue(const Array& array) {
+        PutTag(Tag::ARRAY);
+        PutVarint(array.size());
+        for (const auto& item : array) {
+            EncodeNode(item);
+        }
+    }
+
+    void EncodeValue(const Dict& dict) {
+        PutTag(Tag::OBJECT);
+        PutVarint(dict.size());
+        for (const auto& [key, item] : dict) {
+            EncodeString(key);
+            EncodeNode(item);
+        }
+    }
+
+    void EncodeString(string_view value) {
+        if (const auto it = string_ids_.find(value); it != string_ids_.end()) {
+            PutTag(Tag::STRING_REF);
+            PutVarint(it->second);
+            return;
+        }
+        if (string_ids_.size() < MAX_STRING_TABLE_SIZE) {
+            string_ids_.emplace(value, string_ids_.size());
+        }
+        PutTag(Tag::STRING);
+        PutVarint(value.size());
+        out_.append(value);
+    }
+
+    string& out_;
+    unordered_map<string_view, size_t> string_ids_;
+};
+
+class Decoder {
+public:
+    explicit Decoder(string_view data)
+        : pos_(data.data())
+        , end_(data.data() + data.size()) {
+    }
+
+    Node DecodeNode() {
+        switch (GetTag()) {
+            case Tag::NULL_VALUE:
+                return Node(nullptr);
+            case Tag::FALSE_VALUE:
+                return Node(false);
+            case Tag::TRUE_VALUE:
+                return Node(true);
+            case Tag::INT: {
+                const uint64_t zigzag = GetVarint();
+                const int64_t value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+                if (value < numeric_limits<int>::min() || value > numeric_limits<int>::max()) {
+                    throw ParsingError("Integer out of range in binary document"s);
+                }
+                return Node(static_cast<int>(value));
+            }
+            case Tag::DOUBLE: {
+                Require(8);
+                uint64_t bits = 0;
+                for (int i = 0; i < 8; ++i) {
+                    bits |= static_cast<uint64_t>(static_cast<uint8_t>(pos_[i])) << (8 * i);
+                }
+                pos_ += 8;
+                double value = 0.;
+                memcpy(&value, &bits, sizeof(value));
+                return Node(value);
+            }
+            case Tag::STRING:
+                return Node(StringRef{DecodeNewString()});
+            case Tag::STRING_REF:
+                return Node(StringRef{DecodeStringRef()});
+            case Tag::ARRAY: {
+                const DepthGuard guard(depth_);
+                const uint64_t size = GetCount();
+                Array array;
+                array.reserve(size);
+                for (uint64_t i = 0; i < size; ++i) {
+                    array.push_back(DecodeNode());
+                }
+                return Node(move(array));
+            }
+            case Tag::OBJECT: {
+                const DepthGuard guard(depth_);
+                const uint64_t size = GetCount();
+                Dict dict;
+                for (uint64_t i = 0; i < size; ++i) {
+                    const StringRef key{DecodeKey()};
+                    dict.emplace_hint(dict.end(), key, DecodeNode());
+                }
+                return Node(move(dict));
+            }
+        }
+        throw ParsingError("Unknown binary value type"s);
+    }
+
+    bool AtEnd() const {
+        return pos_ == end_;
+    }
+
+private:
+    // Считает вложенность на время декодирования контейнера
+    class DepthGuard {
+    public:
+        explicit DepthGuard(int& depth)
+            : depth_(depth) {
+            if (++depth_ > MAX_DEPTH) {
+                throw ParsingError("Binary document is nested too deeply"s);
+            }
+        }
+
+        DepthGuard(const DepthGuard&) = delete;
+        DepthGuard& operator=(const DepthGuard&) = delete;
+
+        ~DepthGuard() {
+            --depth_;
+        }
+
+    private:
+        int& depth_;
+    };
+
+    void Require(size_t size) const {
+        if (static_cast<size_t>(end_ - pos_) < size) {
+            throw ParsingError("Unexpected end of binary document"s);
+        }
+    }
+
+    Tag GetTag() {
+        Require(1);
+        const auto tag = static_cast<uint8_t>(*pos_++);
+        if (tag > static_cast<uint8_t>(Tag::OBJECT)) {
+            throw ParsingError("Unknown binary value type"s);
+        }
+        return static_cast<Tag>(tag);
+    }
+
+    uint64_t GetVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            Require(1);
+            const auto byte = static_cast<uint8_t>(*pos_++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw ParsingError("Invalid varint in binary document"s);
+    }
+
+    // Число элементов контейнера не может превышать число оставшихся байт
+    uint64_t GetCount() {
+        const uint64_t count = GetVarint();
+        Require(count);
+        return count;
+    }
+
+    string_view DecodeNewString() {
+        const uint64_t size = GetVarint();
+        Require(size);
+        const string_view value(pos_, size);
+        pos_ += size;
+        if (strings_.size() < MAX_STRING_TABLE_SIZE) {
+            strings_.push_back(value);
+        }
+        return value;
+    }
+
+    string_view DecodeStringRef() {
+        const uint64_t id = GetVarint();
+        if (id >= strings_.size()) {
+            throw ParsingError("Invalid string reference in binary document"s);
+        }
+        return strings_[id];
+    }
+
+    string_view DecodeKey() {
+        switch (GetTag()) {
+            case Tag::STRING:
+                return DecodeNewString();
+            case Tag::STRING_REF:
+                return DecodeStringRef();
+            default:
+                throw ParsingError("Expected string key in binary document"s);
+        }
+    }
+
+    const char* pos_;
+    const char* end_;
+    vector<string_view> strings_;
+    int depth_ = 0;
+};
+
+}  // namespace
+
+bool IsBinary(string_view text) {
+    return text.substr(0, MAGIC.size()) == MAGIC;
+}
+
+string Encode(const Document& doc) {
+    string result{MAGIC};
+    Encoder(result).EncodeNode(doc.GetRoot());
+    return result;
+}
+
+Document Decode(string data) {
+    if (!IsBinary(data)) {
+        throw ParsingError("Missing binary document signature"s);
+    }
+
+    auto buffer = make_shared<DocumentBuffer>();
+    buffer->text = move(data);
+    Decoder decoder(string_view(buffer->text).substr(MAGIC.size()));
+    Node root = decoder.DecodeNode();
+    if (!decoder.AtEnd()) {
+        throw ParsingError("Unexpected data after binary document"s);
+    }
+    return Document{move(root), move(buffer)};
+}
+
+} // namespace json::binary
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "json.h"
+
+#include <string>
+#include <string_view>
+
+namespace json::binary {
+
+/*
+ * Компактное двоичное представление JSON-документа с той же схемой данных.
+ * Документ начинается с сигнатуры MAGIC, затем следует корневое значение.
+ * Каждое значение — байт типа и данные: целые числа записываются как zigzag-varint,
+ * double — 8 байт little-endian, строки — длина и байты без экранирования.
+ * Повторно встреченная строка (ключ или значение) заменяется номером в таблице
+ * первых 4096 различных строк, что сокращает объём запросов с повторяющимися названиями
+ */
+
+inline constexpr std::string_view MAGIC = "\xB1TCB\x01";
+
+// Проверяет, начинается ли text с сигнатуры двоичного формата
+bool IsBinary(std::string_view text);
+
+std::string Encode(const Document& doc);
+
+// Строковые значения декодированного документа ссылаются на data, который хранится внутри документа.
+// Бросает json::ParsingError при повреждённых данных
+Document Decode(std::string data);
+
+} // namespace json::binary
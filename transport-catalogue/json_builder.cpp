@@ -132,6 +132,7 @@ Node Builder::GetNode(Node::Value value) {
     if (holds_alternative<int>(value)) return Node(get<int>(value));
     if (holds_alternative<double>(value)) return Node(get<double>(value));
     if (holds_alternative<string>(value)) return Node(get<string>(value));
+    if (holds_alternative<StringRef>(value)) return Node(get<StringRef>(value));
     if (holds_alternative<nullptr_t>(value)) return Node(get<nullptr_t>(value));
     if (holds_alternative<bool>(value)) return Node(get<bool>(value));
     if (holds_alternative<Dict>(value)) return Node(get<Dict>(value));
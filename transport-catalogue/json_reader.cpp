@@ -1,93 +1,241 @@
 #include "json_reader.h"
+#include "profiling.h"
 #include "svg.h"
 
+#include <condition_variable>
+#include <exception>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <variant>
 #include <vector>
 
 using namespace std;
 
 namespace transport_catalogue::processing {
 
+namespace {
+
+// Число подряд идущих запросов, которые поток обрабатывает за раз
+constexpr size_t STAT_BLOCK_SIZE = 64;
+// Сколько блоков на поток может быть обработано раньше, чем выведены ответы на предыдущие.
+// Ограничивает память под ожидающие вывода ответы, если впереди долгий запрос
+constexpr size_t STAT_WINDOW_PER_THREAD = 4;
+
+}  // namespace
+
 JsonReader::JsonReader(TransportCatalogue& catalogue)
     : catalogue_(catalogue)
     , handler_(catalogue) {}
 
 void JsonReader::ProcessBaseRequests(const json::Document& doc) {
+    profiling::PhaseTimer timer(profiling::Phase::BASE_REQUESTS);
     const json::Node& root = doc.GetRoot().AsMap().at("base_requests"s);
     const auto& base_requests = root.AsArray();
 
+    // Запросы разбираются один раз, дальше остановки и маршруты добавляются в прежнем порядке
+    vector<StopDescription> stops;
+    vector<BusDescription> buses;
     for (const auto& request : base_requests) {
-        const auto& stop_map = request.AsMap();
-        const auto& type = stop_map.at("type"s).AsString();
-
-        if (type == "Stop"s) {
-            const auto& name = stop_map.at("name"s).AsString();
-            double latitude = stop_map.at("latitude"s).AsDouble();
-            double longitude = stop_map.at("longitude"s).AsDouble();
-            catalogue_.AddStop(name, {latitude, longitude});
-        }
-    }
-    
-    for (const auto& request : base_requests) {
-        const auto& stop_map = request.AsMap();
-        const auto& type = stop_map.at("type"s).AsString();
-
-        if (type == "Stop"s) {
-            const auto& name = stop_map.at("name"s).AsString();
-            const Stop* stop_info = catalogue_.GetStopInfo(name).value();
-            const auto& dists = stop_map.at("road_distances"s).AsMap();
-
-            for (const auto& [dest_name, dist_node] : dists) {
-                const int dist = dist_node.AsInt();
-                const auto* dest_info = catalogue_.GetStopInfo(dest_name).value();
-                catalogue_.SetDistance(stop_info, dest_info, dist);
-                if (catalogue_.GetDistance(dest_info, stop_info) == 0) {
-                    catalogue_.SetDistance(dest_info, stop_info, dist);
-                }
-            }
+        BaseRequest decoded = DecodeBaseRequest(request.AsMap());
+        if (auto* stop = get_if<StopDescription>(&decoded)) {
+            stops.push_back(*stop);
+        } else if (auto* bus = get_if<BusDescription>(&decoded)) {
+            buses.push_back(move(*bus));
         }
     }
 
-    for (const auto& request : base_requests) {
-        const auto& bus_map = request.AsMap();
-        const auto& type = bus_map.at("type"s).AsString();
+    for (const auto& stop : stops) {
+        catalogue_.AddStop(stop.name, stop.coords);
+    }
 
-        if (type == "Bus"s) {
-            const auto& name = bus_map.at("name"s).AsString();
-            const auto& stops = bus_map.at("stops"s).AsArray();
-            vector<string_view> stops_names;
+    for (const auto& stop : stops) {
+        const Stop* stop_info = catalogue_.GetStopInfo(stop.name).value();
 
-            for (const auto& stop_node : stops) {
-                stops_names.push_back(stop_node.AsString());
+        for (const auto& [dest_name, dist_node] : *stop.road_distances) {
+            const int dist = dist_node.AsInt();
+            const auto* dest_info = catalogue_.GetStopInfo(dest_name).value();
+            catalogue_.SetDistance(stop_info, dest_info, dist);
+            if (catalogue_.GetDistance(dest_info, stop_info) == 0) {
+                catalogue_.SetDistance(dest_info, stop_info, dist);
             }
-            
-            bool is_circular = bus_map.at("is_roundtrip"s).AsBool();
-            catalogue_.AddRoute(name, stops_names, is_circular);
-        }    
+        }
+    }
+
+    for (const auto& bus : buses) {
+        catalogue_.AddRoute(bus.name, bus.stops, bus.is_roundtrip);
     }
 }
 
-json::Array JsonReader::ProcessStatRequests(const json::Document& doc, MapRenderer& renderer, const Router& router) const {
+void JsonReader::ProcessStatRequests(const json::Document& doc, MapRenderer& renderer, const Router& router, json::Writer& writer) const {
+    profiling::PhaseTimer timer(profiling::Phase::STAT_REQUESTS);
     const json::Node& root = doc.GetRoot().AsMap().at("stat_requests"s);
     const auto& stat_requests = root.AsArray();
-    json::Array result;
 
+    // Все запросы декодируются до вывода первого ответа: запрос без обязательного поля или с полем
+    // неверного типа прерывает обработку, не оставляя в выводе недописанного массива
+    vector<StatRequest> requests;
+    requests.reserve(stat_requests.size());
     for (const auto& request : stat_requests) {
-        const auto& request_map = request.AsMap();
-        const string& type = request_map.at("type"s).AsString();
-        
-        if (type == "Stop"s) {
-            result.push_back(handler_.HandleStopRequest(request_map));
-        } else if (type == "Bus"s) {
-            result.push_back(handler_.HandleRouteRequest(request_map));
-        } else if (type == "Map"s) {
-            result.push_back(handler_.HandleMapRequest(request_map, renderer));
-        } else if (type == "Route"s) {
-            result.push_back(handler_.HandleRoutingRequest(request_map, router));
+        requests.push_back(DecodeStatRequest(request.AsMap()));
+    }
+
+    vector<pair<string_view, string_view>> route_queries;
+    for (const auto& request : requests) {
+        if (const auto* route = get_if<RouteRequest>(&request)) {
+            route_queries.emplace_back(route->from, route->to);
+        } else if (const auto* route_map = get_if<RouteMapRequest>(&request)) {
+            route_queries.emplace_back(route_map->from, route_map->to);
+        }
+    }
+    handler_.PrefetchRoutes(move(route_queries), router, threads_);
+
+    writer.StartArray();
+    if (threads_ > 1 && requests.size() > 1) {
+        ProcessStatRequestsParallel(requests, renderer, router, writer);
+    } else {
+        for (const auto& request : requests) {
+            ProcessStatRequest(request, renderer, router, nullptr, writer);
+        }
+    }
+    writer.EndArray();
+}
+
+void JsonReader::ProcessStatRequest(const StatRequest& request, MapRenderer& renderer, const Router& router,
+                                    mutex* renderer_mutex, json::Writer& writer) const {
+    profiling::RequestTimer timer(GetRequestType(request));
+
+    if (const auto* stop = get_if<StopRequest>(&request)) {
+        handler_.HandleStopRequest(*stop, writer);
+    } else if (const auto* bus = get_if<BusRequest>(&request)) {
+        handler_.HandleRouteRequest(*bus, writer);
+    } else if (const auto* route = get_if<RouteRequest>(&request)) {
+        handler_.HandleRoutingRequest(*route, router, writer);
+    } else if (!holds_alternative<monostate>(request)) {
+        unique_lock<mutex> lock;
+        if (renderer_mutex != nullptr) {
+            lock = unique_lock(*renderer_mutex);
+        }
+        if (const auto* map = get_if<MapRequest>(&request)) {
+            handler_.HandleMapRequest(*map, renderer, writer);
+        } else if (const auto* tile = get_if<MapTileRequest>(&request)) {
+            handler_.HandleMapTileRequest(*tile, renderer, writer);
+        } else if (const auto* route_map = get_if<RouteMapRequest>(&request)) {
+            handler_.HandleRouteMapRequest(*route_map, renderer, router, writer);
+        } else if (const auto* stats = get_if<StatsRequest>(&request)) {
+            handler_.HandleStatsRequest(*stats, renderer, router, writer);
         }
     }
-    return result;
+}
+
+void JsonReader::ProcessStatRequestsParallel(const vector<StatRequest>& requests, MapRenderer& renderer,
+                                             const Router& router, json::Writer& writer) const {
+    // Ответы на подряд идущие запросы, выведенные потоком в один буфер. Блок передаётся целиком,
+    // чтобы синхронизация потоков приходилась не на каждый короткий запрос
+    struct Block {
+        string text;
+        // Концы ответов в text; пустой ответ получает запрос неизвестного типа
+        vector<size_t> ends;
+        exception_ptr error;
+        bool ready = false;
+    };
+
+    const size_t blocks_count = (requests.size() + STAT_BLOCK_SIZE - 1) / STAT_BLOCK_SIZE;
+    const size_t window = size_t{threads_} * STAT_WINDOW_PER_THREAD;
+    const json::PrintSettings& print_settings = writer.GetSettings();
+    const int indent = writer.GetValueIndent();
+
+    vector<Block> blocks(blocks_count);
+    mutex blocks_mutex;
+    condition_variable block_ready;
+    condition_variable window_moved;
+    size_t next = 0;
+    size_t emitted = 0;
+    bool stop = false;
+    mutex renderer_mutex;
+
+    // Свободный поток берёт следующий по порядку блок, поэтому долгие запросы не задерживают остальные потоки
+    const auto worker = [&] {
+        while (true) {
+            size_t index = 0;
+            {
+                unique_lock lock(blocks_mutex);
+                window_moved.wait(lock, [&] {
+                    return stop || next >= blocks_count || next < emitted + window;
+                });
+                if (stop || next >= blocks_count) {
+                    return;
+                }
+                index = next++;
+            }
+
+            Block block;
+            json::OutputBuffer buffer;
+            try {
+                const size_t end = min(requests.size(), (index + 1) * STAT_BLOCK_SIZE);
+                for (size_t i = index * STAT_BLOCK_SIZE; i < end; ++i) {
+                    json::Writer item_writer(buffer, print_settings, indent);
+                    ProcessStatRequest(requests[i], renderer, router, &renderer_mutex, item_writer);
+                    block.ends.push_back(buffer.View().size());
+                }
+            } catch (...) {
+                block.error = current_exception();
+            }
+            block.text = buffer.Release();
+            block.ready = true;
+
+            {
+                lock_guard lock(blocks_mutex);
+                blocks[index] = move(block);
+            }
+            block_ready.notify_one();
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned i = 0; i < threads_; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    exception_ptr error;
+    for (size_t index = 0; index < blocks_count && !error; ++index) {
+        Block block;
+        {
+            unique_lock lock(blocks_mutex);
+            block_ready.wait(lock, [&] {
+                return blocks[index].ready;
+            });
+            block = move(blocks[index]);
+            ++emitted;
+        }
+        window_moved.notify_all();
+
+        // Запросы уже декодированы, поэтому исключение в потоке вызывает не входной документ, а нехватка ресурсов
+        // (например, bad_alloc). Оно передаётся вызывающему, как и при последовательной обработке:
+        // выводятся только ответы, готовые до него, а последующие блоки не выводятся
+        size_t begin = 0;
+        for (const size_t end : block.ends) {
+            if (end > begin) {
+                writer.RawValue(string_view(block.text).substr(begin, end - begin));
+            }
+            begin = end;
+        }
+        error = block.error;
+    }
+
+    {
+        lock_guard lock(blocks_mutex);
+        stop = true;
+    }
+    window_moved.notify_all();
+    for (auto& t : workers) {
+        t.join();
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
 }
 
 RenderSettings JsonReader::ProcessRenderSettings(const json::Document& doc) const {
@@ -109,7 +257,7 @@ RenderSettings JsonReader::ProcessRenderSettings(const json::Document& doc) cons
 
     const auto& underlayer_color = render_settings.at("underlayer_color"s);
     if (underlayer_color.IsString()) {
-        result.underlayer_color = underlayer_color.AsString();
+        result.underlayer_color = string(underlayer_color.AsString());
     } else if (underlayer_color.IsArray()) {
         const auto& color_array = underlayer_color.AsArray();
         if (color_array.size() == 3) {
@@ -133,7 +281,7 @@ RenderSettings JsonReader::ProcessRenderSettings(const json::Document& doc) cons
     const auto& color_palette = render_settings.at("color_palette"s).AsArray();
     for (const auto& color : color_palette) {
         if (color.IsString()) {
-            result.color_palette.emplace_back(color.AsString());
+            result.color_palette.emplace_back(string(color.AsString()));
         } else if (color.IsArray()) {
             const auto& color_array = color.AsArray();
             if (color_array.size() == 3) {
@@ -152,6 +300,13 @@ RenderSettings JsonReader::ProcessRenderSettings(const json::Document& doc) cons
             }
         } else throw logic_error("Invalid color palette format");
     }
+
+    if (const auto it = render_settings.find("simplify_tolerance"sv); it != render_settings.end()) {
+        result.simplify_tolerance = it->second.AsDouble();
+    }
+    if (const auto it = render_settings.find("avoid_label_overlap"sv); it != render_settings.end()) {
+        result.avoid_label_overlap = it->second.AsBool();
+    }
     return result;
 }
 
@@ -166,17 +321,78 @@ RoutingSettings JsonReader::ProcessRouterSettings(const json::Document& doc) con
     return result;
 }
 
-void JsonReader::ProcessDocument(const json::Document& doc, ostream& output) {
+RoutingLoad JsonReader::ProcessRoutingLoad(const json::Document& doc) const {
+    const auto& stat_requests = doc.GetRoot().AsMap().at("stat_requests"s).AsArray();
+    size_t route_requests = 0;
+    unordered_set<string_view> route_sources;
+    for (const auto& request : stat_requests) {
+        const auto& request_map = request.AsMap();
+        const auto type_it = request_map.find("type"sv);
+        if (type_it == request_map.end() || !type_it->second.IsString()) {
+            continue;
+        }
+        const RequestType type = GetRequestType(type_it->second.AsString());
+        if (type != RequestType::ROUTE && type != RequestType::ROUTE_MAP) {
+            continue;
+        }
+        ++route_requests;
+        if (const auto from_it = request_map.find("from"sv);
+            from_it != request_map.end() && from_it->second.IsString()) {
+            route_sources.insert(from_it->second.AsString());
+        }
+    }
+    return {route_requests, route_sources.size()};
+}
+
+void JsonReader::SetThreads(unsigned threads) {
+    threads_ = threads;
+}
+
+void JsonReader::ProcessDocument(const json::Document& doc, ostream& output, const json::PrintSettings& print_settings) {
     ProcessBaseRequests(doc);
     RenderSettings render_settings = ProcessRenderSettings(doc);
     RoutingSettings routing_settings = ProcessRouterSettings(doc);
 
     MapRenderer renderer(render_settings, catalogue_);
-    Router router(routing_settings, catalogue_);
+    renderer.SetThreads(threads_);
+    const RoutingLoad routing_load = ProcessRoutingLoad(doc);
+    if (memory_report_ != nullptr) {
+        PrintRouterEstimate(*memory_report_, routing_load);
+    }
+    Router router(routing_settings, catalogue_, routing_load, routing_options_);
+    if (memory_report_ != nullptr) {
+        PrintRoutingPlan(*memory_report_, router.GetPlan());
+    }
 
-    json::Array stat_responses = ProcessStatRequests(doc, renderer, router);
+    json::OutputBuffer buffer(output);
+    json::Writer writer(buffer, print_settings);
+    ProcessStatRequests(doc, renderer, router, writer);
+    {
+        profiling::PhaseTimer timer(profiling::Phase::OUTPUT);
+        buffer.Flush();
+    }
+    if (memory_report_ != nullptr) {
+        PrintMemoryUsage(*memory_report_, renderer, router);
+    }
+}
+
+void JsonReader::SetMemoryReport(ostream* output) {
+    memory_report_ = output;
+}
+
+void JsonReader::SetRoutingOptions(const RoutingOptions& options) {
+    routing_options_ = options;
+}
+
+void JsonReader::PrintRouterEstimate(ostream& output, const RoutingLoad& load) const {
+    memory::PrintMemoryUsage(output, "router_estimate"sv,
+                             EstimateRouterMemory(GetNetworkSize(catalogue_), load, routing_options_));
+}
 
-    json::Print(json::Document(stat_responses), output);
+void JsonReader::PrintMemoryUsage(ostream& output, const MapRenderer& renderer, const Router& router) const {
+    memory::PrintMemoryUsage(output, "catalogue"sv, catalogue_.GetMemoryUsage());
+    memory::PrintMemoryUsage(output, "map_renderer"sv, renderer.GetMemoryUsage());
+    memory::PrintMemoryUsage(output, "router"sv, router.GetMemoryUsage());
 }
 
 } // namespace transport_catalogue::processing
\ No newline at end of file
@@ -1,12 +1,16 @@
 #pragma once
 
 #include "json.h"
+#include "json_writer.h"
 #include "map_renderer.h"
 #include "request_handler.h"
+#include "requests.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 namespace transport_catalogue::processing {
 
@@ -21,17 +25,50 @@ public:
 
     void ProcessBaseRequests(const json::Document& doc);
 
-    json::Array ProcessStatRequests(const json::Document& doc, MapRenderer& renderer, const Router& router) const;
+    // Записывает ответы на stat_requests массивом в writer. При числе потоков больше одного запросы
+    // обрабатываются параллельно, а ответы выводятся в порядке запросов. Если запрос не декодируется,
+    // исключение выбрасывается до записи в writer
+    void ProcessStatRequests(const json::Document& doc, MapRenderer& renderer, const Router& router, json::Writer& writer) const;
+
+    // Записывает в writer ответ на один декодированный запрос; запрос неизвестного типа остаётся без ответа.
+    // Запросы карты и Stats обращаются к кэшам renderer и при параллельной обработке выполняются под renderer_mutex
+    void ProcessStatRequest(const StatRequest& request, MapRenderer& renderer, const Router& router,
+                            std::mutex* renderer_mutex, json::Writer& writer) const;
 
     RenderSettings ProcessRenderSettings(const json::Document& doc) const;
 
     RoutingSettings ProcessRouterSettings(const json::Document& doc) const;
 
-    void ProcessDocument(const json::Document& doc, std::ostream& output);
+    // Число запросов Route и RouteMap в stat_requests и различных начальных остановок в них
+    RoutingLoad ProcessRoutingLoad(const json::Document& doc) const;
+
+    // Число потоков для обработки запросов
+    void SetThreads(unsigned threads);
+
+    // Если output задан, ProcessDocument выводит в него оценку памяти маршрутизатора перед его построением,
+    // выбранный способ поиска маршрутов и память структур данных после ответов на запросы
+    void SetMemoryReport(std::ostream* output);
+
+    // Ограничение памяти и способ поиска маршрутов для маршрутизатора, который строит ProcessDocument
+    void SetRoutingOptions(const RoutingOptions& options);
+
+    // Оценка памяти маршрутизатора по размеру сети в справочнике и ожидаемым запросам
+    void PrintRouterEstimate(std::ostream& output, const RoutingLoad& load = {}) const;
+
+    // Память справочника, renderer и router по контейнерам
+    void PrintMemoryUsage(std::ostream& output, const MapRenderer& renderer, const Router& router) const;
+
+    void ProcessDocument(const json::Document& doc, std::ostream& output, const json::PrintSettings& print_settings = {});
 
 private:
+    void ProcessStatRequestsParallel(const std::vector<StatRequest>& requests, MapRenderer& renderer,
+                                     const Router& router, json::Writer& writer) const;
+
     TransportCatalogue& catalogue_;
     RequestHandler handler_;
+    unsigned threads_ = 1;
+    std::ostream* memory_report_ = nullptr;
+    RoutingOptions routing_options_;
 };
 
 } // namespace transport_catalogue::processing
\ No newline at end of file
@@ -0,0 +1,490 @@
+#include "json_tape.h"
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std;
+
+namespace json::tape {
+
+namespace {
+
+bool IsStructural(char c) {
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Первый проход: позиции структурных символов, открывающих кавычек и начал скаляров
+vector<uint32_t> BuildStructuralIndex(string_view text) {
+    if (text.size() >= numeric_limits<uint32_t>::max()) {
+        throw ParsingError("Document is too large"s);
+    }
+
+    vector<uint32_t> index;
+    index.reserve(text.size() / 4);
+    bool in_scalar = false;
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        if (c == '"') {
+            index.push_back(static_cast<uint32_t>(i));
+            // Пропускаем содержимое строки вместе с escape-последовательностями
+            for (++i; i < text.size() && text[i] != '"'; ++i) {
+                if (text[i] == '\\') {
+                    ++i;
+                }
+            }
+            if (i >= text.size()) {
+                throw ParsingError("String parsing error"s);
+            }
+            in_scalar = false;
+        } else if (IsStructural(c)) {
+            index.push_back(static_cast<uint32_t>(i));
+            in_scalar = false;
+        } else if (IsSpace(c)) {
+            in_scalar = false;
+        } else if (!in_scalar) {
+            index.push_back(static_cast<uint32_t>(i));
+            in_scalar = true;
+        }
+    }
+    return index;
+}
+
+}  // namespace
+
+// Второй проход: заполняет ленту, двигаясь по структурному индексу
+class TapeBuilder {
+public:
+    TapeBuilder(Document& doc, const vector<uint32_t>& index)
+        : doc_(doc)
+        , text_(doc.text_)
+        , index_(index) {
+    }
+
+    void Build() {
+        doc_.tape_.reserve(index_.size() / 2 + 1);
+        ParseValue();
+        if (next_ != index_.size()) {
+            throw ParsingError("Unexpected data after JSON value"s);
+        }
+    }
+
+private:
+    char Peek() const {
+        if (next_ == index_.size()) {
+            throw ParsingError("Unexpected end of document"s);
+        }
+        return text_[index_[next_]];
+    }
+
+    void Expect(char expected, const char* message) {
+        if (Peek() != expected) {
+            throw ParsingError(message);
+        }
+        ++next_;
+    }
+
+    void ParseValue() {
+        switch (Peek()) {
+            case '{':
+                ParseObject();
+                break;
+            case '[':
+                ParseArray();
+                break;
+            case '"':
+                ParseString();
+                break;
+            default:
+                ParseScalar();
+        }
+    }
+
+    void ParseArray() {
+        const size_t start = OpenContainer(TokenType::ARRAY);
+        uint32_t count = 0;
+        if (Peek() != ']') {
+            while (true) {
+                ParseValue();
+                ++count;
+                if (Peek() == ',') {
+                    ++next_;
+                    continue;
+                }
+                break;
+            }
+        }
+        Expect(']', "Failed to read array");
+        CloseContainer(start, count);
+    }
+
+    void ParseObject() {
+        const size_t start = OpenContainer(TokenType::OBJECT);
+        uint32_t count = 0;
+        if (Peek() != '}') {
+            while (true) {
+                if (Peek() != '"') {
+                    throw ParsingError("Expected key in double quotes"s);
+                }
+                ParseString();
+                Expect(':', "Expected ':' after key");
+                ParseValue();
+                ++count;
+                if (Peek() == ',') {
+                    ++next_;
+                    continue;
+                }
+                break;
+            }
+        }
+        Expect('}', "Failed to read dictionary");
+        CloseContainer(start, count);
+    }
+
+    size_t OpenContainer(TokenType type) {
+        ++next_;
+        doc_.tape_.push_back({type, 0, 0});
+        return doc_.tape_.size() - 1;
+    }
+
+    void CloseContainer(size_t start, uint32_t count) {
+        auto& token = doc_.tape_[start];
+        token.size = count;
+        token.payload = doc_.tape_.size();
+    }
+
+    void ParseString() {
+        const size_t begin = index_[next_++] + 1;
+        size_t pos = begin;
+        while (text_[pos] != '"' && text_[pos] != '\\') {
+            if (text_[pos] == '\n' || text_[pos] == '\r') {
+                throw ParsingError("Unexpected end of line"s);
+            }
+            ++pos;
+        }
+        if (text_[pos] == '"') {
+            doc_.tape_.push_back({TokenType::STRING, static_cast<uint32_t>(pos - begin), begin});
+            return;
+        }
+
+        // Строка с escape-последовательностями раскодируется в отдельный буфер
+        auto& decoded = doc_.decoded_;
+        const size_t offset = decoded.size();
+        decoded.append(text_.substr(begin, pos - begin));
+        while (text_[pos] != '"') {
+            const char c = text_[pos++];
+            if (c == '\n' || c == '\r') {
+                throw ParsingError("Unexpected end of line"s);
+            }
+            if (c != '\\') {
+                decoded.push_back(c);
+                continue;
+            }
+            switch (const char escaped = text_[pos++]) {
+                case 'n': decoded.push_back('\n'); break;
+                case 't': decoded.push_back('\t'); break;
+                case 'r': decoded.push_back('\r'); break;
+                case '"': decoded.push_back('"'); break;
+                case '\\': decoded.push_back('\\'); break;
+                default:
+                    throw ParsingError("Unrecognized escape sequence \\"s + escaped);
+            }
+        }
+        doc_.tape_.push_back({TokenType::DECODED_STRING, static_cast<uint32_t>(decoded.size() - offset), offset});
+    }
+
+    void ParseScalar() {
+        const size_t begin = index_[next_++];
+        size_t end = begin;
+        while (end < text_.size() && !IsSpace(text_[end]) && !IsStructural(text_[end]) && text_[end] != '"') {
+            ++end;
+        }
+        const string_view scalar = text_.substr(begin, end - begin);
+
+        if (scalar.empty()) {
+            throw ParsingError("Failed to read JSON value"s);
+        } else if (scalar == "null"sv) {
+            doc_.tape_.push_back({TokenType::NULL_VALUE, 0, 0});
+        } else if (scalar == "true"sv) {
+            doc_.tape_.push_back({TokenType::TRUE_VALUE, 0, 0});
+        } else if (scalar == "false"sv) {
+            doc_.tape_.push_back({TokenType::FALSE_VALUE, 0, 0});
+        } else {
+            ParseNumber(scalar);
+        }
+    }
+
+    void ParseNumber(string_view scalar) {
+        // Проверяем грамматику числа JSON: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+        size_t pos = 0;
+        auto skip_digits = [&] {
+            const size_t start = pos;
+            while (pos < scalar.size() && isdigit(static_cast<unsigned char>(scalar[pos]))) {
+                ++pos;
+            }
+            if (pos == start) {
+                throw ParsingError("Invalid literal: "s + string(scalar));
+            }
+        };
+
+        if (pos < scalar.size() && scalar[pos] == '-') {
+            ++pos;
+        }
+        if (pos < scalar.size() && scalar[pos] == '0') {
+            ++pos;
+        } else {
+            skip_digits();
+        }
+        bool is_int = true;
+        if (pos < scalar.size() && scalar[pos] == '.') {
+            ++pos;
+            skip_digits();
+            is_int = false;
+        }
+        if (pos < scalar.size() && (scalar[pos] == 'e' || scalar[pos] == 'E')) {
+            ++pos;
+            if (pos < scalar.size() && (scalar[pos] == '+' || scalar[pos] == '-')) {
+                ++pos;
+            }
+            skip_digits();
+            is_int = false;
+        }
+        if (pos != scalar.size()) {
+            throw ParsingError("Invalid literal: "s + string(scalar));
+        }
+
+        const char* first = scalar.data();
+        const char* last = scalar.data() + scalar.size();
+        if (is_int) {
+            int value = 0;
+            if (from_chars(first, last, value).ec == errc{}) {
+                doc_.tape_.push_back({TokenType::INT, 0, static_cast<uint64_t>(static_cast<int64_t>(value))});
+                return;
+            }
+        }
+        double value = 0.;
+        if (from_chars(first, last, value).ec != errc{}) {
+            throw ParsingError("Failed to convert "s + string(scalar) + " to number"s);
+        }
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(bits));
+        doc_.tape_.push_back({TokenType::DOUBLE, 0, bits});
+    }
+
+    Document& doc_;
+    string_view text_;
+    const vector<uint32_t>& index_;
+    size_t next_ = 0;
+};
+
+// ---------- Document ------------------
+
+Document Document::Parse(string text) {
+    Document doc;
+    doc.text_ = move(text);
+    const vector<uint32_t> index = BuildStructuralIndex(doc.text_);
+    TapeBuilder(doc, index).Build();
+    doc.tape_.shrink_to_fit();
+    return doc;
+}
+
+Document Document::Parse(istream& input) {
+    return Parse(string(istreambuf_iterator<char>(input), istreambuf_iterator<char>()));
+}
+
+Value Document::GetRoot() const {
+    return {*this, 0};
+}
+
+string_view Document::GetString(const Token& token) const {
+    const string_view source = (token.type == TokenType::DECODED_STRING) ? string_view(decoded_) : string_view(text_);
+    return source.substr(token.payload, token.size);
+}
+
+size_t Document::GetMemoryUsage() const {
+    return text_.capacity() + tape_.capacity() * sizeof(Token) + decoded_.capacity();
+}
+
+// ---------- Value ------------------
+
+const Token& Value::GetToken() const {
+    return doc_->GetToken(index_);
+}
+
+bool Value::IsNull() const {
+    return GetToken().type == TokenType::NULL_VALUE;
+}
+
+bool Value::IsBool() const {
+    const auto type = GetToken().type;
+    return type == TokenType::TRUE_VALUE || type == TokenType::FALSE_VALUE;
+}
+
+bool Value::IsInt() const {
+    return GetToken().type == TokenType::INT;
+}
+
+bool Value::IsDouble() const {
+    const auto type = GetToken().type;
+    return type == TokenType::INT || type == TokenType::DOUBLE;
+}
+
+bool Value::IsPureDouble() const {
+    return GetToken().type == TokenType::DOUBLE;
+}
+
+bool Value::IsString() const {
+    const auto type = GetToken().type;
+    return type == TokenType::STRING || type == TokenType::DECODED_STRING;
+}
+
+bool Value::IsArray() const {
+    return GetToken().type == TokenType::ARRAY;
+}
+
+bool Value::IsMap() const {
+    return GetToken().type == TokenType::OBJECT;
+}
+
+bool Value::AsBool() const {
+    if (!IsBool()) {
+        throw logic_error("Not a bool");
+    }
+    return GetToken().type == TokenType::TRUE_VALUE;
+}
+
+int Value::AsInt() const {
+    if (!IsInt()) {
+        throw logic_error("Not an int");
+    }
+    return static_cast<int>(static_cast<int64_t>(GetToken().payload));
+}
+
+double Value::AsDouble() const {
+    if (IsInt()) {
+        return static_cast<double>(AsInt());
+    } else if (IsPureDouble()) {
+        double value = 0.;
+        memcpy(&value, &GetToken().payload, sizeof(value));
+        return value;
+    }
+    throw logic_error("Not a double");
+}
+
+string_view Value::AsString() const {
+    if (!IsString()) {
+        throw logic_error("Not a string");
+    }
+    return doc_->GetString(GetToken());
+}
+
+ArrayView Value::AsArray() const {
+    if (!IsArray()) {
+        throw logic_error("Not an array");
+    }
+    return {*doc_, index_};
+}
+
+ObjectView Value::AsMap() const {
+    if (!IsMap()) {
+        throw logic_error("Not a map");
+    }
+    return {*doc_, index_};
+}
+
+uint32_t Value::GetNextIndex() const {
+    const auto& token = GetToken();
+    if (token.type == TokenType::ARRAY || token.type == TokenType::OBJECT) {
+        return static_cast<uint32_t>(token.payload);
+    }
+    return index_ + 1;
+}
+
+// ---------- ArrayView ------------------
+
+ArrayView::ArrayView(const Document& doc, uint32_t index)
+    : doc_(&doc)
+    , index_(index) {
+}
+
+size_t ArrayView::size() const {
+    return doc_->GetToken(index_).size;
+}
+
+bool ArrayView::empty() const {
+    return size() == 0;
+}
+
+ArrayView::Iterator ArrayView::begin() const {
+    return {*doc_, index_ + 1};
+}
+
+ArrayView::Iterator ArrayView::end() const {
+    return {*doc_, static_cast<uint32_t>(doc_->GetToken(index_).payload)};
+}
+
+Value ArrayView::operator[](size_t index) const {
+    if (index >= size()) {
+        throw out_of_range("Array index out of range");
+    }
+    auto it = begin();
+    for (size_t i = 0; i < index; ++i) {
+        ++it;
+    }
+    return *it;
+}
+
+// ---------- ObjectView ------------------
+
+ObjectView::ObjectView(const Document& doc, uint32_t index)
+    : doc_(&doc)
+    , index_(index) {
+}
+
+size_t ObjectView::size() const {
+    return doc_->GetToken(index_).size;
+}
+
+bool ObjectView::empty() const {
+    return size() == 0;
+}
+
+ObjectView::Iterator ObjectView::begin() const {
+    return {*doc_, index_ + 1};
+}
+
+ObjectView::Iterator ObjectView::end() const {
+    return {*doc_, static_cast<uint32_t>(doc_->GetToken(index_).payload)};
+}
+
+ObjectView::Iterator ObjectView::find(string_view key) const {
+    // Объекты запросов небольшие, поэтому линейный поиск по ленте быстрее построения индекса
+    const auto last = end();
+    for (auto it = begin(); it != last; ++it) {
+        if ((*it).first == key) {
+            return it;
+        }
+    }
+    return last;
+}
+
+size_t ObjectView::count(string_view key) const {
+    return find(key) != end() ? 1 : 0;
+}
+
+Value ObjectView::at(string_view key) const {
+    const auto it = find(key);
+    if (it == end()) {
+        throw out_of_range("Key not found: "s + string(key));
+    }
+    return (*it).second;
+}
+
+} // namespace json::tape
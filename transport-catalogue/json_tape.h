@@ -0,0 +1,212 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json::tape {
+
+/*
+ * Представление JSON-документа только для чтения: плоская лента токенов.
+ * Документ разбирается в два прохода. Сначала строится структурный индекс
+ * (позиции скобок, разделителей и начал значений), затем по нему заполняется лента.
+ * Токен контейнера хранит индекс токена, следующего за контейнером, поэтому
+ * вложенные значения пропускаются без разбора
+ */
+
+enum class TokenType : uint8_t {
+    NULL_VALUE,
+    TRUE_VALUE,
+    FALSE_VALUE,
+    INT,
+    DOUBLE,
+    STRING,
+    DECODED_STRING,
+    ARRAY,
+    OBJECT,
+};
+
+struct Token {
+    TokenType type;
+    // Длина строки или число элементов контейнера
+    uint32_t size;
+    // Смещение строки, значение числа или индекс токена за концом контейнера
+    uint64_t payload;
+};
+
+class Document;
+class ArrayView;
+class ObjectView;
+
+// Курсор, указывающий на значение в ленте. Методы повторяют json::Node
+class Value {
+public:
+    Value(const Document& doc, uint32_t index)
+        : doc_(&doc)
+        , index_(index) {
+    }
+
+    bool IsNull() const;
+    bool IsBool() const;
+    bool IsInt() const;
+    bool IsDouble() const;
+    bool IsPureDouble() const;
+    bool IsString() const;
+    bool IsArray() const;
+    bool IsMap() const;
+
+    bool AsBool() const;
+    int AsInt() const;
+    double AsDouble() const;
+    std::string_view AsString() const;
+    ArrayView AsArray() const;
+    ObjectView AsMap() const;
+
+    // Индекс токена, следующего за значением вместе со всем его содержимым
+    uint32_t GetNextIndex() const;
+
+private:
+    const Token& GetToken() const;
+
+    const Document* doc_;
+    uint32_t index_;
+};
+
+class ArrayView {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Value;
+
+        Iterator(const Document& doc, uint32_t index)
+            : doc_(&doc)
+            , index_(index) {
+        }
+
+        Value operator*() const {
+            return {*doc_, index_};
+        }
+
+        Iterator& operator++() {
+            index_ = Value(*doc_, index_).GetNextIndex();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return index_ == other.index_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return index_ != other.index_;
+        }
+
+    private:
+        const Document* doc_;
+        uint32_t index_;
+    };
+
+    ArrayView(const Document& doc, uint32_t index);
+
+    size_t size() const;
+    bool empty() const;
+    Iterator begin() const;
+    Iterator end() const;
+    // Доступ по индексу пропускает предыдущие элементы, поэтому работает за O(index)
+    Value operator[](size_t index) const;
+
+private:
+    const Document* doc_;
+    uint32_t index_;
+};
+
+class ObjectView {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, Value>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator(const Document& doc, uint32_t index)
+            : doc_(&doc)
+            , index_(index) {
+        }
+
+        value_type operator*() const {
+            return {Value(*doc_, index_).AsString(), Value(*doc_, index_ + 1)};
+        }
+
+        Iterator& operator++() {
+            index_ = Value(*doc_, index_ + 1).GetNextIndex();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return index_ == other.index_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return index_ != other.index_;
+        }
+
+    private:
+        const Document* doc_;
+        uint32_t index_;
+    };
+
+    ObjectView(const Document& doc, uint32_t index);
+
+    size_t size() const;
+    bool empty() const;
+    Iterator begin() const;
+    Iterator end() const;
+    Iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    // Бросает std::out_of_range, если ключа нет
+    Value at(std::string_view key) const;
+
+private:
+    const Document* doc_;
+    uint32_t index_;
+};
+
+class Document {
+public:
+    // Бросает json::ParsingError, если текст не является корректным JSON
+    static Document Parse(std::string text);
+
+    static Document Parse(std::istream& input);
+
+    Value GetRoot() const;
+
+    const Token& GetToken(uint32_t index) const {
+        return tape_[index];
+    }
+
+    std::string_view GetString(const Token& token) const;
+
+    // Объём памяти, занятой лентой, текстом и раскодированными строками
+    size_t GetMemoryUsage() const;
+
+private:
+    friend class TapeBuilder;
+
+    Document() = default;
+
+    std::string text_;
+    std::vector<Token> tape_;
+    std::string decoded_;
+};
+
+} // namespace json::tape
@@ -0,0 +1,219 @@
+#include "json_writer.h"
+
+using namespace std;
+
+namespace json {
+
+Writer::Writer(OutputBuffer& out, const PrintSettings& settings, int indent)
+    : out_(out)
+    , settings_(settings)
+    , indent_(indent) {
+}
+
+Writer::DictKeyContext Writer::Key(string_view key) {
+    if (containers_.empty() || !containers_.back().is_dict || key_written_ || string_open_) {
+        throw logic_error("Key error"s);
+    }
+
+    auto& dict = containers_.back();
+    const PrintContext ctx = CurrentContext();
+    if (!dict.empty) {
+        out_.Write(settings_.compact ? ","sv : ", \n"sv);
+    }
+    dict.empty = false;
+    ctx.PrintIndent();
+    PrintValue(StringRef{key}, ctx);
+    out_.Write(settings_.compact ? ":"sv : ": "sv);
+    key_written_ = true;
+    return *this;
+}
+
+Writer& Writer::Value(nullptr_t) {
+    BeginValue();
+    PrintValue(nullptr, CurrentContext());
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeginValue();
+    PrintValue(value, CurrentContext());
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    BeginValue();
+    PrintValue(value, CurrentContext());
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeginValue();
+    PrintValue(value, CurrentContext());
+    return *this;
+}
+
+Writer& Writer::Value(string_view value) {
+    BeginValue();
+    PrintValue(StringRef{value}, CurrentContext());
+    return *this;
+}
+
+Writer& Writer::Value(const string& value) {
+    return Value(string_view(value));
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(string_view(value));
+}
+
+Writer& Writer::Value(const Node& node) {
+    BeginValue();
+    PrintNode(node, CurrentContext());
+    return *this;
+}
+
+Writer& Writer::BeginString() {
+    BeginValue();
+    out_.Put('"');
+    string_open_ = true;
+    return *this;
+}
+
+Writer& Writer::AppendString(string_view chunk) {
+    if (!string_open_) {
+        throw logic_error("String is not started"s);
+    }
+    PrintEscapedChars(chunk, out_);
+    return *this;
+}
+
+Writer& Writer::EndString() {
+    if (!string_open_) {
+        throw logic_error("String is not started"s);
+    }
+    out_.Put('"');
+    string_open_ = false;
+    return *this;
+}
+
+Writer& Writer::RawValue(string_view json) {
+    BeginValue();
+    out_.Write(json);
+    return *this;
+}
+
+Writer::DictItemContext Writer::StartDict() {
+    BeginValue();
+    out_.Put('{');
+    if (!settings_.compact) {
+        out_.Put('\n');
+    }
+    containers_.push_back({true});
+    return *this;
+}
+
+Writer::ArrayItemContext Writer::StartArray() {
+    BeginValue();
+    out_.Put('[');
+    if (!settings_.compact) {
+        out_.Put('\n');
+    }
+    containers_.push_back({false});
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    EndContainer(true);
+    out_.Put('}');
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    EndContainer(false);
+    out_.Put(']');
+    return *this;
+}
+
+OutputBuffer& Writer::GetBuffer() {
+    return out_;
+}
+
+const PrintSettings& Writer::GetSettings() const {
+    return settings_;
+}
+
+int Writer::GetValueIndent() const {
+    return CurrentContext().indent;
+}
+
+void Writer::BeginValue() {
+    if (string_open_) {
+        throw logic_error("String is not finished"s);
+    }
+    if (containers_.empty()) {
+        return;
+    }
+
+    auto& container = containers_.back();
+    if (container.is_dict) {
+        if (!key_written_) {
+            throw logic_error("Value`s dict key error"s);
+        }
+        key_written_ = false;
+        return;
+    }
+
+    if (!container.empty) {
+        out_.Write(settings_.compact ? ","sv : ", \n"sv);
+    }
+    container.empty = false;
+    CurrentContext().PrintIndent();
+}
+
+void Writer::EndContainer(bool is_dict) {
+    if (containers_.empty() || containers_.back().is_dict != is_dict || key_written_ || string_open_) {
+        throw logic_error(is_dict ? "Not a Dict"s : "Not an Array"s);
+    }
+
+    containers_.pop_back();
+    if (!settings_.compact) {
+        out_.Put('\n');
+        CurrentContext().PrintIndent();
+    }
+}
+
+PrintContext Writer::CurrentContext() const {
+    PrintContext ctx{out_, settings_};
+    ctx.indent = indent_ + ctx.indent_step * static_cast<int>(containers_.size());
+    return ctx;
+}
+
+Writer::DictItemContext Writer::DictKeyContext::StartDict() {
+    return writer_.StartDict();
+}
+
+Writer::ArrayItemContext Writer::DictKeyContext::StartArray() {
+    return writer_.StartArray();
+}
+
+Writer::DictKeyContext Writer::DictItemContext::Key(string_view key) {
+    return writer_.Key(key);
+}
+
+Writer& Writer::DictItemContext::EndDict() {
+    return writer_.EndDict();
+}
+
+Writer::DictItemContext Writer::ArrayItemContext::StartDict() {
+    return writer_.StartDict();
+}
+
+Writer::ArrayItemContext Writer::ArrayItemContext::StartArray() {
+    return writer_.StartArray();
+}
+
+Writer& Writer::ArrayItemContext::EndArray() {
+    return writer_.EndArray();
+}
+
+} // namespace json
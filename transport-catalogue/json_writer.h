@@ -0,0 +1,126 @@
+#pragma once
+
+#include "json.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json {
+
+/*
+ * Потоковый writer: записывает JSON прямо в OutputBuffer, не строя дерево узлов.
+ * Формат вывода совпадает с json::Print при тех же PrintSettings.
+ * Ключи словаря выводятся в порядке вызовов Key, поэтому для совпадения с Print
+ * их следует передавать в лексикографическом порядке
+ */
+class Writer {
+public:
+    class DictKeyContext;
+    class DictItemContext;
+    class ArrayItemContext;
+
+    // indent задаёт отступ, на котором начинается значение, вложенное в уже выведенный контейнер
+    explicit Writer(OutputBuffer& out, const PrintSettings& settings = {}, int indent = 0);
+
+    DictKeyContext Key(std::string_view key);
+    Writer& Value(std::nullptr_t);
+    Writer& Value(bool value);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(std::string_view value);
+    Writer& Value(const std::string& value);
+    Writer& Value(const char* value);
+    Writer& Value(const Node& node);
+    // Строковое значение, передаваемое частями: фрагменты экранируются сразу в выходной буфер,
+    // поэтому длинную строку не нужно собирать целиком
+    Writer& BeginString();
+    Writer& AppendString(std::string_view chunk);
+    Writer& EndString();
+    // Готовый текст значения, выведенный другим Writer с теми же PrintSettings и отступом,
+    // на котором значение начинается здесь
+    Writer& RawValue(std::string_view json);
+    DictItemContext StartDict();
+    ArrayItemContext StartArray();
+    Writer& EndDict();
+    Writer& EndArray();
+
+    OutputBuffer& GetBuffer();
+
+    const PrintSettings& GetSettings() const;
+
+    // Отступ, на котором начнётся очередной элемент текущего контейнера
+    int GetValueIndent() const;
+
+private:
+    struct Container {
+        bool is_dict;
+        bool empty = true;
+    };
+
+    // Выводит разделитель и отступ перед очередным значением
+    void BeginValue();
+    void EndContainer(bool is_dict);
+    PrintContext CurrentContext() const;
+
+    OutputBuffer& out_;
+    PrintSettings settings_;
+    int indent_;
+    std::vector<Container> containers_;
+    bool key_written_ = false;
+    bool string_open_ = false;
+};
+
+class Writer::DictKeyContext {
+public:
+    DictKeyContext(Writer& writer)
+    : writer_(writer) {}
+
+    template <typename ValueType>
+    DictItemContext Value(ValueType&& value);
+    ArrayItemContext StartArray();
+    DictItemContext StartDict();
+
+private:
+    Writer& writer_;
+};
+
+class Writer::DictItemContext {
+public:
+    DictItemContext(Writer& writer)
+    : writer_(writer) {}
+
+    DictKeyContext Key(std::string_view key);
+    Writer& EndDict();
+
+private:
+    Writer& writer_;
+};
+
+class Writer::ArrayItemContext {
+public:
+    ArrayItemContext(Writer& writer)
+    : writer_(writer) {}
+
+    template <typename ValueType>
+    ArrayItemContext Value(ValueType&& value);
+    DictItemContext StartDict();
+    ArrayItemContext StartArray();
+    Writer& EndArray();
+
+private:
+    Writer& writer_;
+};
+
+template <typename ValueType>
+Writer::DictItemContext Writer::DictKeyContext::Value(ValueType&& value) {
+    return writer_.Value(std::forward<ValueType>(value));
+}
+
+template <typename ValueType>
+Writer::ArrayItemContext Writer::ArrayItemContext::Value(ValueType&& value) {
+    return writer_.Value(std::forward<ValueType>(value));
+}
+
+} // namespace json
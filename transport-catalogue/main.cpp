@@ -1,20 +1,209 @@
 #include "json.h"
+#include "json_binary.h"
 #include "json_reader.h"
+#include "memory_usage.h"
+#include "profiling.h"
+#include "server.h"
 #include "transport_catalogue.h"
 
+#include <charconv>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
 
 using namespace std;
 using namespace transport_catalogue;
 
-int main() {
+namespace {
+
+optional<unsigned> ParseCount(string_view arg) {
+    unsigned value = 0;
+    const auto [ptr, ec] = from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (ec != errc{} || ptr != arg.data() + arg.size() || value == 0) {
+        return nullopt;
+    }
+    return value;
+}
+
+// Загружает запросы в текстовом JSON или в двоичном формате, определяя его по сигнатуре
+json::Document LoadRequests(istream& input, const json::ParseSettings& parse_settings) {
+    profiling::PhaseTimer timer(profiling::Phase::PARSE);
+    string data(istreambuf_iterator<char>(input), istreambuf_iterator<char>{});
+    if (json::binary::IsBinary(data)) {
+        return json::binary::Decode(move(data));
+    }
+    return json::LoadBuffer(move(data), parse_settings);
+}
+
+// Строит справочник, карту и маршрутизатор по документу и отвечает на запросы по одному,
+// пока не закончится стандартный ввод или, если задан socket_path, бесконечно
+void RunServer(const json::Document& document, unsigned threads, const optional<string>& socket_path,
+               bool memory_report, const routing::RoutingOptions& routing_options) {
+    database::TransportCatalogue catalogue;
+    processing::JsonReader reader(catalogue);
+    reader.ProcessBaseRequests(document);
+    map_renderer::MapRenderer renderer(reader.ProcessRenderSettings(document), catalogue);
+    renderer.SetThreads(threads);
+    reader.SetRoutingOptions(routing_options);
+    if (memory_report) {
+        reader.PrintRouterEstimate(cerr);
+    }
+    // Запросы заранее неизвестны, поэтому способ поиска выбирается по бюджету памяти
+    const routing::Router router(reader.ProcessRouterSettings(document), catalogue, {}, routing_options);
+    if (memory_report) {
+        routing::PrintRoutingPlan(cerr, router.GetPlan());
+        reader.PrintMemoryUsage(cerr, renderer, router);
+    }
+
+    serving::Server server(reader, renderer, router);
+    if (socket_path) {
+        server.ServeSocket(*socket_path);
+    } else {
+        server.Serve(cin, cout);
+    }
+}
+
+// Выводит собранную статистику в stderr при выходе из main любым путём
+class StatsReport {
+public:
+    ~StatsReport() {
+        if (enabled_) {
+            profiling::PrintStats(cerr);
+        }
+    }
+
+    void Enable() {
+        enabled_ = true;
+    }
+
+private:
+    bool enabled_ = false;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    json::PrintSettings print_settings;
+    json::ParseSettings parse_settings;
+    bool to_binary = false;
+    optional<string> serve_file;
+    optional<string> socket_path;
+    optional<string> connect_path;
+    StatsReport stats_report;
+    bool memory_report = false;
+    routing::RoutingOptions routing_options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (arg == "--compact"sv) {
+            // Вывод без отступов для машинной обработки
+            print_settings.compact = true;
+        } else if (arg == "--threads"sv && i + 1 < argc) {
+            const auto threads = ParseCount(argv[++i]);
+            if (!threads) {
+                cerr << "Invalid thread count: "s << argv[i] << endl;
+                return 1;
+            }
+            parse_settings.threads = *threads;
+        } else if (arg == "--stats"sv) {
+            // Сбор времени этапов и задержек запросов с отчётом в stderr при завершении
+            if (!profiling::STATS_COMPILED) {
+                cerr << "Statistics are not compiled in"s << endl;
+                return 1;
+            }
+            profiling::EnableStats(true);
+            stats_report.Enable();
+        } else if (arg == "--memory"sv) {
+            // Отчёт о памяти структур данных в stderr
+            memory_report = true;
+        } else if (arg == "--router-engine"sv && i + 1 < argc) {
+            // Способ поиска маршрутов вместо выбранного по размеру сети и числу запросов
+            routing_options.engine = routing::FindRoutingEngine(argv[++i]);
+            if (!routing_options.engine) {
+                cerr << "Unknown routing engine: "s << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--router-memory"sv && i + 1 < argc) {
+            // Память в мегабайтах, которую может занять способ поиска маршрутов
+            const auto megabytes = ParseCount(argv[++i]);
+            if (!megabytes) {
+                cerr << "Invalid router memory: "s << argv[i] << endl;
+                return 1;
+            }
+            routing_options.memory_budget = size_t{*megabytes} << 20;
+        } else if (arg == "--plan-memory"sv && i + 2 < argc) {
+            // Оценка памяти маршрутизатора для сети из заданного числа остановок и автобусов без обработки запросов.
+            // Учитывает --router-engine и --router-memory, заданные раньше
+            const auto stops = ParseCount(argv[++i]);
+            const auto buses = ParseCount(argv[++i]);
+            if (!stops || !buses) {
+                cerr << "Invalid network size: "s << argv[i - 1] << ' ' << argv[i] << endl;
+                return 1;
+            }
+            routing::NetworkSize size;
+            size.stops = *stops;
+            size.buses = *buses;
+            memory::PrintMemoryUsage(cout, "router_estimate"sv, routing::EstimateRouterMemory(size, {}, routing_options));
+            return 0;
+        } else if (arg == "--to-binary"sv) {
+            // Преобразование входного JSON в двоичный формат без обработки запросов
+            to_binary = true;
+        } else if (arg == "--serve"sv && i + 1 < argc) {
+            // Режим сервера: справочник строится по файлу один раз, затем запросы
+            // принимаются по одному в строке со стандартного ввода или через --socket
+            serve_file = argv[++i];
+        } else if (arg == "--socket"sv && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (arg == "--connect"sv && i + 1 < argc) {
+            // Клиент сервера: строки стандартного ввода отправляются на сокет, ответы выводятся
+            connect_path = argv[++i];
+        } else {
+            cerr << "Unknown argument: "s << arg << endl;
+            return 1;
+        }
+    }
+
+    if (socket_path && !serve_file) {
+        cerr << "--socket requires --serve"s << endl;
+        return 1;
+    }
+
     try {
-        auto document = json::Load(cin);
+        if (connect_path) {
+            serving::RunClient(*connect_path, cin, cout);
+            return 0;
+        }
+
+        if (serve_file) {
+            ifstream input(*serve_file, ios::binary);
+            if (!input) {
+                cerr << "Cannot open "s << *serve_file << endl;
+                return 1;
+            }
+            RunServer(LoadRequests(input, parse_settings), parse_settings.threads, socket_path, memory_report,
+                      routing_options);
+            return 0;
+        }
+
+        auto document = LoadRequests(cin, parse_settings);
+
+        if (to_binary) {
+            const string encoded = json::binary::Encode(document);
+            cout.write(encoded.data(), static_cast<streamsize>(encoded.size()));
+            return 0;
+        }
     
         database::TransportCatalogue catalogue;
         processing::JsonReader reader(catalogue);
+        reader.SetThreads(parse_settings.threads);
+        reader.SetRoutingOptions(routing_options);
+        if (memory_report) {
+            reader.SetMemoryReport(&cerr);
+        }
 
-        reader.ProcessDocument(document, cout);
+        reader.ProcessDocument(document, cout, print_settings);
         
     } catch (const json::ParsingError& e) {
         cerr << "Error parsing input file: "s << e.what() << endl;   
@@ -1,6 +1,13 @@
 #include "map_renderer.h"
+#include "profiling.h"
 
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <numeric>
 #include <string>
+#include <thread>
 
 using namespace std;
 
@@ -10,7 +17,135 @@ bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
 
-vector<Coordinates> MapRenderer::CollectStopCoords(const set<const Bus*, BusNameComparator>& buses) const {
+namespace {
+
+// Квадрат расстояния от точки p до отрезка [a, b]
+double SquaredDistanceToSegment(Point p, Point a, Point b) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double length_sq = dx * dx + dy * dy;
+    double t = 0;
+    if (length_sq > 0) {
+        t = clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / length_sq, 0., 1.);
+    }
+    const double ex = a.x + t * dx - p.x;
+    const double ey = a.y + t * dy - p.y;
+    return ex * ex + ey * ey;
+}
+
+// Алгоритм Дугласа — Пекера: оставляет концы и точки, отклоняющиеся от упрощённой линии больше чем на tolerance
+vector<Point> SimplifyPolyline(const vector<Point>& points, double tolerance) {
+    if (points.size() <= 2) {
+        return points;
+    }
+
+    const double tolerance_sq = tolerance * tolerance;
+    vector<bool> keep(points.size());
+    keep.front() = keep.back() = true;
+    vector<pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+
+        double max_distance_sq = 0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double distance_sq = SquaredDistanceToSegment(points[i], points[first], points[last]);
+            if (distance_sq > max_distance_sq) {
+                max_distance_sq = distance_sq;
+                farthest = i;
+            }
+        }
+
+        if (max_distance_sq > tolerance_sq) {
+            keep[farthest] = true;
+            ranges.push_back({first, farthest});
+            ranges.push_back({farthest, last});
+        }
+    }
+
+    vector<Point> result;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (keep[i]) {
+            result.push_back(points[i]);
+        }
+    }
+    return result;
+}
+
+// Число элементов слоя, для которых недостающие фрагменты строятся за один проход
+constexpr size_t FRAGMENT_WINDOW = 4096;
+// Накопленный текст передаётся получателю, когда буфер достигает этого размера
+constexpr size_t FRAGMENT_FLUSH_SIZE = 64 << 10;
+
+// Вызывает fn(begin, end) для частей интервала [0, count) в threads потоках.
+// Первое исключение из fn пробрасывается после завершения всех потоков
+template <typename Fn>
+void ParallelFor(size_t count, unsigned threads, Fn fn) {
+    if (threads <= 1 || count < 2) {
+        fn(size_t{0}, count);
+        return;
+    }
+
+    // Частей больше, чем потоков, чтобы потоки, получившие короткие элементы, не простаивали
+    const size_t chunks = min(count, size_t{threads} * 8);
+    atomic<size_t> next_chunk{0};
+    exception_ptr error;
+    mutex error_mutex;
+    const auto worker = [&] {
+        for (size_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++) {
+            try {
+                fn(count * chunk / chunks, count * (chunk + 1) / chunks);
+            } catch (...) {
+                lock_guard lock(error_mutex);
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned i = 1; i < min<size_t>(threads, chunks); ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : workers) {
+        t.join();
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+size_t GetPolylinesBytes(const vector<vector<Point>>& polylines) {
+    size_t bytes = memory::GetVectorBytes(polylines);
+    for (const auto& polyline : polylines) {
+        bytes += memory::GetVectorBytes(polyline);
+    }
+    return bytes;
+}
+
+size_t GetBoundsBytes(const vector<vector<Rect>>& bounds) {
+    size_t bytes = memory::GetVectorBytes(bounds);
+    for (const auto& item_bounds : bounds) {
+        bytes += memory::GetVectorBytes(item_bounds);
+    }
+    return bytes;
+}
+
+template <typename Fragments>
+size_t GetFragmentsBytes(const Fragments& fragments) {
+    size_t bytes = memory::GetHashTableBytes(fragments);
+    for (const auto& [item, fragment] : fragments) {
+        bytes += memory::GetStringBytes(fragment.text);
+    }
+    return bytes;
+}
+
+}  // namespace
+
+vector<Coordinates> MapRenderer::CollectStopCoords(const vector<const Bus*>& buses) const {
     vector<Coordinates> stops_coords;
     for (const auto* bus : buses) {
         for (const auto* stop : bus->stops) {
@@ -26,154 +161,646 @@ unique_ptr<SphereProjector> MapRenderer::CreateProjector(const vector<Coordinate
         settings_.width, settings_.height, settings_.padding);
 }
 
-void MapRenderer::RenderRoutePolylines(const set<const Bus*, BusNameComparator>& buses, Document& doc) const {
-    size_t color_num = 0;
+vector<const Stop*> MapRenderer::GetRouteEndStops(const Bus& bus) const {
+    vector<const Stop*> route_end_stops;
+    const Stop* first_stop = bus.stops.front();
+    route_end_stops.push_back(first_stop);
+    if (!bus.is_circular) {
+        const Stop* last_stop = bus.stops[bus.stops.size() / 2];
+        if (first_stop != last_stop) {
+            route_end_stops.push_back(last_stop);
+        }
+    }
+    return route_end_stops;
+}
 
-    for (const auto* bus : buses) {
-        if (bus->stops.empty()) {
+Rect MapRenderer::GetLabelBounds(Point point, Point offset, uint32_t font_size, string_view text) const {
+    // Оценка сверху: ширина символа не больше размера шрифта, а каждый байт UTF-8 считается символом
+    const double x = point.x + offset.x;
+    const double y = point.y + offset.y;
+    const double size = static_cast<double>(font_size);
+    const Rect bounds{x, y - size, x + size * static_cast<double>(text.size()), y + size / 2};
+    return bounds.Expanded(settings_.underlayer_width / 2);
+}
+
+Point MapRenderer::GetLabelOffset(Point offset, uint32_t font_size, string_view text, uint8_t position) const {
+    // Отражённая надпись занимает область, симметричную относительно точки области из GetLabelBounds
+    const double size = static_cast<double>(font_size);
+    if (position & 1) {
+        offset.x = -offset.x - size * static_cast<double>(text.size());
+    }
+    if (position & 2) {
+        offset.y = -offset.y + size / 2;
+    }
+    return offset;
+}
+
+uint8_t MapRenderer::GetBusLabelPosition(uint32_t id, size_t index) const {
+    return layout_.bus_label_positions.empty() ? 0 : layout_.bus_label_positions[id][index];
+}
+
+uint8_t MapRenderer::GetStopLabelPosition(uint32_t id) const {
+    return layout_.stop_label_positions.empty() ? 0 : layout_.stop_label_positions[id];
+}
+
+void MapRenderer::PlaceLabels() {
+    const auto& projector = *layout_.projector;
+    const uint32_t max_font_size = max(settings_.bus_label_font_size, settings_.stop_label_font_size);
+    OccupancyGrid grid(Rect{0, 0, settings_.width, settings_.height}, max<double>(max_font_size, 1));
+
+    const auto place = [&](Point point, Point offset, uint32_t font_size, string_view text) {
+        for (uint8_t position = 0; position < LABEL_HIDDEN; ++position) {
+            const Point label_offset = GetLabelOffset(offset, font_size, text, position);
+            if (grid.TryInsert(GetLabelBounds(point, label_offset, font_size, text))) {
+                return position;
+            }
+        }
+        return LABEL_HIDDEN;
+    };
+
+    layout_.bus_label_positions.assign(layout_.buses.size(), {LABEL_HIDDEN, LABEL_HIDDEN});
+    for (size_t id = 0; id < layout_.buses.size(); ++id) {
+        const Bus& bus = *layout_.buses[id];
+        const auto end_stops = GetRouteEndStops(bus);
+        for (size_t i = 0; i < end_stops.size(); ++i) {
+            layout_.bus_label_positions[id][i] = place(projector(end_stops[i]->coords), settings_.bus_label_offset,
+                                                       settings_.bus_label_font_size, bus.name);
+        }
+    }
+
+    layout_.stop_label_positions.resize(layout_.stops.size());
+    for (size_t id = 0; id < layout_.stops.size(); ++id) {
+        const Stop& stop = *layout_.stops[id];
+        layout_.stop_label_positions[id] = place(projector(stop.coords), settings_.stop_label_offset,
+                                                 settings_.stop_label_font_size, stop.name);
+    }
+}
+
+vector<Rect> MapRenderer::GetBusBounds(uint32_t id) const {
+    const Bus& bus = *layout_.buses[id];
+    const auto& projector = *layout_.projector;
+    vector<Rect> bounds;
+    Point prev = projector(bus.stops.front()->coords);
+    bounds.push_back(Rect{prev.x, prev.y, prev.x, prev.y}.Expanded(settings_.line_width / 2));
+    for (size_t i = 1; i < bus.stops.size(); ++i) {
+        const Point point = projector(bus.stops[i]->coords);
+        const Rect segment{min(prev.x, point.x), min(prev.y, point.y), max(prev.x, point.x), max(prev.y, point.y)};
+        bounds.push_back(segment.Expanded(settings_.line_width / 2));
+        prev = point;
+    }
+    const auto end_stops = GetRouteEndStops(bus);
+    for (size_t i = 0; i < end_stops.size(); ++i) {
+        const uint8_t position = GetBusLabelPosition(id, i);
+        if (position == LABEL_HIDDEN) {
             continue;
         }
+        const Point offset = GetLabelOffset(settings_.bus_label_offset, settings_.bus_label_font_size, bus.name, position);
+        bounds.push_back(GetLabelBounds(projector(end_stops[i]->coords), offset, settings_.bus_label_font_size, bus.name));
+    }
+    return bounds;
+}
+
+vector<Rect> MapRenderer::GetStopBounds(uint32_t id) const {
+    const Stop& stop = *layout_.stops[id];
+    const Point point = (*layout_.projector)(stop.coords);
+    vector<Rect> bounds{Rect{point.x, point.y, point.x, point.y}.Expanded(settings_.stop_radius)};
+    if (const uint8_t position = GetStopLabelPosition(id); position != LABEL_HIDDEN) {
+        const Point offset = GetLabelOffset(settings_.stop_label_offset, settings_.stop_label_font_size, stop.name, position);
+        bounds.push_back(GetLabelBounds(point, offset, settings_.stop_label_font_size, stop.name));
+    }
+    return bounds;
+}
+
+void MapRenderer::UpdateLayout() {
+    const uint64_t version = catalogue_.GetVersion();
+    if (layout_version_ == version) {
+        return;
+    }
+    profiling::PhaseTimer timer(profiling::Phase::MAP_LAYOUT);
 
-        vector<const Stop*> bus_stops {bus->stops.begin(), bus->stops.end()};
-        Polyline polyline;
+    layout_ = Layout{};
+    map_svg_.reset();
+    map_svg_too_large_ = false;
+    tile_svgs_.clear();
 
-        for (const auto* stop : bus_stops) {
-            polyline.AddPoint((*projector_)(stop->coords));
+    if (auto all_buses = catalogue_.GetAllBuses()) {
+        for (const auto* bus : *all_buses) {
+            if (!bus->stops.empty()) {
+                layout_.buses.push_back(bus);
+            }
+        }
+    }
+    if (auto all_stops = catalogue_.GetAllStops()) {
+        layout_.stops.assign(all_stops->begin(), all_stops->end());
+    }
+    layout_.projector = CreateProjector(CollectStopCoords(layout_.buses));
+    for (const auto* bus : layout_.buses) {
+        auto& points = layout_.routes.emplace_back();
+        for (const auto* stop : bus->stops) {
+            points.push_back((*layout_.projector)(stop->coords));
         }
+    }
+    if (settings_.avoid_label_overlap) {
+        PlaceLabels();
+    }
+
+    // Новые остановки за прежними границами карты сдвигают все элементы, и прошлые фрагменты непригодны
+    if (!fragments_.projector || *fragments_.projector != *layout_.projector) {
+        fragments_ = FragmentCache{};
+        fragments_.projector = *layout_.projector;
+    }
 
-        polyline.SetFillColor(NoneColor)
-                .SetStrokeColor(settings_.color_palette[color_num])
-                .SetStrokeWidth(settings_.line_width)
-                .SetStrokeLineCap(StrokeLineCap::ROUND)
-                .SetStrokeLineJoin(StrokeLineJoin::ROUND);
-        
-        if (color_num < settings_.color_palette.size() - 1) {
-            ++color_num;
-        } else {
-            color_num = 0;
+    layout_version_ = version;
+}
+
+int MapRenderer::GetZoomLevel(const Rect& viewport) const {
+    const double scale = min(settings_.width / (viewport.max_x - viewport.min_x),
+                             settings_.height / (viewport.max_y - viewport.min_y));
+    // Для вырожденной или некорректной области scale может быть бесконечным или NaN
+    if (!(scale >= 2)) {
+        return 0;
+    }
+    return min(static_cast<int>(log2(scale)), MAX_TILE_ZOOM);
+}
+
+const vector<vector<Point>>& MapRenderer::GetRoutes(int zoom) {
+    if (settings_.simplify_tolerance <= 0) {
+        return layout_.routes;
+    }
+
+    auto& routes = layout_.simplified_routes[zoom];
+    if (routes.empty() && !layout_.routes.empty()) {
+        // При масштабе zoom пиксель соответствует 2^-zoom единицам координат карты
+        const double tolerance = ldexp(settings_.simplify_tolerance, -zoom);
+        routes.reserve(layout_.routes.size());
+        for (const auto& points : layout_.routes) {
+            routes.push_back(SimplifyPolyline(points, tolerance));
         }
-        
-        doc.Add(polyline);
     }
+    return routes;
 }
 
-void MapRenderer::RenderRouteLabels(const set<const Bus*, BusNameComparator>& buses, Document& doc) const {
-    size_t color_num = 0;
+const MapRenderer::SpatialIndex& MapRenderer::GetSpatialIndex() {
+    if (layout_.index) {
+        return *layout_.index;
+    }
 
-    for (const auto* bus : buses) {
-        if (bus->stops.empty()) {
+    SpatialIndex index;
+    for (uint32_t id = 0; id < layout_.buses.size(); ++id) {
+        index.bus_bounds.push_back(GetBusBounds(id));
+    }
+    for (uint32_t id = 0; id < layout_.stops.size(); ++id) {
+        index.stop_bounds.push_back(GetStopBounds(id));
+    }
+    const Rect map_bounds{0, 0, settings_.width, settings_.height};
+    index.bus_index = GridIndex(map_bounds, index.bus_bounds);
+    index.stop_index = GridIndex(map_bounds, index.stop_bounds);
+    return layout_.index.emplace(move(index));
+}
+
+MapRenderer::MapStyles MapRenderer::AddStyles(CompactDocument& doc) const {
+    MapStyles styles;
+
+    // Стили линий и надписей маршрутов зависят только от цвета палитры, поэтому создаются один раз
+    for (const auto& color : settings_.color_palette) {
+        PathStyle style;
+        style.fill_color = NoneColor;
+        style.stroke_color = color;
+        style.stroke_width = settings_.line_width;
+        style.stroke_line_cap = StrokeLineCap::ROUND;
+        style.stroke_line_join = StrokeLineJoin::ROUND;
+        styles.route_lines.push_back(doc.AddStyle(style));
+    }
+
+    TextStyle route_background_style;
+    route_background_style.font_size = settings_.bus_label_font_size;
+    route_background_style.font_family = "Verdana"s;
+    route_background_style.font_weight = "bold"s;
+    route_background_style.path.fill_color = settings_.underlayer_color;
+    route_background_style.path.stroke_color = settings_.underlayer_color;
+    route_background_style.path.stroke_width = settings_.underlayer_width;
+    route_background_style.path.stroke_line_cap = StrokeLineCap::ROUND;
+    route_background_style.path.stroke_line_join = StrokeLineJoin::ROUND;
+    styles.route_label_background = doc.AddStyle(route_background_style);
+
+    for (const auto& color : settings_.color_palette) {
+        TextStyle label_style;
+        label_style.font_size = settings_.bus_label_font_size;
+        label_style.font_family = "Verdana"s;
+        label_style.font_weight = "bold"s;
+        label_style.path.fill_color = color;
+        styles.route_labels.push_back(doc.AddStyle(label_style));
+    }
+
+    PathStyle symbol_style;
+    symbol_style.fill_color = "white"s;
+    styles.stop_symbol = doc.AddStyle(symbol_style);
+
+    TextStyle stop_background_style;
+    stop_background_style.font_size = settings_.stop_label_font_size;
+    stop_background_style.font_family = "Verdana"s;
+    stop_background_style.path.fill_color = settings_.underlayer_color;
+    stop_background_style.path.stroke_color = settings_.underlayer_color;
+    stop_background_style.path.stroke_width = settings_.underlayer_width;
+    stop_background_style.path.stroke_line_cap = StrokeLineCap::ROUND;
+    stop_background_style.path.stroke_line_join = StrokeLineJoin::ROUND;
+    styles.stop_label_background = doc.AddStyle(stop_background_style);
+
+    TextStyle stop_label_style;
+    stop_label_style.font_size = settings_.stop_label_font_size;
+    stop_label_style.font_family = "Verdana"s;
+    stop_label_style.path.fill_color = "black"s;
+    styles.stop_label = doc.AddStyle(stop_label_style);
+
+    return styles;
+}
+
+void MapRenderer::RenderRoutePolyline(uint32_t id, const vector<Point>& route, const MapStyles& styles,
+                                      CompactDocument& doc) const {
+    doc.AddPolyline(route, styles.route_lines[id % styles.route_lines.size()]);
+}
+
+void MapRenderer::RenderRouteLabel(uint32_t id, const MapStyles& styles, CompactDocument& doc) const {
+    const Bus& bus = *layout_.buses[id];
+    const auto end_stops = GetRouteEndStops(bus);
+    for (size_t i = 0; i < end_stops.size(); ++i) {
+        const uint8_t position = GetBusLabelPosition(id, i);
+        if (position == LABEL_HIDDEN) {
             continue;
         }
+        Point stop_point = (*layout_.projector)(end_stops[i]->coords);
+        const Point offset = GetLabelOffset(settings_.bus_label_offset, settings_.bus_label_font_size, bus.name, position);
+        doc.AddText(stop_point, offset, bus.name, styles.route_label_background);
+        doc.AddText(stop_point, offset, bus.name, styles.route_labels[id % styles.route_labels.size()]);
+    }
+}
 
-        vector<const Stop*> route_end_stops;
-        const Stop* first_stop = bus->stops.front();
-        route_end_stops.push_back(first_stop);
-        if (!bus->is_circular) {
-            const Stop* last_stop = bus->stops[bus->stops.size() / 2];
-            route_end_stops.push_back(last_stop);
-            if (first_stop == last_stop) {
-                route_end_stops.pop_back();
+void MapRenderer::RenderStopSymbol(uint32_t id, const MapStyles& styles, CompactDocument& doc) const {
+    doc.AddCircle((*layout_.projector)(layout_.stops[id]->coords), settings_.stop_radius, styles.stop_symbol);
+}
+
+void MapRenderer::RenderStopLabel(uint32_t id, const MapStyles& styles, CompactDocument& doc) const {
+    const uint8_t position = GetStopLabelPosition(id);
+    if (position == LABEL_HIDDEN) {
+        return;
+    }
+    const Stop& stop = *layout_.stops[id];
+    Point stop_point = (*layout_.projector)(stop.coords);
+    const Point offset = GetLabelOffset(settings_.stop_label_offset, settings_.stop_label_font_size, stop.name, position);
+    doc.AddText(stop_point, offset, stop.name, styles.stop_label_background);
+    doc.AddText(stop_point, offset, stop.name, styles.stop_label);
+}
+
+void MapRenderer::BuildDocument(const vector<uint32_t>& bus_ids, const vector<uint32_t>& stop_ids, int zoom,
+                                CompactDocument& doc) {
+    const MapStyles styles = AddStyles(doc);
+    const auto& routes = GetRoutes(zoom);
+    for (const uint32_t id : bus_ids) {
+        RenderRoutePolyline(id, routes[id], styles, doc);
+    }
+    for (const uint32_t id : bus_ids) {
+        RenderRouteLabel(id, styles, doc);
+    }
+    for (const uint32_t id : stop_ids) {
+        RenderStopSymbol(id, styles, doc);
+    }
+    for (const uint32_t id : stop_ids) {
+        RenderStopLabel(id, styles, doc);
+    }
+}
+
+CompactDocument MapRenderer::RenderMap() {
+    CompactDocument doc;
+    BuildMap(doc);
+    return doc;
+}
+
+void MapRenderer::BuildMap(CompactDocument& doc) {
+    UpdateLayout();
+
+    vector<uint32_t> bus_ids(layout_.buses.size());
+    iota(bus_ids.begin(), bus_ids.end(), 0);
+    vector<uint32_t> stop_ids(layout_.stops.size());
+    iota(stop_ids.begin(), stop_ids.end(), 0);
+    BuildDocument(bus_ids, stop_ids, 0, doc);
+}
+
+CompactDocument MapRenderer::RenderTile(const Rect& viewport) {
+    UpdateLayout();
+
+    // Индекс возвращает объекты из ячеек, задетых областью, лишние отбрасываются точной проверкой
+    const auto intersects = [&viewport](const vector<Rect>& bounds) {
+        return any_of(bounds.begin(), bounds.end(), [&viewport](const Rect& rect) {
+            return rect.Intersects(viewport);
+        });
+    };
+
+    const SpatialIndex& index = GetSpatialIndex();
+
+    vector<uint32_t> bus_ids = index.bus_index.Query(viewport);
+    bus_ids.erase(remove_if(bus_ids.begin(), bus_ids.end(), [&](uint32_t id) {
+        return !intersects(index.bus_bounds[id]);
+    }), bus_ids.end());
+
+    vector<uint32_t> stop_ids = index.stop_index.Query(viewport);
+    stop_ids.erase(remove_if(stop_ids.begin(), stop_ids.end(), [&](uint32_t id) {
+        return !intersects(index.stop_bounds[id]);
+    }), stop_ids.end());
+
+    CompactDocument doc;
+    BuildDocument(bus_ids, stop_ids, GetZoomLevel(viewport), doc);
+    doc.SetViewBox({viewport.min_x, viewport.min_y}, {viewport.max_x - viewport.min_x, viewport.max_y - viewport.min_y});
+    return doc;
+}
+
+const string& MapRenderer::GetMapSvg() {
+    UpdateLayout();
+    if (!map_svg_) {
+        string svg;
+        WriteMapFragments([&svg](string_view chunk) {
+            svg += chunk;
+        });
+        CompactDocument().RenderFooter(svg);
+        map_svg_ = move(svg);
+    }
+    return *map_svg_;
+}
+
+void MapRenderer::StreamMapSvg(const CompactDocument::TextSink& sink) {
+    StreamMap(CompactDocument(), sink);
+}
+
+void MapRenderer::StreamRouteMapSvg(const vector<RouteLeg>& legs, const CompactDocument::TextSink& sink) {
+    UpdateLayout();
+    CompactDocument overlay;
+    BuildRouteOverlay(legs, overlay);
+    StreamMap(overlay, sink);
+}
+
+void MapRenderer::StreamMap(const CompactDocument& overlay, const CompactDocument::TextSink& sink) {
+    UpdateLayout();
+    string tail;
+    overlay.RenderBody(tail);
+    string footer;
+    overlay.RenderFooter(footer);
+    tail += footer;
+
+    if (map_svg_) {
+        // Элементы наложения должны оказаться перед закрывающим тегом карты
+        sink(string_view(*map_svg_).substr(0, map_svg_->size() - footer.size()));
+        sink(tail);
+        return;
+    }
+
+    // Текст копится для кэша, пока не превысит предел
+    string svg;
+    WriteMapFragments([&](string_view chunk) {
+        sink(chunk);
+        if (map_svg_too_large_) {
+            return;
+        }
+        if (svg.size() + chunk.size() + footer.size() > MAX_CACHED_SVG_SIZE) {
+            map_svg_too_large_ = true;
+            string().swap(svg);
+            return;
+        }
+        svg += chunk;
+    });
+    sink(tail);
+
+    if (!map_svg_too_large_) {
+        svg += footer;
+        map_svg_ = move(svg);
+    }
+}
+
+void MapRenderer::BuildRouteOverlay(const vector<RouteLeg>& legs, CompactDocument& doc) const {
+    const auto& projector = *layout_.projector;
+    const auto get_color = [this](const Bus& bus) {
+        const auto it = lower_bound(layout_.buses.begin(), layout_.buses.end(), bus.name,
+                                    [](const Bus* lhs, const string& name) { return lhs->name < name; });
+        return settings_.color_palette[(it - layout_.buses.begin()) % settings_.color_palette.size()];
+    };
+
+    // Выделенная линия вдвое толще обычной и окантована цветом подложки, чтобы выделяться среди других маршрутов
+    PathStyle background_style;
+    background_style.fill_color = NoneColor;
+    background_style.stroke_color = settings_.underlayer_color;
+    background_style.stroke_width = settings_.line_width * 2 + settings_.underlayer_width;
+    background_style.stroke_line_cap = StrokeLineCap::ROUND;
+    background_style.stroke_line_join = StrokeLineJoin::ROUND;
+    const auto background_style_id = doc.AddStyle(background_style);
+
+    vector<Point> points;
+    for (const auto& leg : legs) {
+        if (leg.bus) {
+            points.clear();
+            for (const auto* stop : leg.stops) {
+                points.push_back(projector(stop->coords));
             }
+            doc.AddPolyline(points, background_style_id);
         }
+    }
 
-        for (const auto* stop : route_end_stops) {
-            Point stop_point = (*projector_)(stop->coords);
-            
-            Text background_text;
-            background_text.SetPosition(stop_point)
-                        .SetOffset(settings_.bus_label_offset)
-                        .SetFontSize(settings_.bus_label_font_size)
-                        .SetFontFamily("Verdana"s)
-                        .SetFontWeight("bold"s)
-                        .SetFillColor(settings_.underlayer_color)
-                        .SetStrokeColor(settings_.underlayer_color)
-                        .SetStrokeWidth(settings_.underlayer_width)
-                        .SetStrokeLineCap(StrokeLineCap::ROUND)
-                        .SetStrokeLineJoin(StrokeLineJoin::ROUND)
-                        .SetData(bus->name);
-            doc.Add(background_text);
-
-            Text label_text;
-            label_text.SetPosition(stop_point)
-                    .SetOffset(settings_.bus_label_offset)
-                    .SetFontSize(settings_.bus_label_font_size)
-                    .SetFontFamily("Verdana"s)
-                    .SetFontWeight("bold"s)
-                    .SetFillColor(settings_.color_palette[color_num])
-                    .SetData(bus->name);
-            doc.Add(label_text);
-        }
-
-        if (color_num < settings_.color_palette.size() - 1) {
-            ++color_num;
-        } else {
-            color_num = 0;
-        }
-    }
-}
-
-void MapRenderer::RenderStopSymbols(const set<const Stop*, StopNameComparator>& stops, Document& doc) const {
-    for (const auto* stop : stops) {
-        Circle circle;
-        Point stop_point = (*projector_)(stop->coords);
-        circle.SetCenter(stop_point)
-            .SetRadius(settings_.stop_radius)
-            .SetFillColor("white"s);
-        doc.Add(circle);
-    }
-}
-
-void MapRenderer::RenderStopsLabels(const set<const Stop*, StopNameComparator>& stops, Document& doc) const {
-    for (const auto* stop : stops) {
-        Point stop_point = (*projector_)(stop->coords);
-        
-        Text background_text;
-        background_text.SetPosition(stop_point)
-                    .SetOffset(settings_.stop_label_offset)
-                    .SetFontSize(settings_.stop_label_font_size)
-                    .SetFontFamily("Verdana"s)
-                    .SetFillColor(settings_.underlayer_color)
-                    .SetStrokeColor(settings_.underlayer_color)
-                    .SetStrokeWidth(settings_.underlayer_width)
-                    .SetStrokeLineCap(StrokeLineCap::ROUND)
-                    .SetStrokeLineJoin(StrokeLineJoin::ROUND)
-                    .SetData(stop->name);
-        doc.Add(background_text);
-
-        Text label_text;
-        label_text.SetPosition(stop_point)
-                .SetOffset(settings_.stop_label_offset)
-                .SetFontSize(settings_.stop_label_font_size)
-                .SetFontFamily("Verdana"s)
-                .SetFillColor("black"s)
-                .SetData(stop->name);
-        doc.Add(label_text);
-    }
-}
-
-Document MapRenderer::RenderMap() {
-    Document doc;
-    
-    auto all_buses = catalogue_.GetAllBuses();
-    if (!all_buses.has_value()) {
-        return doc;
-    }
-
-    auto all_stops = catalogue_.GetAllStops();
-    if (!all_stops.has_value()) {
-        return doc;
-    }
-
-    const set<const Bus*, BusNameComparator> buses = all_buses.value();
-    const set<const Stop*, StopNameComparator> stops = all_stops.value();
-    const auto stops_coords = CollectStopCoords(buses);
-    projector_ = CreateProjector(stops_coords);
-    RenderRoutePolylines(buses, doc);
-    RenderRouteLabels(buses, doc);
-    RenderStopSymbols(stops, doc);
-    RenderStopsLabels(stops, doc);
-    
-    return doc;
+    for (const auto& leg : legs) {
+        if (leg.bus) {
+            PathStyle style = background_style;
+            style.stroke_color = get_color(*leg.bus);
+            style.stroke_width = settings_.line_width * 2;
+            points.clear();
+            for (const auto* stop : leg.stops) {
+                points.push_back(projector(stop->coords));
+            }
+            doc.AddPolyline(points, doc.AddStyle(style));
+        }
+    }
+
+    // Отметки ожидания: в начале маршрута и на пересадках обводка цвета автобуса, на который садятся,
+    // в конце маршрута — чёрная
+    PathStyle marker_style;
+    marker_style.fill_color = "white"s;
+    marker_style.stroke_width = settings_.stop_radius;
+    for (size_t i = 0; i < legs.size(); ++i) {
+        if (legs[i].bus || legs[i].stops.empty()) {
+            continue;
+        }
+        marker_style.stroke_color = "black"s;
+        if (i + 1 < legs.size() && legs[i + 1].bus) {
+            marker_style.stroke_color = get_color(*legs[i + 1].bus);
+        }
+        doc.AddCircle(projector(legs[i].stops.front()->coords), settings_.stop_radius * 2, doc.AddStyle(marker_style));
+    }
+    if (!legs.empty() && legs.back().bus && !legs.back().stops.empty()) {
+        marker_style.stroke_color = "black"s;
+        doc.AddCircle(projector(legs.back().stops.back()->coords), settings_.stop_radius * 2, doc.AddStyle(marker_style));
+    }
+}
+
+void MapRenderer::WriteMapFragments(const CompactDocument::TextSink& sink) {
+    CompactDocument styles_doc;
+    const MapStyles styles = AddStyles(styles_doc);
+    const auto& routes = GetRoutes(0);
+    const size_t colors = settings_.color_palette.size();
+    // Положение надписи принимает LABEL_HIDDEN + 1 значений
+    const auto get_color = [colors](uint32_t id) -> uint64_t {
+        return id % colors;
+    };
+    const auto get_route_label_variant = [&](uint32_t id) -> uint64_t {
+        return (id % colors * (LABEL_HIDDEN + 1) + GetBusLabelPosition(id, 0)) * (LABEL_HIDDEN + 1)
+            + GetBusLabelPosition(id, 1);
+    };
+    const auto get_stop_label_variant = [this](uint32_t id) -> uint64_t {
+        return GetStopLabelPosition(id);
+    };
+
+    string buffer;
+    styles_doc.RenderHeader(buffer);
+    WriteLayer(layout_.buses, fragments_.route_lines, get_color, styles_doc,
+               [&](uint32_t id, CompactDocument& doc) {
+                   RenderRoutePolyline(id, routes[id], styles, doc);
+               }, buffer, sink);
+    WriteLayer(layout_.buses, fragments_.route_labels, get_route_label_variant, styles_doc,
+               [&](uint32_t id, CompactDocument& doc) {
+                   RenderRouteLabel(id, styles, doc);
+               }, buffer, sink);
+    WriteLayer(layout_.stops, fragments_.stop_symbols, [](uint32_t) -> uint64_t { return 0; }, styles_doc,
+               [&](uint32_t id, CompactDocument& doc) {
+                   RenderStopSymbol(id, styles, doc);
+               }, buffer, sink);
+    WriteLayer(layout_.stops, fragments_.stop_labels, get_stop_label_variant, styles_doc,
+               [&](uint32_t id, CompactDocument& doc) {
+                   RenderStopLabel(id, styles, doc);
+               }, buffer, sink);
+    sink(buffer);
+}
+
+template <typename Item, typename GetVariant, typename RenderItem>
+void MapRenderer::WriteLayer(const vector<const Item*>& items, unordered_map<const Item*, Fragment>& fragments,
+                             GetVariant get_variant, const CompactDocument& styles_doc, RenderItem render_item,
+                             string& buffer, const CompactDocument::TextSink& sink) {
+    vector<const string*> texts;
+    vector<uint32_t> missing;
+    vector<string> rendered;
+    for (size_t begin = 0; begin < items.size(); begin += FRAGMENT_WINDOW) {
+        const size_t end = min(begin + FRAGMENT_WINDOW, items.size());
+
+        texts.assign(end - begin, nullptr);
+        missing.clear();
+        for (uint32_t id = begin; id < end; ++id) {
+            const auto it = fragments.find(items[id]);
+            if (it != fragments.end() && it->second.variant == get_variant(id)) {
+                texts[id - begin] = &it->second.text;
+            } else {
+                missing.push_back(id);
+            }
+        }
+
+        // Каждая часть выводит элементы в свою копию документа со стилями, поэтому номера стилей совпадают
+        rendered.assign(missing.size(), {});
+        ParallelFor(missing.size(), threads_, [&](size_t first, size_t last) {
+            CompactDocument doc = styles_doc;
+            for (size_t i = first; i < last; ++i) {
+                doc.Clear();
+                render_item(missing[i], doc);
+                doc.RenderBody(rendered[i]);
+            }
+        });
+
+        // Узлы unordered_map не перемещаются при вставке, поэтому указатели на текст остаются действительными
+        for (size_t i = 0; i < missing.size(); ++i) {
+            const uint32_t id = missing[i];
+            auto [it, inserted] = fragments.try_emplace(items[id]);
+            const size_t old_size = inserted ? 0 : it->second.text.size();
+            if (fragments_.size - old_size + rendered[i].size() <= MAX_CACHED_FRAGMENTS_SIZE) {
+                fragments_.size = fragments_.size - old_size + rendered[i].size();
+                it->second = Fragment{move(rendered[i]), get_variant(id)};
+                texts[id - begin] = &it->second.text;
+            } else {
+                fragments_.size -= old_size;
+                fragments.erase(it);
+                texts[id - begin] = &rendered[i];
+            }
+        }
+
+        for (const string* text : texts) {
+            buffer += *text;
+            if (buffer.size() >= FRAGMENT_FLUSH_SIZE) {
+                sink(buffer);
+                buffer.clear();
+            }
+        }
+    }
+}
+
+const string& MapRenderer::GetTileSvg(const Rect& viewport) {
+    UpdateLayout();
+    const array<double, 4> key{viewport.min_x, viewport.min_y, viewport.max_x, viewport.max_y};
+    if (const auto it = tile_svgs_.find(key); it != tile_svgs_.end()) {
+        return it->second;
+    }
+
+    if (tile_svgs_.size() >= MAX_CACHED_TILES) {
+        tile_svgs_.clear();
+    }
+    string& svg = tile_svgs_[key];
+    RenderTile(viewport).Render(svg, threads_);
+    return svg;
+}
+
+optional<Rect> MapRenderer::GetTileBounds(int zoom, int x, int y) const {
+    if (zoom < 0 || zoom > MAX_TILE_ZOOM) {
+        return nullopt;
+    }
+    const int64_t tiles = int64_t{1} << zoom;
+    if (x < 0 || y < 0 || x >= tiles || y >= tiles) {
+        return nullopt;
+    }
+
+    const double tile_width = settings_.width / static_cast<double>(tiles);
+    const double tile_height = settings_.height / static_cast<double>(tiles);
+    return Rect{x * tile_width, y * tile_height, (x + 1) * tile_width, (y + 1) * tile_height};
+}
+
+void MapRenderer::SetSettings(const RenderSettings& settings) {
+    settings_ = settings;
+    layout_version_.reset();
+    fragments_ = FragmentCache{};
+}
+
+void MapRenderer::SetThreads(unsigned threads) {
+    threads_ = threads;
+}
+
+memory::MemoryUsage MapRenderer::GetMemoryUsage() const {
+    memory::MemoryUsage usage;
+    usage["layout.buses"s] = memory::GetVectorBytes(layout_.buses);
+    usage["layout.stops"s] = memory::GetVectorBytes(layout_.stops);
+    usage["layout.routes"s] = GetPolylinesBytes(layout_.routes);
+
+    size_t simplified_routes_bytes = memory::GetTreeBytes(layout_.simplified_routes);
+    for (const auto& [zoom, routes] : layout_.simplified_routes) {
+        simplified_routes_bytes += GetPolylinesBytes(routes);
+    }
+    usage["layout.simplified_routes"s] = simplified_routes_bytes;
+    usage["layout.label_positions"s] = memory::GetVectorBytes(layout_.bus_label_positions)
+        + memory::GetVectorBytes(layout_.stop_label_positions);
+
+    size_t index_bytes = 0;
+    if (layout_.index) {
+        index_bytes = GetBoundsBytes(layout_.index->bus_bounds) + GetBoundsBytes(layout_.index->stop_bounds)
+            + layout_.index->bus_index.GetMemoryUsage() + layout_.index->stop_index.GetMemoryUsage();
+    }
+    usage["layout.index"s] = index_bytes;
+
+    usage["map_svg"s] = map_svg_ ? memory::GetStringBytes(*map_svg_) : 0;
+    size_t tile_svgs_bytes = memory::GetTreeBytes(tile_svgs_);
+    for (const auto& [viewport, svg] : tile_svgs_) {
+        tile_svgs_bytes += memory::GetStringBytes(svg);
+    }
+    usage["tile_svgs"s] = tile_svgs_bytes;
+    usage["fragments"s] = GetFragmentsBytes(fragments_.route_lines) + GetFragmentsBytes(fragments_.route_labels)
+        + GetFragmentsBytes(fragments_.stop_symbols) + GetFragmentsBytes(fragments_.stop_labels);
+    return usage;
 }
 
 } // namespace transport_catalogue::map_renderer
\ No newline at end of file
@@ -2,13 +2,23 @@
 
 #include "domain.h"
 #include "geo.h"
+#include "memory_usage.h"
+#include "spatial_index.h"
 #include "svg.h"
+#include "svg_compact.h"
 #include "transport_catalogue.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace transport_catalogue::map_renderer {
@@ -18,6 +28,13 @@ using namespace transport_catalogue::geo;
 using namespace transport_catalogue::database;
     
 inline const double EPSILON = 1e-6;
+inline const int MAX_TILE_ZOOM = 20;
+// При переполнении кэш тайлов очищается целиком
+inline const size_t MAX_CACHED_TILES = 4096;
+inline const size_t MAX_CACHED_SVG_SIZE = 16 << 20;
+// Суммарный размер svg-фрагментов маршрутов и остановок, которые запоминаются между построениями карты
+inline const size_t MAX_CACHED_FRAGMENTS_SIZE = 32 << 20;
+inline const uint8_t LABEL_HIDDEN = 4;
 bool IsZero(double value);
 
 class SphereProjector {
@@ -80,6 +97,16 @@ public:
         };
     }
 
+    // Равные проекторы переводят любые координаты в одни и те же точки
+    bool operator==(const SphereProjector& other) const {
+        return padding_ == other.padding_ && min_lon_ == other.min_lon_
+            && max_lat_ == other.max_lat_ && zoom_coeff_ == other.zoom_coeff_;
+    }
+
+    bool operator!=(const SphereProjector& other) const {
+        return !(*this == other);
+    }
+
 private:
     double padding_;
     double min_lon_ = 0;
@@ -100,6 +127,12 @@ struct RenderSettings {
     Color underlayer_color;
     double underlayer_width;
     std::vector<Color> color_palette;
+    // Допустимое отклонение упрощённой линии маршрута в пикселях при показе карты в масштабе zoom.
+    // Промежуточные точки, отклоняющиеся меньше, отбрасываются алгоритмом Дугласа — Пекера; 0 — без упрощения
+    double simplify_tolerance = 0;
+    // Сдвигать надписи, перекрывающие уже размещённые, и не выводить те, что не удалось разместить.
+    // Надписи маршрутов размещаются раньше надписей остановок
+    bool avoid_label_overlap = false;
 };
 
 class MapRenderer {
@@ -107,19 +140,159 @@ public:
     MapRenderer(const RenderSettings& settings, const TransportCatalogue& catalogue)
     : settings_(settings), catalogue_(catalogue) {}
 
-    Document RenderMap();
+    CompactDocument RenderMap();
+
+    // Часть карты внутри viewport (в координатах полной карты). В документ попадают
+    // только линии, остановки и надписи рядом с областью, а viewBox ограничивает изображение ею
+    CompactDocument RenderTile(const Rect& viewport);
+
+    // Карта в виде SVG-текста. Результат кэшируется и перестраивается,
+    // только если справочник изменился или были заданы новые настройки.
+    // При перестроении заново выводятся только новые маршруты и остановки и маршруты, сменившие цвет,
+    // текст остальных берётся из прошлого построения, если границы карты не изменились
+    const std::string& GetMapSvg();
+
+    // Передаёт SVG-текст карты в sink фрагментами по мере построения. Карта размером до MAX_CACHED_SVG_SIZE
+    // запоминается для следующих запросов, большая собирается заново из фрагментов без хранения текста целиком
+    void StreamMapSvg(const CompactDocument::TextSink& sink);
+
+    // Как StreamMapSvg, но поверх карты выводится найденный маршрут: участки поездок выделенными линиями
+    // цветов своих автобусов и отметки мест ожидания. Карта берётся из кэша, заново строится только наложение
+    void StreamRouteMapSvg(const std::vector<RouteLeg>& legs, const CompactDocument::TextSink& sink);
+
+    // SVG-текст части карты. Результаты кэшируются по границам области так же, как GetMapSvg
+    const std::string& GetTileSvg(const Rect& viewport);
+
+    // Границы тайла (x, y) уровня zoom: изображение делится на 2^zoom × 2^zoom равных частей.
+    // Возвращает nullopt для несуществующего тайла
+    std::optional<Rect> GetTileBounds(int zoom, int x, int y) const;
+
+    void SetSettings(const RenderSettings& settings);
+
+    // Число потоков для вывода SVG-текста в GetMapSvg и GetTileSvg
+    void SetThreads(unsigned threads);
+
+    // Оценка памяти раскладки карты и кэшей SVG-текста
+    memory::MemoryUsage GetMemoryUsage() const;
     
 private:
-    const RenderSettings settings_;
+    struct SpatialIndex {
+        // Области, занятые элементами каждого маршрута и каждой остановки, см. GetBusBounds и GetStopBounds
+        std::vector<std::vector<Rect>> bus_bounds;
+        std::vector<std::vector<Rect>> stop_bounds;
+        // Номера маршрутов по областям, занятым их линиями и надписями
+        GridIndex bus_index;
+        // Номера остановок по областям, занятым их кругами и надписями
+        GridIndex stop_index;
+    };
+
+    // Данные карты, общие для всех запросов к одной версии справочника
+    struct Layout {
+        // Маршруты с остановками в порядке названий; цвет маршрута определяется его номером
+        std::vector<const Bus*> buses;
+        std::vector<const Stop*> stops;
+        std::unique_ptr<SphereProjector> projector;
+        // Спроецированные точки линий маршрутов
+        std::vector<std::vector<Point>> routes;
+        // Упрощённые линии маршрутов по уровням масштаба, строятся при первом обращении
+        std::map<int, std::vector<std::vector<Point>>> simplified_routes;
+        // Положения надписей маршрутов у конечных остановок и надписей остановок, см. GetLabelOffset.
+        // Пусто, если avoid_label_overlap выключено и все надписи выводятся на своих местах
+        std::vector<std::array<uint8_t, 2>> bus_label_positions;
+        std::vector<uint8_t> stop_label_positions;
+        // Пространственный индекс нужен только для тайлов и строится при первом запросе тайла
+        std::optional<SpatialIndex> index;
+    };
+
+    // Стили элементов карты в документе
+    struct MapStyles {
+        // Линии и надписи маршрутов по цветам палитры
+        std::vector<CompactDocument::StyleId> route_lines;
+        CompactDocument::StyleId route_label_background;
+        std::vector<CompactDocument::StyleId> route_labels;
+        CompactDocument::StyleId stop_symbol;
+        CompactDocument::StyleId stop_label_background;
+        CompactDocument::StyleId stop_label;
+    };
+
+    // SVG-текст элементов одного маршрута или одной остановки в слое карты
+    struct Fragment {
+        std::string text;
+        // Номер цвета палитры и положения надписей, с которыми выведен текст
+        uint64_t variant;
+    };
+
+    // Фрагменты полной карты из прошлых построений. Текст маршрута или остановки зависит от его названия
+    // и координат остановок, номера цвета и положений надписей (Fragment::variant), проектора и настроек.
+    // Ключом служит адрес объекта: справочник только дополняется, а добавленные Bus и Stop не перемещаются,
+    // не изменяются и не удаляются, поэтому адрес однозначно задаёт название и координаты. Смена проектора
+    // или настроек затрагивает все фрагменты сразу, и кэш очищается целиком — это намеренно
+    struct FragmentCache {
+        std::unordered_map<const Bus*, Fragment> route_lines;
+        std::unordered_map<const Bus*, Fragment> route_labels;
+        std::unordered_map<const Stop*, Fragment> stop_symbols;
+        std::unordered_map<const Stop*, Fragment> stop_labels;
+        // Суммарная длина текста фрагментов
+        size_t size = 0;
+        std::optional<SphereProjector> projector;
+    };
+
+    RenderSettings settings_;
     const TransportCatalogue& catalogue_;
-    std::unique_ptr<SphereProjector> projector_;
+    unsigned threads_ = 1;
+
+    Layout layout_;
+    // Версия справочника, для которой построены layout_ и кэши; пусто, если они недействительны
+    std::optional<uint64_t> layout_version_;
+    std::optional<std::string> map_svg_;
+    // Карта текущей версии оказалась больше MAX_CACHED_SVG_SIZE и не кэшируется
+    bool map_svg_too_large_ = false;
+    std::map<std::array<double, 4>, std::string> tile_svgs_;
+    FragmentCache fragments_;
 
-    std::vector<Coordinates> CollectStopCoords(const std::set<const Bus*, BusNameComparator>& buses) const;
+    void UpdateLayout();
+    const SpatialIndex& GetSpatialIndex();
+    std::vector<Coordinates> CollectStopCoords(const std::vector<const Bus*>& buses) const;
     std::unique_ptr<SphereProjector> CreateProjector(const std::vector<Coordinates>& stops_coords) const;
-    void RenderRoutePolylines(const std::set<const Bus*, BusNameComparator>& buses, Document& doc) const;
-    void RenderRouteLabels(const std::set<const Bus*, BusNameComparator>& buses, Document& doc) const;
-    void RenderStopSymbols(const std::set<const Stop*, StopNameComparator>& stops, Document& doc) const;
-    void RenderStopsLabels(const std::set<const Stop*, StopNameComparator>& stops, Document& doc) const;
+    std::vector<const Stop*> GetRouteEndStops(const Bus& bus) const;
+    Rect GetLabelBounds(Point point, Point offset, uint32_t font_size, std::string_view text) const;
+    // Смещение надписи в положении position: 0 — заданное в настройках, 1 — отражённое влево от точки,
+    // 2 — отражённое по вертикали, 3 — оба отражения. В положении LABEL_HIDDEN надпись не выводится
+    Point GetLabelOffset(Point offset, uint32_t font_size, std::string_view text, uint8_t position) const;
+    uint8_t GetBusLabelPosition(uint32_t id, size_t index) const;
+    uint8_t GetStopLabelPosition(uint32_t id) const;
+    // Выбирает положения надписей по порядку, пропуская занятые другими надписями
+    void PlaceLabels();
+    // Области, занятые отрезками линии маршрута и его надписями
+    std::vector<Rect> GetBusBounds(uint32_t id) const;
+    // Области, занятые кругом остановки и её надписью
+    std::vector<Rect> GetStopBounds(uint32_t id) const;
+    // Уровень масштаба, при котором область viewport занимает всё изображение
+    int GetZoomLevel(const Rect& viewport) const;
+    // Линии маршрутов для отображения в масштабе zoom с учётом simplify_tolerance
+    const std::vector<std::vector<Point>>& GetRoutes(int zoom);
+
+    void BuildMap(CompactDocument& doc);
+    void BuildDocument(const std::vector<uint32_t>& bus_ids, const std::vector<uint32_t>& stop_ids, int zoom,
+                       CompactDocument& doc);
+    MapStyles AddStyles(CompactDocument& doc) const;
+    void RenderRoutePolyline(uint32_t id, const std::vector<Point>& route, const MapStyles& styles,
+                             CompactDocument& doc) const;
+    void RenderRouteLabel(uint32_t id, const MapStyles& styles, CompactDocument& doc) const;
+    void RenderStopSymbol(uint32_t id, const MapStyles& styles, CompactDocument& doc) const;
+    void RenderStopLabel(uint32_t id, const MapStyles& styles, CompactDocument& doc) const;
+
+    // Выводит полную карту, за ней элементы overlay и закрывающий тег, кэшируя текст карты в map_svg_
+    void StreamMap(const CompactDocument& overlay, const CompactDocument::TextSink& sink);
+    void BuildRouteOverlay(const std::vector<RouteLeg>& legs, CompactDocument& doc) const;
+    // Выводит SVG-текст полной карты без закрывающего тега в sink, используя и пополняя fragments_
+    void WriteMapFragments(const CompactDocument::TextSink& sink);
+    // Выводит слой карты: для каждого элемента items фрагмент из кэша fragments или, если его нет
+    // или get_variant дал другое значение, текст, построенный render_item в копии документа styles_doc
+    template <typename Item, typename GetVariant, typename RenderItem>
+    void WriteLayer(const std::vector<const Item*>& items, std::unordered_map<const Item*, Fragment>& fragments,
+                    GetVariant get_variant, const CompactDocument& styles_doc, RenderItem render_item,
+                    std::string& buffer, const CompactDocument::TextSink& sink);
 };
 
 }; // namespace transport_catalogue::map_renderer
\ No newline at end of file
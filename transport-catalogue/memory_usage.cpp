@@ -0,0 +1,44 @@
+#include "memory_usage.h"
+
+using namespace std;
+
+namespace memory {
+
+size_t GetStringBytes(const string& str) {
+    static const size_t sso_capacity = string().capacity();
+    return str.capacity() > sso_capacity ? str.capacity() + 1 : 0;
+}
+
+size_t GetGrowthCapacity(size_t size) {
+    size_t capacity = size > 0 ? 1 : 0;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+size_t GetTotal(const MemoryUsage& usage) {
+    size_t total = 0;
+    for (const auto& [name, bytes] : usage) {
+        total += bytes;
+    }
+    return total;
+}
+
+void AddUsage(MemoryUsage& usage, string_view prefix, const MemoryUsage& other) {
+    for (const auto& [name, bytes] : other) {
+        string key(prefix);
+        key += '.';
+        key += name;
+        usage[move(key)] += bytes;
+    }
+}
+
+void PrintMemoryUsage(ostream& out, string_view title, const MemoryUsage& usage) {
+    for (const auto& [name, bytes] : usage) {
+        out << "memory "sv << title << '.' << name << ": "sv << bytes << " bytes\n"sv;
+    }
+    out << "memory "sv << title << ": "sv << GetTotal(usage) << " bytes\n"sv;
+}
+
+}  // namespace memory
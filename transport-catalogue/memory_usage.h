@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Оценка памяти, занятой контейнерами стандартной библиотеки: буферы векторов по ёмкости, блоки deque,
+ * узлы деревьев и хеш-таблиц вместе с массивом корзин, строки, не поместившиеся во внутренний буфер.
+ * Размеры служебных полей узлов взяты из libstdc++, накладные расходы распределителя памяти не учитываются
+ */
+
+namespace memory {
+
+// Байты, занятые контейнерами объекта, по названиям контейнеров
+using MemoryUsage = std::map<std::string, size_t, std::less<>>;
+
+// Цвет и три указателя узла красно-чёрного дерева
+inline constexpr size_t TREE_NODE_OVERHEAD = 4 * sizeof(void*);
+// Указатель на следующий узел и сохранённый хеш ключа
+inline constexpr size_t HASH_NODE_OVERHEAD = 2 * sizeof(void*);
+inline constexpr size_t DEQUE_BLOCK_SIZE = 512;
+inline constexpr size_t DEQUE_MIN_MAP_SIZE = 8;
+
+// Память строки вне самого объекта std::string
+size_t GetStringBytes(const std::string& str);
+
+// Ёмкость вектора после size вызовов push_back: буфер растёт удвоением
+size_t GetGrowthCapacity(size_t size);
+
+template <typename Value>
+size_t GetVectorBytes(const std::vector<Value>& vec) {
+    return vec.capacity() * sizeof(Value);
+}
+
+template <typename Value>
+size_t GetDequeBytes(const std::deque<Value>& deq) {
+    const size_t per_block = sizeof(Value) < DEQUE_BLOCK_SIZE ? DEQUE_BLOCK_SIZE / sizeof(Value) : 1;
+    const size_t blocks = deq.size() / per_block + 1;
+    return blocks * per_block * sizeof(Value) + std::max(DEQUE_MIN_MAP_SIZE, blocks + 2) * sizeof(void*);
+}
+
+// Узлы std::map и std::set
+template <typename Tree>
+size_t GetTreeBytes(const Tree& tree) {
+    return tree.size() * (sizeof(typename Tree::value_type) + TREE_NODE_OVERHEAD);
+}
+
+// Узлы и корзины std::unordered_map и std::unordered_set
+template <typename HashTable>
+size_t GetHashTableBytes(const HashTable& table) {
+    return table.size() * (sizeof(typename HashTable::value_type) + HASH_NODE_OVERHEAD)
+        + table.bucket_count() * sizeof(void*);
+}
+
+size_t GetTotal(const MemoryUsage& usage);
+
+// Добавляет записи other в usage, приписывая к их названиям prefix и точку
+void AddUsage(MemoryUsage& usage, std::string_view prefix, const MemoryUsage& other);
+
+// Выводит по строке на контейнер и итог, названия дополняются приставкой title
+void PrintMemoryUsage(std::ostream& out, std::string_view title, const MemoryUsage& usage);
+
+}  // namespace memory
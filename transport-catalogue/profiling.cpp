@@ -0,0 +1,383 @@
+#include "profiling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+using namespace std;
+
+namespace transport_catalogue::profiling {
+
+namespace {
+
+constexpr string_view PHASE_NAMES[PHASES_COUNT] = {
+    "parse"sv,
+    "base_requests"sv,
+    "router_build"sv,
+    "map_layout"sv,
+    "stat_requests"sv,
+    "output"sv,
+};
+
+array<atomic<uint64_t>, PHASES_COUNT> phase_times{};
+array<LatencyHistogram, REQUEST_TYPES_COUNT> request_latencies;
+
+#ifdef TRANSPORT_CATALOGUE_ALLOC_STATS
+
+// Счётчики одной области учёта; все поля статические и инициализируются нулями до первого выделения
+struct AllocationCounters {
+    atomic<uint64_t> allocations{0};
+    atomic<uint64_t> bytes{0};
+    atomic<uint64_t> peak_live_bytes{0};
+};
+
+// Последний элемент — выделения вне этапов и запросов
+array<AllocationCounters, detail::ALLOC_SCOPES_COUNT + 1> allocation_counters;
+AllocationCounters total_allocations;
+atomic<uint64_t> live_bytes{0};
+
+// Перед блоком хранится заголовок: размер запрошенной памяти и смещение блока от начала выделенной
+constexpr size_t ALLOC_HEADER_SIZE = 16;
+
+void UpdatePeak(atomic<uint64_t>& peak, uint64_t value) {
+    uint64_t current = peak.load(memory_order_relaxed);
+    while (value > current && !peak.compare_exchange_weak(current, value, memory_order_relaxed)) {
+    }
+}
+
+void CountAllocation(AllocationCounters& counters, size_t size, uint64_t live) {
+    counters.allocations.fetch_add(1, memory_order_relaxed);
+    counters.bytes.fetch_add(size, memory_order_relaxed);
+    UpdatePeak(counters.peak_live_bytes, live);
+}
+
+void* TrackedAllocate(size_t size, size_t alignment) noexcept {
+    const size_t offset = max(alignment, ALLOC_HEADER_SIZE);
+    void* raw = nullptr;
+    if (alignment <= alignof(max_align_t)) {
+        raw = malloc(size + offset);
+    } else {
+        // aligned_alloc требует размер, кратный выравниванию
+        raw = aligned_alloc(alignment, (size + offset + alignment - 1) / alignment * alignment);
+    }
+    if (raw == nullptr) {
+        return nullptr;
+    }
+
+    char* block = static_cast<char*>(raw) + offset;
+    reinterpret_cast<size_t*>(block)[-2] = size;
+    reinterpret_cast<size_t*>(block)[-1] = offset;
+
+    const uint64_t live = live_bytes.fetch_add(size, memory_order_relaxed) + size;
+    const uint8_t scope = detail::alloc_scope;
+    CountAllocation(total_allocations, size, live);
+    CountAllocation(allocation_counters[scope < detail::ALLOC_SCOPES_COUNT ? scope : detail::ALLOC_SCOPES_COUNT],
+                    size, live);
+    return block;
+}
+
+void TrackedFree(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    char* block = static_cast<char*>(ptr);
+    const size_t size = reinterpret_cast<size_t*>(block)[-2];
+    const size_t offset = reinterpret_cast<size_t*>(block)[-1];
+    live_bytes.fetch_sub(size, memory_order_relaxed);
+    free(block - offset);
+}
+
+void* TrackedNew(size_t size, size_t alignment) {
+    while (true) {
+        if (void* ptr = TrackedAllocate(size, alignment)) {
+            return ptr;
+        }
+        const new_handler handler = get_new_handler();
+        if (handler == nullptr) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+AllocationStats LoadAllocationStats(const AllocationCounters& counters) {
+    return {
+        counters.allocations.load(memory_order_relaxed),
+        counters.bytes.load(memory_order_relaxed),
+        counters.peak_live_bytes.load(memory_order_relaxed)
+    };
+}
+
+AllocationSnapshot GetAllocationSnapshot() {
+    AllocationSnapshot snapshot;
+    snapshot.total = LoadAllocationStats(total_allocations);
+    snapshot.live_bytes = live_bytes.load(memory_order_relaxed);
+    for (size_t i = 0; i < PHASES_COUNT; ++i) {
+        snapshot.phases[i] = LoadAllocationStats(allocation_counters[i]);
+    }
+    for (size_t i = 0; i < REQUEST_TYPES_COUNT; ++i) {
+        snapshot.requests[i] = LoadAllocationStats(allocation_counters[PHASES_COUNT + i]);
+    }
+    snapshot.other = LoadAllocationStats(allocation_counters[detail::ALLOC_SCOPES_COUNT]);
+    return snapshot;
+}
+
+#endif
+
+void PrintAllocationStats(ostream& out, string_view name, const AllocationStats& stats) {
+    out << "allocations "sv << name << ": count "sv << stats.allocations
+        << ", bytes "sv << stats.bytes
+        << ", peak live bytes "sv << stats.peak_live_bytes << '\n';
+}
+
+double ToMilliseconds(uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e6;
+}
+
+double ToMicroseconds(uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e3;
+}
+
+}  // namespace
+
+string_view GetPhaseName(Phase phase) {
+    return PHASE_NAMES[static_cast<size_t>(phase)];
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+    buckets_[GetBucket(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    total_.fetch_add(nanoseconds, memory_order_relaxed);
+    uint64_t max = max_.load(memory_order_relaxed);
+    while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetTotal() const {
+    return total_.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    return max_.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetQuantile(double quantile) const {
+    // Корзины читаются без общей блокировки, поэтому сумма считается по ним самим, а не по count_
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(quantile * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS_COUNT; ++bucket) {
+        seen += buckets_[bucket].load(memory_order_relaxed);
+        if (seen >= rank) {
+            return min(GetBucketMiddle(bucket), GetMax());
+        }
+    }
+    return GetMax();
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 0;
+    for (uint64_t rest = value; rest > 1; rest >>= 1) {
+        ++msb;
+    }
+    const int shift = msb - 4;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::GetBucketMiddle(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const size_t shift = bucket / SUB_BUCKETS - 1;
+    const uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + ((uint64_t{1} << shift) >> 1);
+}
+
+namespace detail {
+
+void AddPhaseTime(Phase phase, uint64_t nanoseconds) {
+    phase_times[static_cast<size_t>(phase)].fetch_add(nanoseconds, memory_order_relaxed);
+}
+
+void RecordRequest(RequestType type, uint64_t nanoseconds) {
+    request_latencies[static_cast<size_t>(type)].Record(nanoseconds);
+}
+
+}  // namespace detail
+
+void EnableStats(bool enabled) {
+    if constexpr (STATS_COMPILED) {
+        detail::stats_enabled.store(enabled, memory_order_relaxed);
+    }
+}
+
+StatsSnapshot GetStatsSnapshot() {
+    StatsSnapshot snapshot;
+    snapshot.enabled = IsStatsEnabled();
+    for (size_t i = 0; i < PHASES_COUNT; ++i) {
+        snapshot.phase_ns[i] = phase_times[i].load(memory_order_relaxed);
+    }
+    for (size_t i = 0; i < REQUEST_TYPES_COUNT; ++i) {
+        const LatencyHistogram& histogram = request_latencies[i];
+        LatencySummary& summary = snapshot.requests[i];
+        summary.count = histogram.GetCount();
+        summary.total_ns = histogram.GetTotal();
+        summary.max_ns = histogram.GetMax();
+        summary.p50_ns = histogram.GetQuantile(0.5);
+        summary.p90_ns = histogram.GetQuantile(0.9);
+        summary.p99_ns = histogram.GetQuantile(0.99);
+    }
+#ifdef TRANSPORT_CATALOGUE_ALLOC_STATS
+    snapshot.allocations = GetAllocationSnapshot();
+#endif
+    return snapshot;
+}
+
+void PrintStats(ostream& out) {
+    const StatsSnapshot snapshot = GetStatsSnapshot();
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << fixed << setprecision(3);
+
+    for (size_t i = 0; i < PHASES_COUNT; ++i) {
+        out << "phase "sv << PHASE_NAMES[i] << ": "sv << ToMilliseconds(snapshot.phase_ns[i]) << " ms\n"sv;
+    }
+    for (size_t i = 0; i < REQUEST_TYPES_COUNT; ++i) {
+        const LatencySummary& summary = snapshot.requests[i];
+        if (summary.count == 0) {
+            continue;
+        }
+        out << "request "sv << requesting::GetRequestTypeName(static_cast<RequestType>(i))
+            << ": count "sv << summary.count
+            << ", mean "sv << ToMicroseconds(summary.total_ns / summary.count)
+            << " us, p50 "sv << ToMicroseconds(summary.p50_ns)
+            << " us, p90 "sv << ToMicroseconds(summary.p90_ns)
+            << " us, p99 "sv << ToMicroseconds(summary.p99_ns)
+            << " us, max "sv << ToMicroseconds(summary.max_ns) << " us\n"sv;
+    }
+    if (const auto& allocations = snapshot.allocations) {
+        PrintAllocationStats(out, "total"sv, allocations->total);
+        for (size_t i = 0; i < PHASES_COUNT; ++i) {
+            PrintAllocationStats(out, PHASE_NAMES[i], allocations->phases[i]);
+        }
+        for (size_t i = 0; i < REQUEST_TYPES_COUNT; ++i) {
+            if (allocations->requests[i].allocations > 0) {
+                PrintAllocationStats(out, requesting::GetRequestTypeName(static_cast<RequestType>(i)),
+                                     allocations->requests[i]);
+            }
+        }
+        PrintAllocationStats(out, "other"sv, allocations->other);
+        out << "live bytes: "sv << allocations->live_bytes << '\n';
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+}  // namespace transport_catalogue::profiling
+
+#ifdef TRANSPORT_CATALOGUE_ALLOC_STATS
+
+// Замена глобальных operator new и delete для учёта выделений памяти; все формы сводятся к двум функциям
+
+using transport_catalogue::profiling::TrackedFree;
+using transport_catalogue::profiling::TrackedNew;
+using transport_catalogue::profiling::TrackedAllocate;
+
+void* operator new(size_t size) {
+    return TrackedNew(size, alignof(max_align_t));
+}
+
+void* operator new[](size_t size) {
+    return TrackedNew(size, alignof(max_align_t));
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return TrackedAllocate(size, alignof(max_align_t));
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return TrackedAllocate(size, alignof(max_align_t));
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    return TrackedNew(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+    return TrackedNew(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return TrackedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return TrackedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, const nothrow_t&) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const nothrow_t&) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, align_val_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, align_val_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t, align_val_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t, align_val_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, align_val_t, const nothrow_t&) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, align_val_t, const nothrow_t&) noexcept {
+    TrackedFree(ptr);
+}
+
+#endif
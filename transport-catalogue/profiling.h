@@ -0,0 +1,256 @@
+#pragma once
+
+#include "requests.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+/*
+ * Счётчики времени этапов обработки и гистограммы задержек запросов по типам.
+ * Сбор включается во время работы через EnableStats; выключенный сбор стоит одной проверки флага
+ * на этап или запрос, без обращения к часам. При сборке с TRANSPORT_CATALOGUE_NO_STATS
+ * таймеры становятся пустыми объектами и не порождают никакого кода.
+ *
+ * Сборка с TRANSPORT_CATALOGUE_ALLOC_STATS дополнительно заменяет глобальные operator new и delete
+ * и относит каждое выделение памяти к этапу или типу запроса, таймер которого активен в этом потоке.
+ * Учёт выделений ведётся всегда, независимо от EnableStats
+ */
+
+namespace transport_catalogue::profiling {
+
+using requesting::RequestType;
+using requesting::REQUEST_TYPES_COUNT;
+
+#ifdef TRANSPORT_CATALOGUE_NO_STATS
+inline constexpr bool STATS_COMPILED = false;
+#else
+inline constexpr bool STATS_COMPILED = true;
+#endif
+
+#ifdef TRANSPORT_CATALOGUE_ALLOC_STATS
+#ifdef TRANSPORT_CATALOGUE_NO_STATS
+#error "TRANSPORT_CATALOGUE_ALLOC_STATS requires statistics to be compiled in"
+#endif
+inline constexpr bool ALLOC_STATS_COMPILED = true;
+#else
+inline constexpr bool ALLOC_STATS_COMPILED = false;
+#endif
+
+// Этапы могут быть вложены друг в друга: построение раскладки карты происходит во время ответа на запрос Map
+enum class Phase : uint8_t {
+    PARSE,
+    BASE_REQUESTS,
+    ROUTER_BUILD,
+    MAP_LAYOUT,
+    STAT_REQUESTS,
+    OUTPUT,
+    COUNT,
+};
+
+inline constexpr size_t PHASES_COUNT = static_cast<size_t>(Phase::COUNT);
+
+// Название этапа в ответе на запрос Stats и в отчёте
+std::string_view GetPhaseName(Phase phase);
+
+/*
+ * Гистограмма задержек с логарифмическими корзинами, как в HdrHistogram: значения до 16 нс
+ * учитываются точно, дальше каждый интервал [2^k, 2^(k+1)) делится на 16 равных корзин,
+ * так что относительная погрешность квантилей не превышает 1/16. Запись из нескольких потоков
+ * не требует блокировок
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 16;
+    static constexpr size_t BUCKETS_COUNT = SUB_BUCKETS * 61;
+
+    void Record(uint64_t nanoseconds);
+
+    uint64_t GetCount() const;
+    uint64_t GetTotal() const;
+    uint64_t GetMax() const;
+    // Середина корзины, в которую попадает доля quantile наименьших значений; 0 для пустой гистограммы
+    uint64_t GetQuantile(double quantile) const;
+
+    static size_t GetBucket(uint64_t value);
+    static uint64_t GetBucketMiddle(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct LatencySummary {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p90_ns = 0;
+    uint64_t p99_ns = 0;
+};
+
+// Выделения памяти через operator new, сделанные в одной области учёта
+struct AllocationStats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    // Наибольший объём занятой программой памяти, замеченный при выделении в этой области
+    uint64_t peak_live_bytes = 0;
+};
+
+struct AllocationSnapshot {
+    AllocationStats total;
+    uint64_t live_bytes = 0;
+    std::array<AllocationStats, PHASES_COUNT> phases{};
+    std::array<AllocationStats, REQUEST_TYPES_COUNT> requests{};
+    // Выделения вне этапов и запросов
+    AllocationStats other;
+};
+
+struct StatsSnapshot {
+    bool enabled = false;
+    // Суммарное время этапов; этап, выполненный несколько раз, учитывается суммой
+    std::array<uint64_t, PHASES_COUNT> phase_ns{};
+    std::array<LatencySummary, REQUEST_TYPES_COUNT> requests{};
+    // Есть только в сборке с TRANSPORT_CATALOGUE_ALLOC_STATS
+    std::optional<AllocationSnapshot> allocations;
+};
+
+namespace detail {
+
+inline std::atomic<bool> stats_enabled{false};
+
+// Области учёта выделений: этапы, за ними типы запросов; NO_ALLOC_SCOPE — вне этапов и запросов
+inline constexpr uint8_t NO_ALLOC_SCOPE = 0xFF;
+inline constexpr size_t ALLOC_SCOPES_COUNT = PHASES_COUNT + REQUEST_TYPES_COUNT;
+inline thread_local uint8_t alloc_scope = NO_ALLOC_SCOPE;
+
+// Делает scope текущей областью учёта выделений потока до разрушения; без учёта выделений ничего не делает
+class AllocScopeGuard {
+public:
+    explicit AllocScopeGuard(size_t scope) {
+        if constexpr (ALLOC_STATS_COMPILED) {
+            previous_ = alloc_scope;
+            alloc_scope = static_cast<uint8_t>(scope);
+        }
+    }
+
+    AllocScopeGuard(const AllocScopeGuard&) = delete;
+    AllocScopeGuard& operator=(const AllocScopeGuard&) = delete;
+
+    ~AllocScopeGuard() {
+        if constexpr (ALLOC_STATS_COMPILED) {
+            alloc_scope = previous_;
+        }
+    }
+
+private:
+    uint8_t previous_ = NO_ALLOC_SCOPE;
+};
+
+void AddPhaseTime(Phase phase, uint64_t nanoseconds);
+void RecordRequest(RequestType type, uint64_t nanoseconds);
+
+inline uint64_t GetElapsed(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+}  // namespace detail
+
+inline bool IsStatsEnabled() {
+    if constexpr (STATS_COMPILED) {
+        return detail::stats_enabled.load(std::memory_order_relaxed);
+    } else {
+        return false;
+    }
+}
+
+// Без поддержки сбора в сборке вызов ничего не меняет
+void EnableStats(bool enabled);
+
+StatsSnapshot GetStatsSnapshot();
+
+// Выводит собранные значения в читаемом виде, по строке на этап и тип запроса
+void PrintStats(std::ostream& out);
+
+#ifdef TRANSPORT_CATALOGUE_NO_STATS
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase) {}
+};
+
+class RequestTimer {
+public:
+    explicit RequestTimer(RequestType) {}
+};
+
+#else
+
+// Добавляет время от создания до разрушения к суммарному времени этапа.
+// В сборке с учётом выделений делает этап текущей областью учёта
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase)
+        : phase_(phase)
+        , active_(IsStatsEnabled())
+        , scope_(static_cast<size_t>(phase)) {
+        if (active_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    ~PhaseTimer() {
+        if (active_) {
+            detail::AddPhaseTime(phase_, detail::GetElapsed(start_));
+        }
+    }
+
+private:
+    Phase phase_;
+    bool active_;
+    detail::AllocScopeGuard scope_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Записывает время от создания до разрушения в гистограмму задержек запросов типа type
+class RequestTimer {
+public:
+    explicit RequestTimer(RequestType type)
+        : type_(type)
+        , active_(type != RequestType::UNKNOWN && IsStatsEnabled())
+        , scope_(type != RequestType::UNKNOWN ? PHASES_COUNT + static_cast<size_t>(type) : detail::alloc_scope) {
+        if (active_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    RequestTimer(const RequestTimer&) = delete;
+    RequestTimer& operator=(const RequestTimer&) = delete;
+
+    ~RequestTimer() {
+        if (active_) {
+            detail::RecordRequest(type_, detail::GetElapsed(start_));
+        }
+    }
+
+private:
+    RequestType type_;
+    bool active_;
+    detail::AllocScopeGuard scope_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif
+
+}  // namespace transport_catalogue::profiling
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace transport_catalogue::map_renderer {
+
+// Прямоугольник в координатах SVG-изображения
+struct Rect {
+    double min_x = 0;
+    double min_y = 0;
+    double max_x = 0;
+    double max_y = 0;
+
+    bool Intersects(const Rect& other) const {
+        return min_x <= other.max_x && other.min_x <= max_x
+            && min_y <= other.max_y && other.min_y <= max_y;
+    }
+
+    // Расширяет прямоугольник на margin во все стороны
+    Rect Expanded(double margin) const {
+        return {min_x - margin, min_y - margin, max_x + margin, max_y + margin};
+    }
+};
+
+} // namespace transport_catalogue::map_renderer
@@ -1,152 +1,444 @@
 #include "domain.h"
-#include "json_builder.h"
+#include "profiling.h"
 #include "request_handler.h"
 
-#include <sstream>
+#include <algorithm>
+#include <numeric>
 #include <set>
 #include <string>
+#include <utility>
 #include <string_view>
+#include <thread>
 
 using namespace std;
 
 namespace transport_catalogue::requesting {
 
+namespace {
+
+// Ключ кэша маршрутов: названия начальной и конечной остановок, разделённые нулевым символом
+string MakeRouteKey(string_view from, string_view to) {
+    string key;
+    key.reserve(from.size() + to.size() + 1);
+    key.append(from).append(1, '\0').append(to);
+    return key;
+}
+
+// Номера 0..count-1 в порядке названий get_name(i): ключи словарей ответа выводятся по алфавиту,
+// а не в порядке перечислений
+template <typename GetName>
+vector<size_t> SortByName(size_t count, GetName get_name) {
+    vector<size_t> order(count);
+    iota(order.begin(), order.end(), size_t{0});
+    sort(order.begin(), order.end(), [&get_name](size_t lhs, size_t rhs) {
+        return get_name(lhs) < get_name(rhs);
+    });
+    return order;
+}
+
+string_view GetPhaseNameAt(size_t i) {
+    return profiling::GetPhaseName(static_cast<profiling::Phase>(i));
+}
+
+string_view GetRequestTypeNameAt(size_t i) {
+    return GetRequestTypeName(static_cast<RequestType>(i));
+}
+
+string_view GetRoutingEngineNameAt(size_t i) {
+    return GetRoutingEngineName(static_cast<RoutingEngine>(i));
+}
+
+// Счётчики выделений памяти превышают диапазон int, а double выводится с округлением до шести знаков
+void WriteCounter(string_view key, uint64_t value, json::Writer& writer) {
+    writer.Key(key);
+    writer.RawValue(to_string(value));
+}
+
+void WriteAllocationStats(const profiling::AllocationStats& stats, json::Writer& writer) {
+    writer.StartDict();
+    WriteCounter("allocations"sv, stats.allocations, writer);
+    WriteCounter("bytes"sv, stats.bytes, writer);
+    WriteCounter("peak_live_bytes"sv, stats.peak_live_bytes, writer);
+    writer.EndDict();
+}
+
+void WriteAllocations(const profiling::AllocationSnapshot& allocations, json::Writer& writer) {
+    writer.StartDict();
+    WriteCounter("live_bytes"sv, allocations.live_bytes, writer);
+    writer.Key("other");
+    WriteAllocationStats(allocations.other, writer);
+
+    writer.Key("phases").StartDict();
+    for (const size_t i : SortByName(profiling::PHASES_COUNT, GetPhaseNameAt)) {
+        writer.Key(GetPhaseNameAt(i));
+        WriteAllocationStats(allocations.phases[i], writer);
+    }
+    writer.EndDict();
+
+    writer.Key("requests").StartDict();
+    for (const size_t i : SortByName(REQUEST_TYPES_COUNT, GetRequestTypeNameAt)) {
+        if (allocations.requests[i].allocations == 0) {
+            continue;
+        }
+        writer.Key(GetRequestTypeNameAt(i));
+        WriteAllocationStats(allocations.requests[i], writer);
+    }
+    writer.EndDict();
+
+    writer.Key("total");
+    WriteAllocationStats(allocations.total, writer);
+    writer.EndDict();
+}
+
+// Выбранный способ поиска маршрутов и оценки времени и памяти всех способов
+void WriteRoutingPlan(const RoutingPlan& plan, json::Writer& writer) {
+    writer.StartDict()
+            .Key("engine").Value(GetRoutingEngineName(plan.engine));
+    writer.Key("estimates").StartDict();
+    for (const size_t i : SortByName(ROUTING_ENGINES_COUNT, GetRoutingEngineNameAt)) {
+        writer.Key(GetRoutingEngineNameAt(i)).StartDict();
+        WriteCounter("memory"sv, plan.estimates[i].memory, writer);
+        writer.Key("time_ms").Value(plan.estimates[i].time_ms);
+        writer.EndDict();
+    }
+    writer.EndDict()
+        .EndDict();
+}
+
+// Память одной структуры: контейнеры по названиям и их сумма
+void WriteMemoryUsage(const memory::MemoryUsage& usage, json::Writer& writer) {
+    writer.StartDict();
+    writer.Key("containers").StartDict();
+    for (const auto& [name, bytes] : usage) {
+        WriteCounter(name, bytes, writer);
+    }
+    writer.EndDict();
+    WriteCounter("total"sv, memory::GetTotal(usage), writer);
+    writer.EndDict();
+}
+
+}  // namespace
+
 RequestHandler::RequestHandler(const TransportCatalogue& catalogue) 
     : catalogue_(catalogue) {}
 
-const json::Node RequestHandler::HandleRouteRequest(const json::Dict& request) const {
-    json::Node result;
-    int id = request.at("id"s).AsInt();
-    const auto& name = request.at("name"s).AsString();
-    auto route_info = catalogue_.GetRouteInfo(name);
+void RequestHandler::HandleRouteRequest(const BusRequest& request, json::Writer& writer) const {
+    const int id = request.id;
+    auto route_info = GetBusInfo(request.name);
 
     if (!route_info.has_value()) {
-        return result = json::Builder{}
-                    .StartDict()
-                        .Key("request_id").Value(id)
-                        .Key("error_message").Value("not found")
-                    .EndDict()
-                .Build();
+        WriteNotFound(id, writer);
+        return;
     }
 
     const BusInfo& info = route_info.value();
 
-    result = json::Builder{}
-                    .StartDict()
-                        .Key("request_id").Value(id)
-                        .Key("curvature").Value(info.curvature)
-                        .Key("route_length").Value(static_cast<double>(info.route_length))
-                        .Key("stop_count").Value(static_cast<int>(info.stops_count))
-                        .Key("unique_stop_count").Value(static_cast<int>(info.unique_stops_count))
-                    .EndDict()
-                .Build();
-
-    return result;
+    writer.StartDict()
+            .Key("curvature").Value(info.curvature)
+            .Key("request_id").Value(id)
+            .Key("route_length").Value(static_cast<double>(info.route_length))
+            .Key("stop_count").Value(static_cast<int>(info.stops_count))
+            .Key("unique_stop_count").Value(static_cast<int>(info.unique_stops_count))
+        .EndDict();
 }
 
-const json::Node RequestHandler::HandleStopRequest(const json::Dict& request) const {
-    json::Node result;
-    int id = request.at("id"s).AsInt();
-    const auto& name = request.at("name"s).AsString();
-    auto buses_ptr = catalogue_.GetBusesForStop(name);
+void RequestHandler::HandleStopRequest(const StopRequest& request, json::Writer& writer) const {
+    const int id = request.id;
+    auto buses_ptr = catalogue_.GetBusesForStop(request.name);
 
     if (!buses_ptr.has_value()) {
-        return result = json::Builder{}
-                    .StartDict()
-                        .Key("request_id").Value(id)
-                        .Key("error_message").Value("not found")
-                    .EndDict()
-                .Build();
+        WriteNotFound(id, writer);
+        return;
+    }
+
+    auto buses_list = writer.StartDict()
+                            .Key("buses").StartArray();
+    for (const auto& bus : *buses_ptr.value()) {
+        buses_list.Value(bus);
     }
+    buses_list.EndArray()
+            .Key("request_id").Value(id)
+        .EndDict();
+}
+
+void RequestHandler::HandleMapRequest(const MapRequest& request, MapRenderer& renderer, json::Writer& writer) const {
+    const int id = request.id;
+
+    writer.StartDict()
+            .Key("map");
+    writer.BeginString();
+    renderer.StreamMapSvg([&writer](string_view chunk) {
+        writer.AppendString(chunk);
+    });
+    writer.EndString()
+            .Key("request_id").Value(id)
+        .EndDict();
+}
 
-    json::Array buses_list;
-    const set<string>* buses = buses_ptr.value();
+void RequestHandler::HandleMapTileRequest(const MapTileRequest& request, MapRenderer& renderer, json::Writer& writer) const {
+    const int id = request.id;
 
-    for (const auto& bus : *buses) {
-        buses_list.emplace_back(bus);
+    optional<Rect> viewport;
+    if (request.has_bbox) {
+        viewport = request.bbox;
+        if (viewport && (viewport->min_x > viewport->max_x || viewport->min_y > viewport->max_y)) {
+            viewport.reset();
+        }
+    } else {
+        viewport = renderer.GetTileBounds(request.zoom, request.x, request.y);
     }
 
-    result = json::Builder{}
-                    .StartDict()
-                        .Key("request_id").Value(id)
-                        .Key("buses").Value(move(buses_list))
-                    .EndDict()
-                .Build();
+    if (!viewport) {
+        WriteError(id, "invalid tile"sv, writer);
+        return;
+    }
 
-    return result;
+    writer.StartDict()
+            .Key("map").Value(renderer.GetTileSvg(*viewport))
+            .Key("request_id").Value(id)
+        .EndDict();
 }
 
-const json::Node RequestHandler::HandleMapRequest(const json::Dict& request, MapRenderer& renderer) const {
-    json::Node result;
-    int id = request.at("id"s).AsInt();
+void RequestHandler::HandleRoutingRequest(const RouteRequest& request, const Router& router, json::Writer& writer) const {
+    const int id = request.id;
+    const auto route = FindRoute(request.from, request.to, router);
 
-    svg::Document svg_map = renderer.RenderMap();
+    if (!route.has_value()) {
+        WriteNotFound(id, writer);
+        return;
+    }
 
-    ostringstream strm;
-    svg_map.Render(strm);
+    const auto& route_data = route.value();
+    auto items = writer.StartDict()
+                        .Key("items").StartArray();
 
-    result = json::Builder{}
-                .StartDict()
-                    .Key("request_id").Value(id)
-                    .Key("map").Value(strm.str())
-                .EndDict()
-            .Build();
+    for (const auto edge_id : route_data.edges) {
+        const auto* edge = &router.GetEdge(edge_id);
+        if (edge->span_count == 0) {
+            items.StartDict()
+                    .Key("stop_name").Value(edge->name)
+                    .Key("time").Value(edge->weight)
+                    .Key("type").Value("Wait")
+                .EndDict();
+        } else {
+            items.StartDict()
+                    .Key("bus").Value(edge->name)
+                    .Key("span_count").Value(static_cast<int>(edge->span_count))
+                    .Key("time").Value(edge->weight)
+                    .Key("type").Value("Bus")
+                .EndDict();
+        }
+    }
 
-    return result;
+    items.EndArray()
+            .Key("request_id").Value(id)
+            .Key("total_time").Value(route_data.total_time)
+        .EndDict();
 }
 
-const json::Node RequestHandler::HandleRoutingRequest(const json::Dict& request, const Router& router) const {
-    json::Node result;
-    int id = request.at("id"s).AsInt();
-    const string_view from = request.at("from"s).AsString();
-    const string_view to = request.at("to"s).AsString();
-    const auto& route = router.FindRoute(from, to);
+void RequestHandler::HandleRouteMapRequest(const RouteMapRequest& request, MapRenderer& renderer, const Router& router,
+                                           json::Writer& writer) const {
+    const int id = request.id;
+    // Маршрут берётся из того же кэша, что и для запросов Route
+    const auto route = FindRoute(request.from, request.to, router);
 
     if (!route.has_value()) {
-        result = json::Builder{}
-                    .StartDict()
-                        .Key("request_id").Value(id)
-                        .Key("error_message").Value("not found")
-                    .EndDict()
-                .Build();
-    } else {
-        json::Array items;
-        const auto& route_data = route.value();
-        items.reserve(route_data.edges.size());
-        
-        for (const auto* edge : route_data.edges) {
-            if (edge->span_count == 0) {
-                items.emplace_back(json::Node(json::Builder{}
-                                    .StartDict()
-                                        .Key("type").Value("Wait")
-                                        .Key("stop_name").Value(edge->name)
-                                        .Key("time").Value(edge->weight)
-                                    .EndDict()
-                                .Build()
-                ));
-            } else {
-                items.emplace_back(json::Node(json::Builder{}
-                                    .StartDict()
-                                        .Key("type").Value("Bus")
-                                        .Key("bus").Value(edge->name)
-                                        .Key("span_count").Value(static_cast<int>(edge->span_count))
-                                        .Key("time").Value(edge->weight)
-                                    .EndDict()
-                                .Build()
-                ));
+        WriteNotFound(id, writer);
+        return;
+    }
+
+    writer.StartDict()
+            .Key("map");
+    writer.BeginString();
+    renderer.StreamRouteMapSvg(router.GetRouteLegs(*route), [&writer](string_view chunk) {
+        writer.AppendString(chunk);
+    });
+    writer.EndString()
+            .Key("request_id").Value(id)
+        .EndDict();
+}
+
+void RequestHandler::HandleStatsRequest(const StatsRequest& request, const MapRenderer& renderer,
+                                        const Router& router, json::Writer& writer) const {
+    const profiling::StatsSnapshot snapshot = profiling::GetStatsSnapshot();
+    const CacheStats cache_stats = GetCacheStats();
+
+    writer.StartDict();
+    if (snapshot.allocations) {
+        writer.Key("allocations");
+        WriteAllocations(*snapshot.allocations, writer);
+    }
+    writer.Key("cache").StartDict()
+                .Key("computed").Value(static_cast<int>(cache_stats.computed))
+                .Key("requests").Value(static_cast<int>(cache_stats.requests))
+            .EndDict()
+            .Key("enabled").Value(snapshot.enabled);
+
+    writer.Key("memory").StartDict();
+    writer.Key("catalogue");
+    WriteMemoryUsage(catalogue_.GetMemoryUsage(), writer);
+    writer.Key("map_renderer");
+    WriteMemoryUsage(renderer.GetMemoryUsage(), writer);
+    writer.Key("router");
+    WriteMemoryUsage(router.GetMemoryUsage(), writer);
+    // Оценка для того же способа поиска, что у router, чтобы её можно было сравнить с фактической памятью
+    RoutingOptions routing_options;
+    routing_options.engine = router.GetPlan().engine;
+    writer.Key("router_estimate");
+    WriteMemoryUsage(EstimateRouterMemory(GetNetworkSize(catalogue_), {}, routing_options), writer);
+    writer.EndDict();
+
+    auto phases = writer.Key("phases").StartDict();
+    for (const size_t i : SortByName(profiling::PHASES_COUNT, GetPhaseNameAt)) {
+        phases.Key(GetPhaseNameAt(i)).Value(static_cast<double>(snapshot.phase_ns[i]) / 1e6);
+    }
+    phases.EndDict()
+            .Key("request_id").Value(request.id);
+
+    auto requests = writer.Key("requests").StartDict();
+    for (const size_t i : SortByName(REQUEST_TYPES_COUNT, GetRequestTypeNameAt)) {
+        const profiling::LatencySummary& summary = snapshot.requests[i];
+        if (summary.count == 0) {
+            continue;
+        }
+        requests.Key(GetRequestTypeNameAt(i)).StartDict()
+                .Key("count").Value(static_cast<int>(summary.count))
+                .Key("max_us").Value(static_cast<double>(summary.max_ns) / 1e3)
+                .Key("mean_us").Value(static_cast<double>(summary.total_ns) / static_cast<double>(summary.count) / 1e3)
+                .Key("p50_us").Value(static_cast<double>(summary.p50_ns) / 1e3)
+                .Key("p90_us").Value(static_cast<double>(summary.p90_ns) / 1e3)
+                .Key("p99_us").Value(static_cast<double>(summary.p99_ns) / 1e3)
+            .EndDict();
+    }
+    requests.EndDict()
+            .Key("routing");
+    WriteRoutingPlan(router.GetPlan(), writer);
+    writer.EndDict();
+}
+
+RequestHandler::CacheStats RequestHandler::GetCacheStats() const {
+    lock_guard lock(cache_mutex_);
+    return cache_.stats;
+}
+
+optional<BusInfo> RequestHandler::GetBusInfo(string_view name) const {
+    string key(name);
+    {
+        lock_guard lock(cache_mutex_);
+        ValidateCache(nullptr);
+        ++cache_.stats.requests;
+        if (const auto it = cache_.buses.find(key); it != cache_.buses.end()) {
+            return it->second;
+        }
+    }
+
+    // Вычисление идёт без блокировки; одинаковые запросы из разных потоков могут вычислиться дважды
+    optional<BusInfo> info = catalogue_.GetRouteInfo(name);
+    lock_guard lock(cache_mutex_);
+    ++cache_.stats.computed;
+    if (cache_.buses.size() < MAX_CACHED_RESULTS) {
+        cache_.buses.emplace(move(key), info);
+    }
+    return info;
+}
+
+optional<RouteData> RequestHandler::FindRoute(string_view from, string_view to, const Router& router) const {
+    string key = MakeRouteKey(from, to);
+    {
+        lock_guard lock(cache_mutex_);
+        ValidateCache(&router);
+        ++cache_.stats.requests;
+        if (const auto it = cache_.routes.find(key); it != cache_.routes.end()) {
+            return it->second;
+        }
+    }
+
+    optional<RouteData> route = router.FindRoute(from, to);
+    lock_guard lock(cache_mutex_);
+    ++cache_.stats.computed;
+    if (cache_.routes.size() < MAX_CACHED_RESULTS) {
+        cache_.routes.emplace(move(key), route);
+    }
+    return route;
+}
+
+void RequestHandler::PrefetchRoutes(vector<pair<string_view, string_view>> queries, const Router& router,
+                                    unsigned threads) const {
+    if (router.GetPlan().engine != RoutingEngine::ON_DEMAND || queries.empty()) {
+        return;
+    }
+    sort(queries.begin(), queries.end());
+    queries.erase(unique(queries.begin(), queries.end()), queries.end());
+
+    // Каждый поток получает подряд идущие начальные остановки, граница части сдвигается к смене остановки
+    vector<size_t> bounds{0};
+    for (unsigned part = 1; part < threads; ++part) {
+        size_t bound = max(bounds.back(), queries.size() * part / threads);
+        while (bound > 0 && bound < queries.size() && queries[bound].first == queries[bound - 1].first) {
+            ++bound;
+        }
+        bounds.push_back(bound);
+    }
+    bounds.push_back(queries.size());
+
+    const auto prefetch = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            string key = MakeRouteKey(queries[i].first, queries[i].second);
+            {
+                lock_guard lock(cache_mutex_);
+                ValidateCache(&router);
+                // Маршруты, которые не поместятся в кэш, вычисляются при обработке запросов
+                if (cache_.routes.size() >= MAX_CACHED_RESULTS) {
+                    return;
+                }
+                if (cache_.routes.count(key) > 0) {
+                    continue;
+                }
             }
+
+            optional<RouteData> route = router.FindRoute(queries[i].first, queries[i].second);
+            lock_guard lock(cache_mutex_);
+            ++cache_.stats.computed;
+            cache_.routes.emplace(move(key), move(route));
         }
+    };
+
+    vector<thread> workers;
+    for (size_t part = 1; part + 1 < bounds.size(); ++part) {
+        workers.emplace_back(prefetch, bounds[part], bounds[part + 1]);
+    }
+    prefetch(bounds[0], bounds[1]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
 
-        result = json::Builder{}
-                    .StartDict()
-                        .Key("request_id").Value(id)
-                        .Key("total_time").Value(route_data.total_time)
-                        .Key("items").Value(move(items))
-                    .EndDict()
-                .Build();
+void RequestHandler::ValidateCache(const Router* router) const {
+    const uint64_t version = catalogue_.GetVersion();
+    if (cache_.version != version) {
+        cache_.buses.clear();
+        cache_.routes.clear();
+        cache_.version = version;
     }
+    if (router == nullptr) {
+        return;
+    }
+    const RouterKey key{router->GetCatalogueVersion(), router->GetSettings(), router->GetPlan().engine};
+    if (cache_.router != key) {
+        cache_.routes.clear();
+        cache_.router = key;
+    }
+}
+
+void RequestHandler::WriteNotFound(int id, json::Writer& writer) const {
+    WriteError(id, "not found"sv, writer);
+}
 
-    return result;
+void RequestHandler::WriteError(int id, string_view message, json::Writer& writer) const {
+    writer.StartDict()
+            .Key("error_message").Value(message)
+            .Key("request_id").Value(id)
+        .EndDict();
 }
 
-} // namespace transport_catalogue::requesting
\ No newline at end of file
+} // namespace transport_catalogue::requesting
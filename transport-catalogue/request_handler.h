@@ -1,12 +1,21 @@
 #pragma once
 
 #include "json.h"
+#include "json_writer.h"
 #include "map_renderer.h"
+#include "requests.h"
 #include "svg.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
+#include <cstdint>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace transport_catalogue::requesting {
 
@@ -14,20 +23,90 @@ using namespace transport_catalogue::database;
 using namespace transport_catalogue::map_renderer;
 using namespace transport_catalogue::routing;
 
+// Предел числа запомненных результатов каждого вида; после него новые результаты не запоминаются
+inline const size_t MAX_CACHED_RESULTS = 1 << 18;
+
+// Обработчики запросов записывают ответ очередным элементом массива, открытого в writer.
+// Результаты запросов Bus и маршруты запросов Route и RouteMap запоминаются по параметрам, поэтому одинаковые
+// запросы с разными id вычисляются один раз при любом способе поиска. Обработчики можно вызывать из нескольких потоков
 class RequestHandler {
 public:
+    // Сколько запросов Bus, Route и RouteMap обработано и сколько из них вычислено, а не взято из кэша
+    struct CacheStats {
+        size_t requests = 0;
+        size_t computed = 0;
+    };
+
     explicit RequestHandler(const TransportCatalogue& catalogue);
 
-    const json::Node HandleRouteRequest(const json::Dict& request) const;
+    void HandleRouteRequest(const BusRequest& request, json::Writer& writer) const;
+
+    void HandleStopRequest(const StopRequest& request, json::Writer& writer) const;
+
+    void HandleMapRequest(const MapRequest& request, MapRenderer& renderer, json::Writer& writer) const;
+
+    void HandleMapTileRequest(const MapTileRequest& request, MapRenderer& renderer, json::Writer& writer) const;
+
+    void HandleRoutingRequest(const RouteRequest& request, const Router& router, json::Writer& writer) const;
+
+    void HandleRouteMapRequest(const RouteMapRequest& request, MapRenderer& renderer, const Router& router,
+                               json::Writer& writer) const;
 
-    const json::Node HandleStopRequest(const json::Dict& request) const;
+    // Время этапов в миллисекундах, задержки запросов по типам в микросекундах, счётчики кэша результатов
+    // и память структур данных. Обращается к кэшам renderer, как и запросы карты
+    void HandleStatsRequest(const StatsRequest& request, const MapRenderer& renderer, const Router& router,
+                            json::Writer& writer) const;
 
-    const json::Node HandleMapRequest(const json::Dict& request, MapRenderer& renderer) const;
+    CacheStats GetCacheStats() const;
 
-    const json::Node HandleRoutingRequest(const json::Dict& request, const Router& router) const;
+    // Заранее вычисляет маршруты для запросов Route и RouteMap из queries (пар начальной и конечной остановок),
+    // чтобы обработчики брали их из кэша. Поиск по запросу (RoutingEngine::ON_DEMAND) запоминает
+    // ограниченное число деревьев маршрутов и при переполнении забывает их все, поэтому запросы
+    // с общей начальной остановкой вычисляются подряд и дерево строится один раз. Остальные способы поиска
+    // от порядка запросов не зависят, и для них ничего не делается
+    void PrefetchRoutes(std::vector<std::pair<std::string_view, std::string_view>> queries, const Router& router,
+                        unsigned threads) const;
 
 private:
+    // Маршрутизатор, для которого запомнены маршруты. Маршруты определяются графом и способом поиска,
+    // а граф — версией справочника и настройками, поэтому адрес объекта Router в ключ не входит
+    struct RouterKey {
+        uint64_t version;
+        RoutingSettings settings;
+        RoutingEngine engine;
+
+        bool operator==(const RouterKey& other) const {
+            return version == other.version && settings == other.settings && engine == other.engine;
+        }
+
+        bool operator!=(const RouterKey& other) const {
+            return !(*this == other);
+        }
+    };
+
+    // Результаты действительны для одной версии справочника и одного маршрутизатора
+    struct ResultCache {
+        std::optional<uint64_t> version;
+        std::optional<RouterKey> router;
+        std::unordered_map<std::string, std::optional<BusInfo>> buses;
+        // Ключ — названия начальной и конечной остановок, разделённые нулевым символом
+        std::unordered_map<std::string, std::optional<RouteData>> routes;
+        CacheStats stats;
+    };
+
     const TransportCatalogue& catalogue_;
+    mutable std::mutex cache_mutex_;
+    mutable ResultCache cache_;
+
+    std::optional<BusInfo> GetBusInfo(std::string_view name) const;
+    std::optional<RouteData> FindRoute(std::string_view from, std::string_view to, const Router& router) const;
+    // Очищает кэш, если справочник сменился, а при заданном router — и если маршрутизатор построен
+    // по другой версии справочника, с другими настройками или способом поиска; вызывается под cache_mutex_
+    void ValidateCache(const Router* router) const;
+
+    void WriteNotFound(int id, json::Writer& writer) const;
+
+    void WriteError(int id, std::string_view message, json::Writer& writer) const;
 };
 
-} // namespace transport_catalogue::requesting
\ No newline at end of file
+} // namespace transport_catalogue::requesting
@@ -0,0 +1,184 @@
+#include "requests.h"
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+using namespace std;
+
+namespace transport_catalogue::requesting {
+
+namespace {
+
+// Поле запроса в документе json: указатель на узел, nullptr — поля нет
+const json::Node* MakeField(const json::Node& value) {
+    return &value;
+}
+
+// Поле запроса в ленте json::tape: курсор на значение, nullopt — поля нет
+optional<json::tape::Value> MakeField(json::tape::Value value) {
+    return value;
+}
+
+// Значения известных полей запроса; поле, которого нет в запросе, остаётся пустым
+template <typename Field>
+struct RequestFields {
+    Field type{};
+    Field id{};
+    Field name{};
+    Field latitude{};
+    Field longitude{};
+    Field road_distances{};
+    Field stops{};
+    Field is_roundtrip{};
+    Field from{};
+    Field to{};
+    Field bbox{};
+    Field zoom{};
+    Field x{};
+    Field y{};
+};
+
+// Один проход по словарю; сравнение строк с разной длиной завершается сразу.
+// Лента хранит повторяющиеся ключи, из них, как и в json::Dict, действует первый
+template <typename Map>
+auto CollectFields(const Map& request) {
+    RequestFields<decltype(MakeField((*request.begin()).second))> fields;
+    for (const auto& [key, value] : request) {
+        const string_view name = key;
+        auto set = [&value](auto& field) {
+            if (!field) {
+                field = MakeField(value);
+            }
+        };
+        if (name == "type"sv) {
+            set(fields.type);
+        } else if (name == "id"sv) {
+            set(fields.id);
+        } else if (name == "name"sv) {
+            set(fields.name);
+        } else if (name == "from"sv) {
+            set(fields.from);
+        } else if (name == "to"sv) {
+            set(fields.to);
+        } else if (name == "latitude"sv) {
+            set(fields.latitude);
+        } else if (name == "longitude"sv) {
+            set(fields.longitude);
+        } else if (name == "road_distances"sv) {
+            set(fields.road_distances);
+        } else if (name == "stops"sv) {
+            set(fields.stops);
+        } else if (name == "is_roundtrip"sv) {
+            set(fields.is_roundtrip);
+        } else if (name == "bbox"sv) {
+            set(fields.bbox);
+        } else if (name == "zoom"sv) {
+            set(fields.zoom);
+        } else if (name == "x"sv) {
+            set(fields.x);
+        } else if (name == "y"sv) {
+            set(fields.y);
+        }
+    }
+    return fields;
+}
+
+template <typename Field>
+const auto& Require(const Field& field, string_view key) {
+    if (!field) {
+        throw out_of_range("Missing request field: "s + string(key));
+    }
+    return *field;
+}
+
+template <typename Map>
+StatRequest DecodeStatRequestFrom(const Map& request) {
+    const auto fields = CollectFields(request);
+    const RequestType type = GetRequestType(Require(fields.type, "type"sv).AsString());
+    if (type == RequestType::UNKNOWN) {
+        return monostate{};
+    }
+
+    const int id = Require(fields.id, "id"sv).AsInt();
+    switch (type) {
+    case RequestType::STOP:
+        return StopRequest{id, Require(fields.name, "name"sv).AsString()};
+    case RequestType::BUS:
+        return BusRequest{id, Require(fields.name, "name"sv).AsString()};
+    case RequestType::MAP:
+        return MapRequest{id};
+    case RequestType::MAP_TILE: {
+        MapTileRequest tile;
+        tile.id = id;
+        if (fields.bbox) {
+            tile.has_bbox = true;
+            const auto& bbox = fields.bbox->AsArray();
+            if (bbox.size() == 4) {
+                tile.bbox = Rect{bbox[0].AsDouble(), bbox[1].AsDouble(), bbox[2].AsDouble(), bbox[3].AsDouble()};
+            }
+        } else {
+            tile.zoom = Require(fields.zoom, "zoom"sv).AsInt();
+            tile.x = Require(fields.x, "x"sv).AsInt();
+            tile.y = Require(fields.y, "y"sv).AsInt();
+        }
+        return tile;
+    }
+    case RequestType::ROUTE:
+        return RouteRequest{id, Require(fields.from, "from"sv).AsString(), Require(fields.to, "to"sv).AsString()};
+    case RequestType::ROUTE_MAP:
+        return RouteMapRequest{id, Require(fields.from, "from"sv).AsString(), Require(fields.to, "to"sv).AsString()};
+    case RequestType::STATS:
+        return StatsRequest{id};
+    default:
+        return monostate{};
+    }
+}
+
+}  // namespace
+
+BaseRequest DecodeBaseRequest(const json::Dict& request) {
+    const auto fields = CollectFields(request);
+    switch (GetRequestType(Require(fields.type, "type"sv).AsString())) {
+    case RequestType::STOP:
+        return StopDescription{
+            Require(fields.name, "name"sv).AsString(),
+            {Require(fields.latitude, "latitude"sv).AsDouble(), Require(fields.longitude, "longitude"sv).AsDouble()},
+            &Require(fields.road_distances, "road_distances"sv).AsMap()
+        };
+    case RequestType::BUS: {
+        BusDescription bus;
+        bus.name = Require(fields.name, "name"sv).AsString();
+        const auto& stops = Require(fields.stops, "stops"sv).AsArray();
+        bus.stops.reserve(stops.size());
+        for (const auto& stop : stops) {
+            bus.stops.push_back(stop.AsString());
+        }
+        bus.is_roundtrip = Require(fields.is_roundtrip, "is_roundtrip"sv).AsBool();
+        return bus;
+    }
+    default:
+        return monostate{};
+    }
+}
+
+StatRequest DecodeStatRequest(const json::Dict& request) {
+    return DecodeStatRequestFrom(request);
+}
+
+StatRequest DecodeStatRequest(const json::tape::ObjectView& request) {
+    return DecodeStatRequestFrom(request);
+}
+
+RequestType GetRequestType(const StatRequest& request) {
+    return visit([](const auto& value) {
+        if constexpr (is_same_v<decay_t<decltype(value)>, monostate>) {
+            return RequestType::UNKNOWN;
+        } else {
+            return decay_t<decltype(value)>::TYPE;
+        }
+    }, request);
+}
+
+}  // namespace transport_catalogue::requesting
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "geo.h"
+#include "json.h"
+#include "json_tape.h"
+#include "rect.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace transport_catalogue::requesting {
+
+using namespace transport_catalogue::geo;
+using map_renderer::Rect;
+
+enum class RequestType : uint8_t {
+    STOP,
+    BUS,
+    MAP,
+    MAP_TILE,
+    ROUTE,
+    ROUTE_MAP,
+    STATS,
+    UNKNOWN,
+};
+
+// Число известных типов запросов; RequestType::UNKNOWN в него не входит
+inline constexpr size_t REQUEST_TYPES_COUNT = static_cast<size_t>(RequestType::UNKNOWN);
+
+namespace detail {
+
+struct RequestTypeName {
+    std::string_view name;
+    RequestType type = RequestType::UNKNOWN;
+};
+
+inline constexpr RequestTypeName REQUEST_TYPE_NAMES[] = {
+    {"Stop", RequestType::STOP},
+    {"Bus", RequestType::BUS},
+    {"Map", RequestType::MAP},
+    {"MapTile", RequestType::MAP_TILE},
+    {"Route", RequestType::ROUTE},
+    {"RouteMap", RequestType::ROUTE_MAP},
+    {"Stats", RequestType::STATS},
+};
+
+inline constexpr size_t TYPE_TABLE_SIZE = 16;
+
+// Хэш по длине, первому и последнему символу: названия типов различаются уже ими
+constexpr size_t HashTypeName(std::string_view name, uint32_t seed) {
+    const uint32_t first = static_cast<unsigned char>(name.front());
+    const uint32_t last = static_cast<unsigned char>(name.back());
+    return ((first * seed) ^ (last + static_cast<uint32_t>(name.size()) * seed)) % TYPE_TABLE_SIZE;
+}
+
+// Наименьший seed, при котором все названия попадают в разные ячейки таблицы; 0, если такого нет
+constexpr uint32_t FindTypeHashSeed() {
+    for (uint32_t seed = 1; seed < 1000; ++seed) {
+        bool used[TYPE_TABLE_SIZE] = {};
+        bool collision = false;
+        for (const auto& entry : REQUEST_TYPE_NAMES) {
+            const size_t cell = HashTypeName(entry.name, seed);
+            collision = collision || used[cell];
+            used[cell] = true;
+        }
+        if (!collision) {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+inline constexpr uint32_t TYPE_HASH_SEED = FindTypeHashSeed();
+static_assert(TYPE_HASH_SEED != 0, "No perfect hash seed for request type names");
+
+// Пустые ячейки таблицы содержат пустое название, не совпадающее ни с одним типом
+constexpr std::array<RequestTypeName, TYPE_TABLE_SIZE> MakeTypeTable() {
+    std::array<RequestTypeName, TYPE_TABLE_SIZE> table{};
+    for (const auto& entry : REQUEST_TYPE_NAMES) {
+        table[HashTypeName(entry.name, TYPE_HASH_SEED)] = entry;
+    }
+    return table;
+}
+
+inline constexpr auto TYPE_TABLE = MakeTypeTable();
+
+}  // namespace detail
+
+// Тип запроса по значению ключа "type": одно вычисление хэша и одно сравнение строк
+constexpr RequestType GetRequestType(std::string_view name) {
+    if (name.empty()) {
+        return RequestType::UNKNOWN;
+    }
+    const auto& entry = detail::TYPE_TABLE[detail::HashTypeName(name, detail::TYPE_HASH_SEED)];
+    return entry.name == name ? entry.type : RequestType::UNKNOWN;
+}
+
+// Название типа запроса, как в ключе "type"; для RequestType::UNKNOWN — пустая строка
+constexpr std::string_view GetRequestTypeName(RequestType type) {
+    for (const auto& entry : detail::REQUEST_TYPE_NAMES) {
+        if (entry.type == type) {
+            return entry.name;
+        }
+    }
+    return {};
+}
+
+// Описания из base_requests. Строки ссылаются на узлы разобранного документа
+struct StopDescription {
+    std::string_view name;
+    Coordinates coords;
+    // Словарь road_distances
+    const json::Dict* road_distances = nullptr;
+};
+
+struct BusDescription {
+    std::string_view name;
+    std::vector<std::string_view> stops;
+    bool is_roundtrip = false;
+};
+
+// Запросы из stat_requests
+struct StopRequest {
+    static constexpr RequestType TYPE = RequestType::STOP;
+
+    int id = 0;
+    std::string_view name;
+};
+
+struct BusRequest {
+    static constexpr RequestType TYPE = RequestType::BUS;
+
+    int id = 0;
+    std::string_view name;
+};
+
+struct MapRequest {
+    static constexpr RequestType TYPE = RequestType::MAP;
+
+    int id = 0;
+};
+
+// Тайл задаётся ключами zoom, x, y или массивом bbox [min_x, min_y, max_x, max_y] в координатах карты
+struct MapTileRequest {
+    static constexpr RequestType TYPE = RequestType::MAP_TILE;
+
+    int id = 0;
+    bool has_bbox = false;
+    // Пусто, если bbox задан, но содержит не четыре элемента
+    std::optional<Rect> bbox;
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
+};
+
+struct RouteRequest {
+    static constexpr RequestType TYPE = RequestType::ROUTE;
+
+    int id = 0;
+    std::string_view from;
+    std::string_view to;
+};
+
+// Карта с маршрутом из from в to, выделенным поверх остальных
+struct RouteMapRequest {
+    static constexpr RequestType TYPE = RequestType::ROUTE_MAP;
+
+    int id = 0;
+    std::string_view from;
+    std::string_view to;
+};
+
+// Счётчики времени и задержек обработки запросов, собранные с начала работы программы
+struct StatsRequest {
+    static constexpr RequestType TYPE = RequestType::STATS;
+
+    int id = 0;
+};
+
+// std::monostate — запрос неизвестного типа, на который не даётся ответа
+using BaseRequest = std::variant<std::monostate, StopDescription, BusDescription>;
+using StatRequest = std::variant<std::monostate, StopRequest, BusRequest, MapRequest, MapTileRequest,
+                                 RouteRequest, RouteMapRequest, StatsRequest>;
+
+// Тип декодированного запроса; для std::monostate — RequestType::UNKNOWN
+RequestType GetRequestType(const StatRequest& request);
+
+// Извлекают поля запроса за один проход по словарю. При отсутствии обязательного поля
+// выбрасывают std::out_of_range, при неверном типе значения — исключение json::Node или json::tape::Value
+BaseRequest DecodeBaseRequest(const json::Dict& request);
+StatRequest DecodeStatRequest(const json::Dict& request);
+// Запрос из ленты; строки запроса ссылаются на json::tape::Document
+StatRequest DecodeStatRequest(const json::tape::ObjectView& request);
+
+}  // namespace transport_catalogue::requesting
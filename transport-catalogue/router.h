@@ -29,6 +29,10 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    memory::MemoryUsage GetMemoryUsage() const;
+    // Матрица маршрутов между всеми парами вершин занимает память, квадратичную по их числу
+    static memory::MemoryUsage EstimateMemoryUsage(size_t vertex_count);
+
 private:
     struct RouteInternalData {
         Weight weight;
@@ -114,4 +118,20 @@ std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(Ver
     return RouteInfo{weight, std::move(edges)};
 }
 
+template <typename Weight>
+memory::MemoryUsage Router<Weight>::GetMemoryUsage() const {
+    size_t bytes = memory::GetVectorBytes(routes_internal_data_);
+    for (const auto& routes : routes_internal_data_) {
+        bytes += memory::GetVectorBytes(routes);
+    }
+    return {{"routes_internal_data", bytes}};
+}
+
+template <typename Weight>
+memory::MemoryUsage Router<Weight>::EstimateMemoryUsage(size_t vertex_count) {
+    using Routes = std::vector<std::optional<RouteInternalData>>;
+    return {{"routes_internal_data",
+             vertex_count * (sizeof(Routes) + vertex_count * sizeof(typename Routes::value_type))}};
+}
+
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "server.h"
+
+#include "json_tape.h"
+#include "requests.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace transport_catalogue::serving {
+
+namespace {
+
+constexpr size_t READ_CHUNK_SIZE = 1 << 16;
+constexpr int LISTEN_BACKLOG = 64;
+
+sockaddr_un MakeAddress(const string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("Socket path is too long: "s + path);
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.data(), path.size());
+    return address;
+}
+
+// Закрывает дескриптор при выходе из области видимости
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd)
+        : fd_(fd) {}
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    ~FileDescriptor() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    int Get() const {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+// Записывает data целиком; возвращает false, если соединение закрыто
+bool SendAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+// Удаляет файл сокета, оставшийся от прошлого запуска. Файлы других типов не трогает
+void RemoveStaleSocket(const string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) < 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw runtime_error("Cannot stat "s + path + ": "s + strerror(errno));
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        throw runtime_error(path + " exists and is not a socket"s);
+    }
+    unlink(path.c_str());
+}
+
+// Передаёт fn каждую полную строку, прочитанную из fd, до конца данных.
+// Возвращает false, если встретилась строка длиннее max_line_size
+template <typename LineHandler>
+bool ReadLines(int fd, size_t max_line_size, LineHandler fn) {
+    string pending;
+    char chunk[READ_CHUNK_SIZE];
+    while (true) {
+        const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        pending.append(chunk, static_cast<size_t>(received));
+
+        size_t begin = 0;
+        for (size_t end = pending.find('\n'); end != string::npos; end = pending.find('\n', begin)) {
+            if (end - begin > max_line_size) {
+                return false;
+            }
+            if (!fn(string_view(pending).substr(begin, end - begin))) {
+                return true;
+            }
+            begin = end + 1;
+        }
+        pending.erase(0, begin);
+        // Строка без перевода строки не накапливается дальше предела
+        if (pending.size() > max_line_size) {
+            return false;
+        }
+    }
+    if (!pending.empty()) {
+        fn(pending);
+    }
+    return true;
+}
+
+// Ответ с сообщением об ошибке в компактном формате
+string RenderError(string_view message) {
+    json::PrintSettings print_settings;
+    print_settings.compact = true;
+    json::OutputBuffer buffer;
+    json::Writer writer(buffer, print_settings);
+    writer.StartDict()
+            .Key("error_message").Value(message)
+        .EndDict();
+    return buffer.Release();
+}
+
+}  // namespace
+
+Server::Server(const JsonReader& reader, MapRenderer& renderer, const Router& router)
+    : reader_(reader)
+    , renderer_(renderer)
+    , router_(router) {}
+
+string Server::HandleLine(string_view line) {
+    json::PrintSettings print_settings;
+    print_settings.compact = true;
+    json::OutputBuffer buffer;
+    json::Writer writer(buffer, print_settings);
+
+    try {
+        // Запрос только читается, поэтому разбирается в ленту без словарей и копий строк
+        const json::tape::Document doc = json::tape::Document::Parse(string(line));
+        reader_.ProcessStatRequest(DecodeStatRequest(doc.GetRoot().AsMap()), renderer_, router_, &renderer_mutex_,
+                                   writer);
+    } catch (const exception&) {
+        // Частично выведенный ответ заменяется сообщением об ошибке
+        return RenderError("invalid request"sv);
+    }
+
+    // Запрос неизвестного типа в пакетном режиме остаётся без ответа, а здесь клиент ждёт строку
+    if (buffer.View().empty()) {
+        return RenderError("unknown request type"sv);
+    }
+    return buffer.Release();
+}
+
+void Server::Serve(istream& input, ostream& output) {
+    string line;
+    while (getline(input, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        output << HandleLine(line) << '\n';
+        output.flush();
+    }
+}
+
+void Server::ServeSocket(const string& path) {
+    const sockaddr_un address = MakeAddress(path);
+    FileDescriptor listener(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener.Get() < 0) {
+        throw runtime_error("Cannot create socket: "s + strerror(errno));
+    }
+    RemoveStaleSocket(path);
+    if (bind(listener.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || listen(listener.Get(), LISTEN_BACKLOG) < 0) {
+        throw runtime_error("Cannot listen on "s + path + ": "s + strerror(errno));
+    }
+
+    {
+        const lock_guard lock(connections_mutex_);
+        if (stopped_) {
+            return;
+        }
+        listener_ = listener.Get();
+    }
+    // Потоки соединений обращаются к серверу, поэтому присоединяются до выхода, в том числе по исключению
+    try {
+        AcceptConnections(listener.Get());
+    } catch (...) {
+        JoinAll();
+        throw;
+    }
+    JoinAll();
+}
+
+void Server::Stop() {
+    const lock_guard lock(connections_mutex_);
+    stopped_ = true;
+    // Прерывает ожидание в accept
+    if (listener_ >= 0) {
+        shutdown(listener_, SHUT_RDWR);
+    }
+    connection_finished_.notify_all();
+}
+
+void Server::AcceptConnections(int listener) {
+    while (true) {
+        {
+            unique_lock lock(connections_mutex_);
+            JoinFinished();
+            while (!stopped_ && connections_.size() >= MAX_CONNECTIONS) {
+                connection_finished_.wait(lock);
+                JoinFinished();
+            }
+            if (stopped_) {
+                return;
+            }
+        }
+
+        const int fd = accept(listener, nullptr, nullptr);
+        unique_lock lock(connections_mutex_);
+        if (stopped_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return;
+        }
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            throw runtime_error("Cannot accept connection: "s + strerror(errno));
+        }
+
+        Connection& connection = connections_.emplace_back(Connection{fd, {}});
+        connection.worker = thread([this, &connection] {
+            try {
+                ServeConnection(connection.fd);
+            } catch (const exception&) {
+                // Ошибка одного соединения не останавливает сервер
+            }
+            // Дескриптор закрывается под блокировкой, чтобы JoinAll не завершил чужой дескриптор с тем же номером
+            const lock_guard lock(connections_mutex_);
+            close(connection.fd);
+            connection.finished = true;
+            connection_finished_.notify_all();
+        });
+    }
+}
+
+void Server::JoinFinished() {
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (it->finished) {
+            it->worker.join();
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Server::JoinAll() {
+    {
+        const lock_guard lock(connections_mutex_);
+        listener_ = -1;
+        // Прерывает чтение запросов; соединение отвечает на уже прочитанный запрос и завершается
+        for (const Connection& connection : connections_) {
+            if (!connection.finished) {
+                shutdown(connection.fd, SHUT_RDWR);
+            }
+        }
+    }
+    // Новые соединения больше не добавляются, поэтому список обходится без блокировки
+    for (Connection& connection : connections_) {
+        connection.worker.join();
+    }
+    connections_.clear();
+}
+
+void Server::ServeConnection(int fd) {
+    string response;
+    const bool complete = ReadLines(fd, MAX_LINE_SIZE, [&](string_view line) {
+        if (line.empty()) {
+            return true;
+        }
+        response = HandleLine(line);
+        response += '\n';
+        return SendAll(fd, response);
+    });
+    if (!complete) {
+        SendAll(fd, RenderError("request is too long"sv) + '\n');
+    }
+}
+
+void RunClient(const string& path, istream& input, ostream& output) {
+    const sockaddr_un address = MakeAddress(path);
+    FileDescriptor connection(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (connection.Get() < 0
+        || connect(connection.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        throw runtime_error("Cannot connect to "s + path + ": "s + strerror(errno));
+    }
+
+    // Запросы отправляются, не дожидаясь ответов; конец ввода сообщается серверу закрытием записи
+    thread sender([&] {
+        string line;
+        while (getline(input, line)) {
+            line += '\n';
+            if (!SendAll(connection.Get(), line)) {
+                break;
+            }
+        }
+        shutdown(connection.Get(), SHUT_WR);
+    });
+
+    ReadLines(connection.Get(), numeric_limits<size_t>::max(), [&output](string_view line) {
+        output << line << '\n';
+        return true;
+    });
+    output.flush();
+    sender.join();
+}
+
+} // namespace transport_catalogue::serving
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "transport_router.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace transport_catalogue::serving {
+
+using namespace transport_catalogue::map_renderer;
+using namespace transport_catalogue::processing;
+using namespace transport_catalogue::routing;
+
+/*
+ * Отвечает на stat-запросы по одному, не перестраивая справочник и маршрутизатор.
+ * Запрос — JSON-словарь в одной строке, ответ — словарь в одной строке в компактном формате.
+ * Справочник и маршрутизатор только читаются, поэтому соединения обслуживаются параллельно,
+ * а запросы карты, пользующиеся кэшами renderer, выполняются по одному
+ */
+class Server {
+public:
+    Server(const JsonReader& reader, MapRenderer& renderer, const Router& router);
+
+    // Ответ на одну строку запроса, без перевода строки
+    std::string HandleLine(std::string_view line);
+
+    // Читает запросы из input, пока он не закончится, и пишет ответы в output
+    void Serve(std::istream& input, std::ostream& output);
+
+    // Принимает соединения на Unix-сокете path и обслуживает каждое в отдельном потоке, одновременно
+    // не больше MAX_CONNECTIONS. Существующий файл path заменяется, только если это сокет.
+    // Возвращает управление после Stop, закрыв соединения и дождавшись их потоков;
+    // если сокет не удалось открыть или принять соединение, выбрасывает runtime_error
+    void ServeSocket(const std::string& path);
+
+    // Прерывает ServeSocket из другого потока
+    void Stop();
+
+    static constexpr size_t MAX_CONNECTIONS = 64;
+    // Строка запроса длиннее этого отвергается, а соединение закрывается
+    static constexpr size_t MAX_LINE_SIZE = 1 << 20;
+
+private:
+    struct Connection {
+        int fd;
+        std::thread worker;
+        bool finished = false;
+    };
+
+    void AcceptConnections(int listener);
+    void ServeConnection(int fd);
+    // Присоединяет потоки завершённых соединений; вызывается под connections_mutex_
+    void JoinFinished();
+    // Закрывает соединения и дожидается их потоков
+    void JoinAll();
+
+    const JsonReader& reader_;
+    MapRenderer& renderer_;
+    const Router& router_;
+    std::mutex renderer_mutex_;
+
+    std::mutex connections_mutex_;
+    std::condition_variable connection_finished_;
+    std::list<Connection> connections_;
+    int listener_ = -1;
+    bool stopped_ = false;
+};
+
+// Пересылает строки из input на Unix-сокет path и выводит ответы сервера в output
+void RunClient(const std::string& path, std::istream& input, std::ostream& output);
+
+} // namespace transport_catalogue::serving
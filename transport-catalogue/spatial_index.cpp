@@ -0,0 +1,145 @@
+#include "memory_usage.h"
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace transport_catalogue::map_renderer {
+
+namespace {
+
+// Больше ячеек не нужно: при таком размере сетки в ячейку попадают единицы объектов
+constexpr size_t MAX_GRID_SIDE = 512;
+// Ограничение размера сетки занятости по каждой стороне, чтобы мелкий шрифт не порождал миллионы ячеек
+constexpr size_t MAX_OCCUPANCY_SIDE = 2048;
+
+}  // namespace
+
+GridIndex::GridIndex(const Rect& bounds, const vector<vector<Rect>>& items)
+    : bounds_(bounds) {
+    size_t rects_count = 0;
+    double total_width = 0;
+    double total_height = 0;
+    for (const auto& rects : items) {
+        for (const Rect& rect : rects) {
+            ++rects_count;
+            total_width += rect.max_x - rect.min_x;
+            total_height += rect.max_y - rect.min_y;
+        }
+    }
+
+    double side = sqrt(static_cast<double>(rects_count));
+    if (total_width > 0) {
+        side = min(side, (bounds.max_x - bounds.min_x) * rects_count / total_width);
+    }
+    if (total_height > 0) {
+        side = min(side, (bounds.max_y - bounds.min_y) * rects_count / total_height);
+    }
+    side_ = clamp<size_t>(static_cast<size_t>(max(side, 1.)), 1, MAX_GRID_SIDE);
+    cell_width_ = max((bounds.max_x - bounds.min_x) / side_, 1e-9);
+    cell_height_ = max((bounds.max_y - bounds.min_y) / side_, 1e-9);
+    cells_.assign(side_ * side_, {});
+
+    for (uint32_t id = 0; id < items.size(); ++id) {
+        for (const Rect& rect : items[id]) {
+            Insert(rect, id);
+        }
+    }
+}
+
+void GridIndex::Insert(const Rect& rect, uint32_t id) {
+    const CellRange range = GetCells(rect);
+    for (size_t row = range.min_row; row <= range.max_row; ++row) {
+        for (size_t col = range.min_col; col <= range.max_col; ++col) {
+            cells_[row * side_ + col].push_back(id);
+        }
+    }
+}
+
+vector<uint32_t> GridIndex::Query(const Rect& rect) const {
+    // Протяжённый объект встречается во многих ячейках. Повторы удаляются сортировкой собранных номеров,
+    // поэтому время запроса зависит от числа кандидатов в ячейках запроса, а не от числа всех объектов
+    vector<uint32_t> result;
+    const CellRange range = GetCells(rect);
+    for (size_t row = range.min_row; row <= range.max_row; ++row) {
+        for (size_t col = range.min_col; col <= range.max_col; ++col) {
+            const auto& cell = cells_[row * side_ + col];
+            result.insert(result.end(), cell.begin(), cell.end());
+        }
+    }
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+size_t GridIndex::GetMemoryUsage() const {
+    size_t bytes = memory::GetVectorBytes(cells_);
+    for (const auto& cell : cells_) {
+        bytes += memory::GetVectorBytes(cell);
+    }
+    return bytes;
+}
+
+GridIndex::CellRange GridIndex::GetCells(const Rect& rect) const {
+    return {
+        GetCell(rect.min_x, bounds_.min_x, cell_width_),
+        GetCell(rect.min_y, bounds_.min_y, cell_height_),
+        GetCell(rect.max_x, bounds_.min_x, cell_width_),
+        GetCell(rect.max_y, bounds_.min_y, cell_height_)
+    };
+}
+
+size_t GridIndex::GetCell(double value, double origin, double cell_size) const {
+    const double cell = floor((value - origin) / cell_size);
+    // Условие записано так, чтобы NaN тоже попадал в первую ячейку
+    if (!(cell > 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(min(cell, static_cast<double>(side_ - 1)));
+}
+
+OccupancyGrid::OccupancyGrid(const Rect& bounds, double cell_size)
+    : bounds_(bounds) {
+    const double width = max(bounds.max_x - bounds.min_x, 0.);
+    const double height = max(bounds.max_y - bounds.min_y, 0.);
+    cell_size_ = max({cell_size, width / MAX_OCCUPANCY_SIDE, height / MAX_OCCUPANCY_SIDE, 1e-9});
+    cols_ = clamp<size_t>(static_cast<size_t>(ceil(width / cell_size_)), 1, MAX_OCCUPANCY_SIDE);
+    rows_ = clamp<size_t>(static_cast<size_t>(ceil(height / cell_size_)), 1, MAX_OCCUPANCY_SIDE);
+    cells_.assign(cols_ * rows_, {});
+}
+
+bool OccupancyGrid::TryInsert(const Rect& rect) {
+    const size_t min_col = GetCell(rect.min_x, bounds_.min_x, cols_);
+    const size_t max_col = GetCell(rect.max_x, bounds_.min_x, cols_);
+    const size_t min_row = GetCell(rect.min_y, bounds_.min_y, rows_);
+    const size_t max_row = GetCell(rect.max_y, bounds_.min_y, rows_);
+
+    for (size_t row = min_row; row <= max_row; ++row) {
+        for (size_t col = min_col; col <= max_col; ++col) {
+            for (const Rect& other : cells_[row * cols_ + col]) {
+                if (rect.Intersects(other)) {
+                    return false;
+                }
+            }
+        }
+    }
+    for (size_t row = min_row; row <= max_row; ++row) {
+        for (size_t col = min_col; col <= max_col; ++col) {
+            cells_[row * cols_ + col].push_back(rect);
+        }
+    }
+    return true;
+}
+
+size_t OccupancyGrid::GetCell(double value, double origin, size_t count) const {
+    const double cell = floor((value - origin) / cell_size_);
+    // Условие записано так, чтобы NaN тоже попадал в первую ячейку
+    if (!(cell > 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(min(cell, static_cast<double>(count - 1)));
+}
+
+} // namespace transport_catalogue::map_renderer
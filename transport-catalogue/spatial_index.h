@@ -0,0 +1,72 @@
+#pragma once
+
+#include "rect.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace transport_catalogue::map_renderer {
+
+/*
+ * Равномерная сетка над областью bounds. Объект регистрируется во всех ячейках,
+ * которые пересекают его прямоугольники. Объекты за пределами bounds
+ * попадают в крайние ячейки, поэтому запрос за пределами области тоже их найдёт
+ */
+class GridIndex {
+public:
+    GridIndex() = default;
+
+    // Объект с номером id занимает прямоугольники items[id]. Размер ячейки подбирается по числу
+    // и среднему размеру прямоугольников, чтобы крупный объект не попадал в слишком много ячеек
+    GridIndex(const Rect& bounds, const std::vector<std::vector<Rect>>& items);
+
+    // Номера объектов, чьи прямоугольники пересекают ячейки запроса, по возрастанию и без повторов.
+    // Результат может содержать объекты рядом с rect, но не пропускает пересекающие его
+    std::vector<uint32_t> Query(const Rect& rect) const;
+
+    // Память, занятая ячейками сетки
+    size_t GetMemoryUsage() const;
+
+private:
+    struct CellRange {
+        size_t min_col;
+        size_t min_row;
+        size_t max_col;
+        size_t max_row;
+    };
+
+    void Insert(const Rect& rect, uint32_t id);
+    CellRange GetCells(const Rect& rect) const;
+    size_t GetCell(double value, double origin, double cell_size) const;
+
+    Rect bounds_;
+    size_t side_ = 1;
+    double cell_width_ = 1;
+    double cell_height_ = 1;
+    std::vector<std::vector<uint32_t>> cells_ = std::vector<std::vector<uint32_t>>(1);
+};
+
+/*
+ * Занятые области изображения для размещения надписей без наложений. Прямоугольник хранится
+ * во всех ячейках, которые он задевает, поэтому проверка смотрит только на соседей по ячейкам.
+ * При размере ячейки порядка высоты надписи проверка и вставка занимают время, пропорциональное длине надписи
+ */
+class OccupancyGrid {
+public:
+    OccupancyGrid(const Rect& bounds, double cell_size);
+
+    // Добавляет rect, если он не пересекает добавленные раньше прямоугольники
+    bool TryInsert(const Rect& rect);
+
+private:
+    size_t GetCell(double value, double origin, size_t count) const;
+
+    Rect bounds_;
+    double cell_size_;
+    size_t cols_;
+    size_t rows_;
+    std::vector<std::vector<Rect>> cells_;
+};
+
+} // namespace transport_catalogue::map_renderer
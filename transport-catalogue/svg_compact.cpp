@@ -0,0 +1,277 @@
+#include "svg_compact.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <exception>
+#include <sstream>
+#include <thread>
+
+namespace svg {
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+// Меньший документ выводится быстрее, чем запускаются потоки
+constexpr size_t MIN_PARALLEL_ELEMENTS = 4096;
+
+// Формат совпадает с выводом double в ostream с точностью по умолчанию
+void AppendNumber(string& out, double value) {
+    array<char, 32> buffer;
+    const auto result = to_chars(buffer.data(), buffer.data() + buffer.size(), value, chars_format::general, 6);
+    out.append(buffer.data(), result.ptr);
+}
+
+void AppendPoint(string& out, Point point, string_view x_name, string_view y_name) {
+    out += ' ';
+    out += x_name;
+    out += "=\""sv;
+    AppendNumber(out, point.x);
+    out += "\" "sv;
+    out += y_name;
+    out += "=\""sv;
+    AppendNumber(out, point.y);
+    out += '"';
+}
+
+void AppendEscaped(string& out, string_view data) {
+    size_t run_begin = 0;
+    for (size_t i = 0; i < data.size(); ++i) {
+        string_view escaped;
+        switch (data[i]) {
+            case '<': escaped = "&lt;"sv; break;
+            case '>': escaped = "&gt;"sv; break;
+            case '"': escaped = "&quot;"sv; break;
+            case '&': escaped = "&amp;"sv; break;
+            case '\'': escaped = "&apos;"sv; break;
+            default: continue;
+        }
+        out.append(data.substr(run_begin, i - run_begin));
+        out += escaped;
+        run_begin = i + 1;
+    }
+    out.append(data.substr(run_begin));
+}
+
+// Атрибуты стиля выводятся редко, поэтому используется тот же ostream-вывод, что и в PathProps
+void RenderPathStyle(ostream& out, const PathStyle& style) {
+    if (style.fill_color) {
+        out << " fill=\""sv << *style.fill_color << "\""sv;
+    }
+
+    if (style.stroke_color) {
+        out << " stroke=\""sv << *style.stroke_color << "\""sv;
+    }
+
+    if (style.stroke_width) {
+        out << " stroke-width=\""sv << *style.stroke_width << "\""sv;
+    }
+
+    if (style.stroke_line_cap) {
+        out << " stroke-linecap=\""sv << *style.stroke_line_cap << "\""sv;
+    }
+
+    if (style.stroke_line_join) {
+        out << " stroke-linejoin=\""sv << *style.stroke_line_join << "\""sv;
+    }
+}
+
+}  // namespace
+
+CompactDocument::StyleId CompactDocument::AddStyle(const PathStyle& style) {
+    ostringstream strm;
+    RenderPathStyle(strm, style);
+    return InternStyle(strm.str());
+}
+
+CompactDocument::StyleId CompactDocument::AddStyle(const TextStyle& style) {
+    ostringstream strm;
+    strm << " font-size=\""sv << style.font_size << "\""sv;
+    if (!style.font_family.empty()) {
+        strm << " font-family=\""sv << style.font_family << "\""sv;
+    }
+    if (!style.font_weight.empty()) {
+        strm << " font-weight=\""sv << style.font_weight << "\""sv;
+    }
+    RenderPathStyle(strm, style.path);
+    return InternStyle(strm.str());
+}
+
+CompactDocument::StyleId CompactDocument::InternStyle(string attrs) {
+    const auto [it, inserted] = style_ids_.emplace(move(attrs), static_cast<StyleId>(styles_.size()));
+    if (inserted) {
+        styles_.push_back(it->first);
+    }
+    return it->second;
+}
+
+void CompactDocument::AddCircle(Point center, double radius, StyleId style) {
+    elements_.push_back({ElementType::CIRCLE, static_cast<uint32_t>(circles_.size())});
+    circles_.push_back({center, radius, style});
+}
+
+void CompactDocument::AddPolyline(const vector<Point>& points, StyleId style) {
+    elements_.push_back({ElementType::POLYLINE, static_cast<uint32_t>(polylines_.size())});
+    polylines_.push_back({static_cast<uint32_t>(points_.size()), static_cast<uint32_t>(points.size()), style});
+    points_.insert(points_.end(), points.begin(), points.end());
+}
+
+void CompactDocument::AddText(Point pos, Point offset, string_view data, StyleId style) {
+    elements_.push_back({ElementType::TEXT, static_cast<uint32_t>(texts_.size())});
+    texts_.push_back({pos, offset, static_cast<uint32_t>(text_data_.size()), static_cast<uint32_t>(data.size()), style});
+    text_data_.append(data);
+}
+
+void CompactDocument::SetViewBox(Point origin, Point size) {
+    view_box_ = ViewBox{origin, size};
+}
+
+void CompactDocument::Render(string& out, unsigned threads) const {
+    RenderHeader(out);
+    RenderElements(0, elements_.size(), threads, out);
+    RenderFooter(out);
+}
+
+void CompactDocument::Clear() {
+    elements_.clear();
+    circles_.clear();
+    polylines_.clear();
+    texts_.clear();
+    points_.clear();
+    text_data_.clear();
+}
+
+void CompactDocument::RenderHeader(string& out) const {
+    out += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+    out += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\""sv;
+    if (view_box_) {
+        out += " viewBox=\""sv;
+        AppendNumber(out, view_box_->origin.x);
+        out += ' ';
+        AppendNumber(out, view_box_->origin.y);
+        out += ' ';
+        AppendNumber(out, view_box_->size.x);
+        out += ' ';
+        AppendNumber(out, view_box_->size.y);
+        out += '"';
+    }
+    out += ">\n"sv;
+}
+
+void CompactDocument::RenderBody(string& out) const {
+    RenderElementRange(0, elements_.size(), out);
+}
+
+void CompactDocument::RenderFooter(string& out) const {
+    out += "</svg>"sv;
+}
+
+void CompactDocument::RenderElements(size_t begin, size_t end, unsigned threads, string& out) const {
+    if (threads <= 1 || end - begin < MIN_PARALLEL_ELEMENTS) {
+        RenderElementRange(begin, end, out);
+        return;
+    }
+
+    // Частей больше, чем потоков: линии маршрутов выводятся дольше надписей,
+    // и свободный поток забирает следующую часть, а не ждёт остальных
+    const size_t count = end - begin;
+    const size_t chunks_count = min<size_t>(size_t{threads} * 8, count);
+    vector<string> chunks(chunks_count);
+    vector<exception_ptr> errors(chunks_count);
+    atomic<size_t> next_chunk{0};
+
+    auto render_chunks = [&]() {
+        for (size_t chunk = next_chunk++; chunk < chunks_count; chunk = next_chunk++) {
+            try {
+                RenderElementRange(begin + count * chunk / chunks_count,
+                                   begin + count * (chunk + 1) / chunks_count, chunks[chunk]);
+            } catch (...) {
+                errors[chunk] = current_exception();
+            }
+        }
+    };
+
+    vector<thread> workers;
+    workers.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(render_chunks);
+    }
+    render_chunks();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+    size_t total_size = out.size();
+    for (const auto& chunk : chunks) {
+        total_size += chunk.size();
+    }
+    out.reserve(total_size);
+    for (const auto& chunk : chunks) {
+        out += chunk;
+    }
+}
+
+void CompactDocument::RenderElementRange(size_t begin, size_t end, string& out) const {
+    for (size_t i = begin; i < end; ++i) {
+        const ElementRef element = elements_[i];
+        out += "  "sv;
+        switch (element.type) {
+            case ElementType::CIRCLE: {
+                const CircleRecord& circle = circles_[element.index];
+                out += "<circle"sv;
+                AppendPoint(out, circle.center, "cx"sv, "cy"sv);
+                out += " r=\""sv;
+                AppendNumber(out, circle.radius);
+                out += '"';
+                out += styles_[circle.style];
+                out += "/>"sv;
+                break;
+            }
+            case ElementType::POLYLINE: {
+                const PolylineRecord& polyline = polylines_[element.index];
+                out += "<polyline points=\""sv;
+                for (uint32_t j = 0; j < polyline.points_count; ++j) {
+                    if (j > 0) {
+                        out += ' ';
+                    }
+                    const Point& point = points_[polyline.points_begin + j];
+                    AppendNumber(out, point.x);
+                    out += ',';
+                    AppendNumber(out, point.y);
+                }
+                out += '"';
+                out += styles_[polyline.style];
+                out += "/>"sv;
+                break;
+            }
+            case ElementType::TEXT: {
+                const TextRecord& text = texts_[element.index];
+                out += "<text"sv;
+                AppendPoint(out, text.pos, "x"sv, "y"sv);
+                AppendPoint(out, text.offset, "dx"sv, "dy"sv);
+                out += styles_[text.style];
+                out += '>';
+                AppendEscaped(out, string_view(text_data_).substr(text.data_begin, text.data_size));
+                out += "</text>"sv;
+                break;
+            }
+        }
+        out += '\n';
+    }
+}
+
+void CompactDocument::Render(ostream& out) const {
+    string text;
+    Render(text);
+    out << text;
+}
+
+}  // namespace svg
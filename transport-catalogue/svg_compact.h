@@ -0,0 +1,128 @@
+#pragma once
+
+#include "svg.h"
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace svg {
+
+/*
+ * Компактное представление SVG-документа, дающее тот же вывод, что и svg::Document.
+ * Элементы хранятся в непрерывных массивах по типам, без отдельного выделения памяти
+ * и виртуального вызова на каждый объект. Атрибуты оформления (цвета, толщина линий,
+ * шрифт) выводятся в текст один раз при добавлении стиля, а элементы ссылаются на стиль
+ * по номеру. Документ выводится напрямую в строку, числа форматируются через to_chars
+ */
+
+// Атрибуты, которые в svg::Document задаются через PathProps
+struct PathStyle {
+    std::optional<Color> fill_color;
+    std::optional<Color> stroke_color;
+    std::optional<double> stroke_width;
+    std::optional<StrokeLineCap> stroke_line_cap;
+    std::optional<StrokeLineJoin> stroke_line_join;
+};
+
+// Атрибуты текста, не зависящие от положения и содержимого надписи
+struct TextStyle {
+    uint32_t font_size = 1;
+    std::string font_family;
+    std::string font_weight;
+    PathStyle path;
+};
+
+class CompactDocument {
+public:
+    using StyleId = uint32_t;
+    // Получатель очередного фрагмента текста документа
+    using TextSink = std::function<void(std::string_view)>;
+
+    // Одинаковые стили получают один и тот же номер
+    StyleId AddStyle(const PathStyle& style);
+    StyleId AddStyle(const TextStyle& style);
+
+    void AddCircle(Point center, double radius, StyleId style);
+    void AddPolyline(const std::vector<Point>& points, StyleId style);
+    void AddText(Point pos, Point offset, std::string_view data, StyleId style);
+
+    // Задаёт атрибут viewBox: видимую область изображения с углом origin и размерами size
+    void SetViewBox(Point origin, Point size);
+
+    // Дописывает svg-представление документа в конец out. При threads > 1 элементы большого документа
+    // выводятся частями в отдельные буферы параллельно и склеиваются в исходном порядке
+    void Render(std::string& out, unsigned threads = 1) const;
+
+    void Render(std::ostream& out) const;
+
+    // Части svg-представления для сборки документа из заранее выведенных фрагментов:
+    // заголовок с тегом <svg>, элементы документа и закрывающий тег
+    void RenderHeader(std::string& out) const;
+    void RenderBody(std::string& out) const;
+    void RenderFooter(std::string& out) const;
+
+    // Удаляет элементы, сохраняя стили и выделенную память
+    void Clear();
+
+private:
+    enum class ElementType : uint8_t {
+        CIRCLE,
+        POLYLINE,
+        TEXT,
+    };
+
+    struct ElementRef {
+        ElementType type;
+        uint32_t index;
+    };
+
+    struct CircleRecord {
+        Point center;
+        double radius;
+        StyleId style;
+    };
+
+    struct PolylineRecord {
+        uint32_t points_begin;
+        uint32_t points_count;
+        StyleId style;
+    };
+
+    struct TextRecord {
+        Point pos;
+        Point offset;
+        uint32_t data_begin;
+        uint32_t data_size;
+        StyleId style;
+    };
+
+    StyleId InternStyle(std::string attrs);
+    void RenderElements(size_t begin, size_t end, unsigned threads, std::string& out) const;
+    void RenderElementRange(size_t begin, size_t end, std::string& out) const;
+
+    struct ViewBox {
+        Point origin;
+        Point size;
+    };
+
+    std::optional<ViewBox> view_box_;
+    // Порядок элементов в документе
+    std::vector<ElementRef> elements_;
+    std::vector<CircleRecord> circles_;
+    std::vector<PolylineRecord> polylines_;
+    std::vector<TextRecord> texts_;
+    std::vector<Point> points_;
+    std::string text_data_;
+
+    // Стиль хранится в виде готового текста атрибутов
+    std::vector<std::string> styles_;
+    std::unordered_map<std::string, StyleId> style_ids_;
+};
+
+}  // namespace svg
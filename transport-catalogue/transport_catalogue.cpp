@@ -10,20 +10,21 @@ using namespace transport_catalogue::geo;
 
 const set<string> TransportCatalogue::empty_buses_ = {};
 
-void TransportCatalogue::AddStop(const string& name, const Coordinates& coords) {
-    stops_.emplace_back(Stop{name, coords});
-    stops_by_name_[name] = &stops_.back();
+void TransportCatalogue::AddStop(string_view name, const Coordinates& coords) {
+    const Stop& stop = stops_.emplace_back(Stop{string(name), coords});
+    stops_by_name_[stop.name] = &stop;
+    ++version_;
 }
 
-void TransportCatalogue::AddRoute(const string& name, const vector<string_view>& stops_names, bool is_circular) {
-    Bus route{name, {}, is_circular};
+void TransportCatalogue::AddRoute(string_view name, const vector<string_view>& stops_names, bool is_circular) {
+    Bus route{string(name), {}, is_circular};
 
     for (const auto& stop_name : stops_names) {
         auto it = stops_by_name_.find(stop_name);
         if (it != stops_by_name_.end()) {
             const Stop* stop = it->second;
             route.stops.push_back(stop);
-            stops_to_buses_[stop].insert(name);
+            stops_to_buses_[stop].insert(route.name);
         }
     }
 
@@ -31,8 +32,9 @@ void TransportCatalogue::AddRoute(const string& name, const vector<string_view>&
         route.stops.insert(route.stops.end(), next(route.stops.rbegin()), route.stops.rend());
     }
 
-    buses_.emplace_back(move(route));
-    buses_by_name_[name] = &buses_.back();
+    const Bus& bus = buses_.emplace_back(move(route));
+    buses_by_name_[bus.name] = &bus;
+    ++version_;
 }
 
 int TransportCatalogue::ComputeRouteDistance(const vector<const Stop*>& stops, size_t size) const {
@@ -124,6 +126,7 @@ optional<set<const Stop*, StopNameComparator>> TransportCatalogue::GetAllStops()
 
 void TransportCatalogue::SetDistance(const Stop* from, const Stop* to, int distance) {
     distances_[{from, to}] = distance;
+    ++version_;
 }
 
 int TransportCatalogue::GetDistance(const Stop* from, const Stop* to) const {
@@ -135,4 +138,40 @@ int TransportCatalogue::GetDistance(const Stop* from, const Stop* to) const {
     return 0;
 }
 
+uint64_t TransportCatalogue::GetVersion() const {
+    return version_;
+}
+
+memory::MemoryUsage TransportCatalogue::GetMemoryUsage() const {
+    memory::MemoryUsage usage;
+
+    size_t stops_bytes = memory::GetDequeBytes(stops_);
+    for (const Stop& stop : stops_) {
+        stops_bytes += memory::GetStringBytes(stop.name);
+    }
+    usage["stops"s] = stops_bytes;
+
+    size_t buses_bytes = memory::GetDequeBytes(buses_);
+    for (const Bus& bus : buses_) {
+        buses_bytes += memory::GetStringBytes(bus.name) + memory::GetVectorBytes(bus.stops);
+    }
+    usage["buses"s] = buses_bytes;
+
+    usage["stops_by_name"s] = memory::GetHashTableBytes(stops_by_name_);
+    usage["buses_by_name"s] = memory::GetHashTableBytes(buses_by_name_);
+
+    // Названия автобусов копируются в множество каждой остановки маршрута
+    size_t stops_to_buses_bytes = memory::GetHashTableBytes(stops_to_buses_);
+    for (const auto& [stop, buses] : stops_to_buses_) {
+        stops_to_buses_bytes += memory::GetTreeBytes(buses);
+        for (const string& name : buses) {
+            stops_to_buses_bytes += memory::GetStringBytes(name);
+        }
+    }
+    usage["stops_to_buses"s] = stops_to_buses_bytes;
+
+    usage["distances"s] = memory::GetHashTableBytes(distances_);
+    return usage;
+}
+
 } // namespace transport_catalogue::database
\ No newline at end of file
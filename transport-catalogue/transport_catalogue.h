@@ -1,7 +1,9 @@
 #pragma once
 #include "domain.h"
 #include "geo.h"
+#include "memory_usage.h"
 
+#include <cstdint>
 #include <deque>
 #include <optional>
 #include <set>
@@ -36,8 +38,8 @@ struct StopNameComparator {
 
 class TransportCatalogue {
 public:
-	void AddStop(const std::string& name, const Coordinates& coords);
-	void AddRoute(const std::string& name, const std::vector<std::string_view>& stops_names, bool is_circular);
+	void AddStop(std::string_view name, const Coordinates& coords);
+	void AddRoute(std::string_view name, const std::vector<std::string_view>& stops_names, bool is_circular);
 
 	std::optional<BusInfo> GetRouteInfo(const std::string_view& name) const;
 	std::optional<const std::set<std::string>*> GetBusesForStop(const std::string_view& name) const;
@@ -46,8 +48,13 @@ public:
 	std::optional<std::set<const Stop*, StopNameComparator>> GetAllStops() const;
 	void SetDistance(const Stop* from, const Stop* to, int distance);
 	int GetDistance(const Stop* from, const Stop* to) const;
+	// Увеличивается при каждом изменении справочника, позволяет проверять актуальность кэшей
+	uint64_t GetVersion() const;
+	// Оценка памяти, занятой контейнерами справочника, вместе с названиями и списками остановок
+	memory::MemoryUsage GetMemoryUsage() const;
 
 private:
+	// Добавленные объекты не перемещаются, не изменяются и не удаляются: их адреса служат ключами индексов и кэшей
 	std::deque<Stop> stops_;
 	std::deque<Bus> buses_;
 	std::unordered_map<std::string_view, const Stop*> stops_by_name_;
@@ -55,6 +62,7 @@ private:
 	std::unordered_map<const Stop*, std::set<std::string>> stops_to_buses_;
 	static const std::set<std::string> empty_buses_;
 	std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopPairHasher> distances_;
+	uint64_t version_ = 0;
 	
 	int ComputeRouteDistance(const std::vector<const Stop*>& stops, size_t size) const;
 };
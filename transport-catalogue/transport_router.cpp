@@ -1,13 +1,320 @@
 #include "domain.h"
+#include "profiling.h"
 #include "transport_router.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+
 using namespace std;
 
 namespace transport_catalogue::routing {
 
 constexpr double KPHtoMPM = 1000.0 / 60.0;
 
-void Router::BuildGraph() {
+namespace {
+
+// Длительности одного маршрута, сложенные в разном порядке, расходятся в последних знаках, а длительности
+// разных маршрутов из целых расстояний — намного сильнее. Маршрут считается кратчайшим с такой точностью
+constexpr double TIME_TOLERANCE = 1e-9;
+
+// Коэффициенты модели времени, подобранные по замерам на синтетических городах от 500 до 7500 вершин графа:
+// время шага внутреннего цикла Флойда–Уоршелла и шага поиска Дейкстры по всему графу (ребро или вершина),
+// предобработка иерархии в таких поисках на корень из числа вершин и запрос к иерархии в долях поиска
+constexpr double ALL_PAIRS_NS_PER_STEP = 2.5;
+constexpr double SEARCH_NS_PER_STEP = 25;
+constexpr double HIERARCHY_BUILD_SEARCHES = 45;
+// Запрос к иерархии почти так же дорог, как поиск: подграф кратчайших маршрутов собирается поиском Дейкстры
+// до найденной длительности, а он обходит большую часть города
+constexpr double HIERARCHY_QUERY_SEARCHES = 0.9;
+
+constexpr string_view ROUTING_ENGINE_NAMES[ROUTING_ENGINES_COUNT] = {
+    "all_pairs"sv,
+    "on_demand"sv,
+    "hierarchy"sv,
+};
+
+using AllPairsRouter = graph::Router<double>;
+using DijkstraRouter = graph::DijkstraRouter<double>;
+using HierarchyRouter = graph::HierarchyRouter<double>;
+
+// Число рёбер поездок автобуса с маршрутом из route_stops остановок
+double GetBusEdgesCount(double route_stops) {
+    return route_stops * (route_stops - 1) / 2;
+}
+
+// Входящие рёбра вершин графа: списки занимают столько же памяти, сколько списки исходящих рёбер графа
+memory::MemoryUsage EstimateIncomingEdgesMemory(const GraphSize& size) {
+    return {{"incoming_edges"s, RouteGraph::EstimateMemoryUsage(size.vertices, size.edges).at("incidence_lists"s)}};
+}
+
+// Число деревьев маршрутов, которые запомнит DijkstraRouter при sources начальных вершинах
+size_t GetCachedTrees(const GraphSize& size, size_t sources, const RoutingOptions& options) {
+    return min(sources, DijkstraRouter::GetMaxCachedTrees(size.vertices, options.memory_budget));
+}
+
+memory::MemoryUsage EstimateEngineMemory(RoutingEngine engine, const GraphSize& size, size_t sources,
+                                         const RoutingOptions& options) {
+    switch (engine) {
+        case RoutingEngine::ALL_PAIRS:
+            return AllPairsRouter::EstimateMemoryUsage(size.vertices);
+        case RoutingEngine::ON_DEMAND: {
+            auto usage = DijkstraRouter::EstimateMemoryUsage(size.vertices, GetCachedTrees(size, sources, options));
+            usage.merge(EstimateIncomingEdgesMemory(size));
+            return usage;
+        }
+        case RoutingEngine::HIERARCHY: {
+            auto usage = HierarchyRouter::EstimateMemoryUsage(size.vertices, size.edges);
+            usage.merge(EstimateIncomingEdgesMemory(size));
+            return usage;
+        }
+        default:
+            return {};
+    }
+}
+
+// Число начальных остановок маршрутов; без сведений о запросах — все остановки
+size_t GetRouteSources(const GraphSize& size, const RoutingLoad& load) {
+    return load.route_sources.value_or(size.vertices / 2);
+}
+
+template <typename RouteInfo>
+optional<RouteData> GetRouteData(optional<RouteInfo> route_info) {
+    if (!route_info) {
+        return nullopt;
+    }
+    return RouteData{route_info->weight, move(route_info->edges)};
+}
+
+// Длительность кратчайшего маршрута из начальной вершины в заданную; nullopt — вершина недостижима
+using Distances = function<optional<double>(graph::VertexId)>;
+
+// Длительности маршрутов из from до вершин не дальше max_time: поиск Дейкстры, остановленный на этой границе.
+// Вершины дальше границы либо не найдены, либо получают длительность больше max_time
+Distances FindDistancesWithin(const RouteGraph& graph, graph::VertexId from, double max_time) {
+    auto distances = make_shared<unordered_map<graph::VertexId, double>>();
+    using QueueItem = pair<double, graph::VertexId>;
+    priority_queue<QueueItem, vector<QueueItem>, greater<>> queue;
+
+    distances->emplace(from, 0.);
+    queue.push({0., from});
+    while (!queue.empty() && queue.top().first <= max_time) {
+        const auto [time, vertex] = queue.top();
+        queue.pop();
+        if (distances->at(vertex) < time) {
+            continue;
+        }
+        for (const graph::EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const RouteEdge& edge = graph.GetEdge(edge_id);
+            const double candidate_time = time + edge.weight;
+            const auto [it, inserted] = distances->emplace(edge.to, candidate_time);
+            if (inserted || candidate_time < it->second) {
+                it->second = candidate_time;
+                queue.push({candidate_time, edge.to});
+            }
+        }
+    }
+    return [distances](graph::VertexId vertex) -> optional<double> {
+        if (const auto it = distances->find(vertex); it != distances->end()) {
+            return it->second;
+        }
+        return nullopt;
+    };
+}
+
+// Маршрут из from в to, который выбрала бы матрица всех пар всего графа. Ребро (a, b) лежит на кратчайшем
+// маршруте, если длительность до a вместе с ребром равна длительности до b, а из b по таким рёбрам достижима to.
+// Маршруты через другие рёбра длиннее, поэтому на выбор и сумму матрицы всех пар они не влияют: graph::Router
+// на подграфе из кратчайших маршрутов, с вершинами и рёбрами в прежнем порядке номеров, выбирает тот же маршрут
+// и складывает те же длительности в том же порядке. Время — куб числа вершин подграфа, обычно это единицы вершин
+optional<RouteData> FindAllPairsRoute(const RouteGraph& graph, const vector<vector<graph::EdgeId>>& incoming_edges,
+                                      graph::VertexId from, graph::VertexId to, const Distances& distances) {
+    if (from == to) {
+        return RouteData{0, {}};
+    }
+    const optional<double> total_time = distances(to);
+    if (!total_time) {
+        return nullopt;
+    }
+    const double tolerance = *total_time * TIME_TOLERANCE;
+
+    // Обход от to назад по рёбрам кратчайших маршрутов
+    unordered_map<graph::VertexId, graph::VertexId> local_ids{{to, 0}};
+    vector<graph::VertexId> vertices{to};
+    vector<graph::EdgeId> edges;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const double time = *distances(vertices[i]);
+        for (const graph::EdgeId edge_id : incoming_edges[vertices[i]]) {
+            const RouteEdge& edge = graph.GetEdge(edge_id);
+            const optional<double> from_time = distances(edge.from);
+            if (!from_time || *from_time + edge.weight > time + tolerance) {
+                continue;
+            }
+            edges.push_back(edge_id);
+            if (local_ids.emplace(edge.from, 0).second) {
+                vertices.push_back(edge.from);
+            }
+        }
+    }
+
+    sort(vertices.begin(), vertices.end());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        local_ids[vertices[i]] = i;
+    }
+    sort(edges.begin(), edges.end());
+    RouteGraph shortest(vertices.size());
+    for (const graph::EdgeId edge_id : edges) {
+        const RouteEdge& edge = graph.GetEdge(edge_id);
+        shortest.AddEdge({{}, edge.span_count, local_ids.at(edge.from), local_ids.at(edge.to), edge.weight});
+    }
+
+    auto route = GetRouteData(graph::Router<double>(shortest).BuildRoute(local_ids.at(from), local_ids.at(to)));
+    if (route) {
+        for (auto& edge_id : route->edges) {
+            edge_id = edges[edge_id];
+        }
+    }
+    return route;
+}
+
+}  // namespace
+
+NetworkSize GetNetworkSize(const TransportCatalogue& catalogue) {
+    NetworkSize size;
+    if (const auto stops = catalogue.GetAllStops()) {
+        size.stops = stops->size();
+    }
+    const auto buses = catalogue.GetAllBuses();
+    if (!buses || buses->empty()) {
+        return size;
+    }
+    size.buses = buses->size();
+    double edges_count = 0;
+    for (const auto* bus : *buses) {
+        edges_count += GetBusEdgesCount(static_cast<double>(bus->stops.size()));
+    }
+    // Корень уравнения n * (n - 1) / 2 = edges_count / buses
+    size.route_stops = (1 + sqrt(1 + 8 * edges_count / static_cast<double>(size.buses))) / 2;
+    return size;
+}
+
+GraphSize GetGraphSize(const NetworkSize& size) {
+    // Без маршрутов граф не строится
+    if (size.buses == 0 || size.stops == 0) {
+        return {};
+    }
+    return {size.stops * 2, size.stops
+        + static_cast<size_t>(llround(static_cast<double>(size.buses) * GetBusEdgesCount(size.route_stops)))};
+}
+
+string_view GetRoutingEngineName(RoutingEngine engine) {
+    return ROUTING_ENGINE_NAMES[static_cast<size_t>(engine)];
+}
+
+optional<RoutingEngine> FindRoutingEngine(string_view name) {
+    for (size_t i = 0; i < ROUTING_ENGINES_COUNT; ++i) {
+        if (ROUTING_ENGINE_NAMES[i] == name) {
+            return static_cast<RoutingEngine>(i);
+        }
+    }
+    return nullopt;
+}
+
+RoutingPlan PlanRouting(const GraphSize& size, const RoutingLoad& load, const RoutingOptions& options) {
+    const auto vertices = static_cast<double>(size.vertices);
+    const auto edges = static_cast<double>(size.edges);
+    const double requests = static_cast<double>(load.route_requests.value_or(0));
+    const size_t sources = GetRouteSources(size, load);
+    const double search_ms = SEARCH_NS_PER_STEP * (edges + vertices * log2(max(vertices, 2.0))) / 1e6;
+
+    RoutingPlan plan;
+    for (size_t i = 0; i < ROUTING_ENGINES_COUNT; ++i) {
+        plan.estimates[i].memory = memory::GetTotal(
+            EstimateEngineMemory(static_cast<RoutingEngine>(i), size, sources, options));
+    }
+    plan.estimates[static_cast<size_t>(RoutingEngine::ALL_PAIRS)].time_ms
+        = ALL_PAIRS_NS_PER_STEP * vertices * vertices * vertices / 1e6;
+    // Если деревья всех начальных вершин не помещаются в кэш, поиск может понадобиться на каждый запрос
+    const bool trees_fit = GetCachedTrees(size, sources, options) == sources;
+    plan.estimates[static_cast<size_t>(RoutingEngine::ON_DEMAND)].time_ms
+        = (trees_fit ? static_cast<double>(sources) : requests) * search_ms;
+    plan.estimates[static_cast<size_t>(RoutingEngine::HIERARCHY)].time_ms
+        = (HIERARCHY_BUILD_SEARCHES * sqrt(vertices) + requests * HIERARCHY_QUERY_SEARCHES) * search_ms;
+
+    if (options.engine) {
+        plan.engine = *options.engine;
+        return plan;
+    }
+    size_t smallest = 0;
+    for (size_t i = 0; i < ROUTING_ENGINES_COUNT; ++i) {
+        if (plan.estimates[i].memory < plan.estimates[smallest].memory) {
+            smallest = i;
+        }
+    }
+    if (!load.route_requests) {
+        // Без сведений о запросах время ответов не оценить, и выбор делается по памяти. Если в бюджет помещаются
+        // деревья маршрутов из всех остановок, поиск по запросу строит каждое не больше одного раза —
+        // это матрица всех пар, заполняемая по мере запросов без кубической предобработки.
+        // Иначе выбирается иерархия, скорость ответов которой не зависит от кэша
+        const auto& hierarchy = plan.estimates[static_cast<size_t>(RoutingEngine::HIERARCHY)];
+        if (trees_fit) {
+            plan.engine = RoutingEngine::ON_DEMAND;
+        } else if (hierarchy.memory <= options.memory_budget) {
+            plan.engine = RoutingEngine::HIERARCHY;
+        } else {
+            plan.engine = static_cast<RoutingEngine>(smallest);
+        }
+        return plan;
+    }
+    optional<size_t> fastest;
+    for (size_t i = 0; i < ROUTING_ENGINES_COUNT; ++i) {
+        const EngineEstimate& estimate = plan.estimates[i];
+        if (estimate.memory <= options.memory_budget
+            && (!fastest || estimate.time_ms < plan.estimates[*fastest].time_ms)) {
+            fastest = i;
+        }
+    }
+    plan.engine = static_cast<RoutingEngine>(fastest.value_or(smallest));
+    return plan;
+}
+
+void PrintRoutingPlan(ostream& out, const RoutingPlan& plan) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << fixed << setprecision(3);
+    out << "routing engine: "sv << GetRoutingEngineName(plan.engine) << '\n';
+    for (size_t i = 0; i < ROUTING_ENGINES_COUNT; ++i) {
+        out << "routing estimate "sv << ROUTING_ENGINE_NAMES[i] << ": "sv << plan.estimates[i].time_ms << " ms, "sv
+            << plan.estimates[i].memory << " bytes\n"sv;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+memory::MemoryUsage EstimateRouterMemory(const NetworkSize& size, const RoutingLoad& load,
+                                         const RoutingOptions& options) {
+    const GraphSize graph_size = GetGraphSize(size);
+    if (graph_size.vertices == 0) {
+        return {};
+    }
+    const RoutingEngine engine = PlanRouting(graph_size, load, options).engine;
+
+    memory::MemoryUsage usage;
+    memory::AddUsage(usage, "graph"sv, RouteGraph::EstimateMemoryUsage(graph_size.vertices, graph_size.edges));
+    memory::AddUsage(usage, GetRoutingEngineName(engine),
+                     EstimateEngineMemory(engine, graph_size, GetRouteSources(graph_size, load), options));
+    usage["stop_ids"s] = size.stops * (sizeof(pair<const string, graph::VertexId>) + memory::TREE_NODE_OVERHEAD);
+    usage["stops"s] = memory::GetGrowthCapacity(size.stops) * sizeof(const Stop*);
+    usage["buses"s] = size.buses * (sizeof(pair<const string_view, const Bus*>) + memory::TREE_NODE_OVERHEAD);
+    return usage;
+}
+
+void Router::BuildGraph(const RoutingLoad& load, const RoutingOptions& options) {
+    profiling::PhaseTimer timer(profiling::Phase::ROUTER_BUILD);
     auto all_buses = catalogue_.GetAllBuses();
     if (!all_buses.has_value()) {
         return;
@@ -20,12 +327,19 @@ void Router::BuildGraph() {
 
     const set<const Bus*, BusNameComparator>& buses = all_buses.value();
     const set<const Stop*, StopNameComparator>& stops = all_stops.value();
-    graph::DirectedWeightedGraph<double> graph(stops.size() * 2);
+    size_t edge_count = stops.size();
+    for (const auto* bus : buses) {
+        edge_count += bus->stops.size() * (bus->stops.size() - 1) / 2;
+    }
+    plan_ = PlanRouting({stops.size() * 2, edge_count}, load, options);
+
+    RouteGraph graph(stops.size() * 2);
     map<string, graph::VertexId> stop_ids;
     graph::VertexId vertex_id = 0;
 
     for (const auto* stop : stops) {
         stop_ids[stop->name] = vertex_id;
+        stops_.push_back(stop);
         graph.AddEdge({
                 stop->name,
                 0,
@@ -36,14 +350,35 @@ void Router::BuildGraph() {
         ++vertex_id;
     }
     stop_ids_ = move(stop_ids);
+    for (const auto* bus : buses) {
+        buses_[bus->name] = bus;
+    }
 
     BuildEdgesForBuses(buses, graph);
 
     graph_ = move(graph);
-    router_ = make_unique<graph::Router<double>>(graph_);
+    if (plan_.engine != RoutingEngine::ALL_PAIRS) {
+        incoming_edges_.resize(graph_.GetVertexCount());
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            incoming_edges_[graph_.GetEdge(edge_id).to].push_back(edge_id);
+        }
+    }
+    switch (plan_.engine) {
+        case RoutingEngine::ALL_PAIRS:
+            router_ = make_unique<AllPairsRouter>(graph_);
+            break;
+        case RoutingEngine::ON_DEMAND:
+            dijkstra_router_ = make_unique<DijkstraRouter>(graph_, options.memory_budget);
+            break;
+        case RoutingEngine::HIERARCHY:
+            hierarchy_router_ = make_unique<HierarchyRouter>(graph_);
+            break;
+        default:
+            break;
+    }
 }
 
-void Router::BuildEdgesForBuses(const set<const Bus*, BusNameComparator>& buses, graph::DirectedWeightedGraph<double>& graph) const {
+void Router::BuildEdgesForBuses(const set<const Bus*, BusNameComparator>& buses, RouteGraph& graph) const {
     for (const auto* bus : buses) {
         const auto& stops = bus->stops;
         size_t stops_count = stops.size();
@@ -70,7 +405,6 @@ void Router::BuildEdgesForBuses(const set<const Bus*, BusNameComparator>& buses,
 }
 
 const optional<RouteData> Router::FindRoute(const string_view stop_from, const string_view stop_to) const {
-    RouteData route_data;
     auto from_it = stop_ids_.find(string(stop_from));
     auto to_it = stop_ids_.find(string(stop_to));
 
@@ -80,18 +414,98 @@ const optional<RouteData> Router::FindRoute(const string_view stop_from, const s
 
     graph::VertexId from_id = from_it->second;
     graph::VertexId to_id = to_it->second;
-    const auto& route_info = router_->BuildRoute(from_id, to_id);
+    if (router_) {
+        return GetRouteData(router_->BuildRoute(from_id, to_id));
+    }
+    return BuildRoute(from_id, to_id);
+}
 
-    if (!route_info.has_value()) {
-        return nullopt;
+optional<RouteData> Router::BuildRoute(graph::VertexId from, graph::VertexId to) const {
+    if (dijkstra_router_) {
+        return FindAllPairsRoute(graph_, incoming_edges_, from, to, dijkstra_router_->GetDistances(from));
     }
+    if (hierarchy_router_) {
+        const auto route = hierarchy_router_->BuildRoute(from, to);
+        if (!route) {
+            return nullopt;
+        }
+        const double max_time = route->weight * (1 + TIME_TOLERANCE);
+        return FindAllPairsRoute(graph_, incoming_edges_, from, to, FindDistancesWithin(graph_, from, max_time));
+    }
+    return nullopt;
+}
+
+const RouteEdge& Router::GetEdge(graph::EdgeId edge_id) const {
+    return graph_.GetEdge(edge_id);
+}
 
-    route_data.total_time = route_info->weight;
-    for (const auto& edge_id : route_info->edges) {
-        route_data.edges.push_back(&graph_.GetEdge(edge_id));
+vector<RouteLeg> Router::GetRouteLegs(const RouteData& route) const {
+    vector<RouteLeg> legs;
+    for (const auto edge_id : route.edges) {
+        const RouteEdge* edge = &graph_.GetEdge(edge_id);
+        // Ребро ожидания ведёт из вершины 2 * i в 2 * i + 1, ребро поездки — из 2 * i + 1 в 2 * j
+        const Stop* stop_from = stops_[edge->from / 2];
+        if (edge->span_count == 0) {
+            legs.push_back({nullptr, {stop_from}});
+            continue;
+        }
+
+        const Stop* stop_to = stops_[edge->to / 2];
+        const Bus* bus = buses_.at(edge->name);
+        RouteLeg& leg = legs.emplace_back(RouteLeg{bus, {}});
+        // Автобус может проезжать остановку несколько раз, подходит любой участок с нужными концами и числом пролётов
+        const auto& stops = bus->stops;
+        for (size_t i = 0; i + edge->span_count < stops.size(); ++i) {
+            if (stops[i] == stop_from && stops[i + edge->span_count] == stop_to) {
+                leg.stops.assign(stops.begin() + i, stops.begin() + i + edge->span_count + 1);
+                break;
+            }
+        }
+    }
+    return legs;
+}
+
+memory::MemoryUsage Router::GetMemoryUsage() const {
+    memory::MemoryUsage usage;
+    memory::AddUsage(usage, "graph"sv, graph_.GetMemoryUsage());
+    const string_view engine = GetRoutingEngineName(plan_.engine);
+    if (router_) {
+        memory::AddUsage(usage, engine, router_->GetMemoryUsage());
+    } else {
+        memory::MemoryUsage engine_usage;
+        if (dijkstra_router_) {
+            engine_usage = dijkstra_router_->GetMemoryUsage();
+        } else if (hierarchy_router_) {
+            engine_usage = hierarchy_router_->GetMemoryUsage();
+        }
+        size_t incoming_edges_bytes = memory::GetVectorBytes(incoming_edges_);
+        for (const auto& edges : incoming_edges_) {
+            incoming_edges_bytes += memory::GetVectorBytes(edges);
+        }
+        engine_usage["incoming_edges"s] = incoming_edges_bytes;
+        memory::AddUsage(usage, engine, engine_usage);
     }
 
-    return route_data;
+    size_t stop_ids_bytes = memory::GetTreeBytes(stop_ids_);
+    for (const auto& [name, id] : stop_ids_) {
+        stop_ids_bytes += memory::GetStringBytes(name);
+    }
+    usage["stop_ids"s] = stop_ids_bytes;
+    usage["stops"s] = memory::GetVectorBytes(stops_);
+    usage["buses"s] = memory::GetTreeBytes(buses_);
+    return usage;
+}
+
+const RoutingPlan& Router::GetPlan() const {
+    return plan_;
+}
+
+const RoutingSettings& Router::GetSettings() const {
+    return settings_;
+}
+
+uint64_t Router::GetCatalogueVersion() const {
+    return catalogue_version_;
 }
 
 } // namespace transport_catalogue::routing
\ No newline at end of file
@@ -1,46 +1,186 @@
 #pragma once
 
+#include "dijkstra_router.h"
+#include "hierarchy_router.h"
+#include "memory_usage.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
+#include <array>
+#include <cstdint>
+#include <iostream>
 #include <map>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace transport_catalogue::routing {
 
 using namespace transport_catalogue::database;
 
+// Вес ребра — длительность в минутах
+using RouteGraph = graph::DirectedWeightedGraph<double>;
+using RouteEdge = graph::Edge<double>;
+
+/*
+ * Маршрут, который выбирает матрица всех пар graph::Router, при любом способе поиска. Из маршрутов равной
+ * длительности она оставляет найденный первым, а длительности складывает в порядке своих слияний путей, поэтому
+ * ответ зависит не только от длительности. Поиск по запросу и иерархия находят длительность кратчайшего маршрута
+ * и собирают подграф из всех кратчайших маршрутов, а затем запускают на нём graph::Router с теми же порядками
+ * вершин и рёбер. Он выбирает тот же маршрут и складывает те же слагаемые в том же порядке
+ */
 struct RouteData {
+	// Сумма длительностей рёбер в порядке сложения матрицы всех пар
 	double total_time;
-	std::vector<const graph::Edge<double>*> edges;
+	// Номера рёбер в графе маршрутизатора, см. Router::GetEdge. Граф строится детерминированно,
+	// поэтому номера одинаковы у всех маршрутизаторов одной версии справочника с одними настройками
+	std::vector<graph::EdgeId> edges;
 };
 
 struct RoutingSettings {
 	int bus_wait_time;
 	double bus_velocity;
+
+	bool operator==(const RoutingSettings& other) const {
+		return bus_wait_time == other.bus_wait_time && bus_velocity == other.bus_velocity;
+	}
+
+	bool operator!=(const RoutingSettings& other) const {
+		return !(*this == other);
+	}
+};
+
+// Размер транспортной сети, по которому оценивается память маршрутизатора до его построения
+struct NetworkSize {
+	// Остановки, через которые проходит хотя бы один маршрут
+	size_t stops = 0;
+	size_t buses = 0;
+	// Число остановок в маршруте автобуса, у некольцевого — вместе с обратным направлением.
+	// Автобус даёт ребро для каждой пары остановок маршрута, поэтому для сети с маршрутами разной длины
+	// берётся длина, дающая то же среднее число рёбер
+	double route_stops = 15;
+};
+
+NetworkSize GetNetworkSize(const TransportCatalogue& catalogue);
+
+struct GraphSize {
+	size_t vertices = 0;
+	size_t edges = 0;
+};
+
+GraphSize GetGraphSize(const NetworkSize& size);
+
+// Способы поиска маршрутов
+enum class RoutingEngine : uint8_t {
+	// Матрица маршрутов между всеми парами вершин, graph::Router: время построения кубическое, память квадратичная
+	ALL_PAIRS,
+	// Поиски Дейкстры по запросу с запоминанием деревьев маршрутов, graph::DijkstraRouter
+	ON_DEMAND,
+	// Иерархия сокращений, graph::HierarchyRouter: предобработка и быстрые двусторонние поиски длительности.
+	// Подграф кратчайших маршрутов собирается поиском Дейкстры, остановленным на найденной длительности
+	HIERARCHY,
+	COUNT,
+};
+
+inline constexpr size_t ROUTING_ENGINES_COUNT = static_cast<size_t>(RoutingEngine::COUNT);
+
+std::string_view GetRoutingEngineName(RoutingEngine engine);
+std::optional<RoutingEngine> FindRoutingEngine(std::string_view name);
+
+inline const size_t DEFAULT_ROUTER_MEMORY_BUDGET = size_t{1} << 30;
+
+struct RoutingOptions {
+	// Память, которую может занять способ поиска, не считая графа
+	size_t memory_budget = DEFAULT_ROUTER_MEMORY_BUDGET;
+	// Способ поиска, заданный явно вместо выбранного планировщиком
+	std::optional<RoutingEngine> engine;
 };
 
+// Ожидаемые запросы к маршрутизатору. Если они неизвестны, как в режиме сервера,
+// начальной может оказаться любая остановка
+struct RoutingLoad {
+	// Число запросов Route и RouteMap
+	std::optional<size_t> route_requests;
+	// Число различных начальных остановок в них
+	std::optional<size_t> route_sources;
+};
+
+struct EngineEstimate {
+	// Ожидаемое время построения и ответов на все запросы. Если запросы неизвестны — время построения,
+	// а для поиска по запросу — время построения деревьев маршрутов из всех остановок
+	double time_ms = 0;
+	// Память без учёта графа
+	size_t memory = 0;
+};
+
+struct RoutingPlan {
+	RoutingEngine engine = RoutingEngine::ALL_PAIRS;
+	std::array<EngineEstimate, ROUTING_ENGINES_COUNT> estimates{};
+};
+
+// Выбирает самый быстрый способ поиска из помещающихся в memory_budget, если ни один не помещается —
+// самый экономный по памяти. Если запросы неизвестны, выбирает по памяти: поиск по запросу, когда в бюджет
+// помещаются деревья маршрутов из всех остановок, иначе иерархию, если она помещается.
+// Способ, заданный в options, выбирается всегда
+RoutingPlan PlanRouting(const GraphSize& size, const RoutingLoad& load, const RoutingOptions& options);
+
+// Выводит выбранный способ поиска и оценки всех способов по строке на способ
+void PrintRoutingPlan(std::ostream& out, const RoutingPlan& plan);
+
+// Оценка памяти Router для сети размера size с теми же названиями записей, что и в Router::GetMemoryUsage.
+// Способ поиска выбирается так же, как при построении
+memory::MemoryUsage EstimateRouterMemory(const NetworkSize& size, const RoutingLoad& load = {},
+                                         const RoutingOptions& options = {});
+
 class Router {
 public:
-	Router(const RoutingSettings& settings, const TransportCatalogue& catalogue)
-    : settings_(settings), catalogue_(catalogue) {
-		BuildGraph();
+	Router(const RoutingSettings& settings, const TransportCatalogue& catalogue, const RoutingLoad& load = {},
+	       const RoutingOptions& options = {})
+    : settings_(settings), catalogue_(catalogue), catalogue_version_(catalogue.GetVersion()) {
+		BuildGraph(load, options);
 	}
 
 	const std::optional<RouteData> FindRoute(const std::string_view stop_from, const std::string_view stop_to) const;
 
+	const RouteEdge& GetEdge(graph::EdgeId edge_id) const;
+
+	// Участки маршрута route с остановками, через которые проходят поездки, для отображения на карте
+	std::vector<RouteLeg> GetRouteLegs(const RouteData& route) const;
+
+	const RoutingSettings& GetSettings() const;
+
+	// Версия справочника, по которой построен граф
+	uint64_t GetCatalogueVersion() const;
+
+	memory::MemoryUsage GetMemoryUsage() const;
+
+	// Выбранный способ поиска и оценки, по которым он выбран
+	const RoutingPlan& GetPlan() const;
+
 private:
 	const RoutingSettings settings_;
 	const TransportCatalogue& catalogue_;
-	graph::DirectedWeightedGraph<double> graph_;
+	const uint64_t catalogue_version_;
+	RouteGraph graph_;
+	RoutingPlan plan_;
+	// Создаётся только маршрутизатор выбранного способа
 	std::unique_ptr<graph::Router<double>> router_;
-	
+	std::unique_ptr<graph::DijkstraRouter<double>> dijkstra_router_;
+	std::unique_ptr<graph::HierarchyRouter<double>> hierarchy_router_;
+
 	std::map<std::string, graph::VertexId> stop_ids_;
-	void BuildGraph();
-	void BuildEdgesForBuses(const std::set<const Bus*, BusNameComparator>& buses, graph::DirectedWeightedGraph<double>& graph) const;
+	// Остановка с номером вершины ожидания 2 * i находится в stops_[i]
+	std::vector<const Stop*> stops_;
+	std::map<std::string_view, const Bus*> buses_;
+	// Входящие рёбра вершин для сбора подграфа кратчайших маршрутов; у матрицы всех пар не заполняются
+	std::vector<std::vector<graph::EdgeId>> incoming_edges_;
+
+	void BuildGraph(const RoutingLoad& load, const RoutingOptions& options);
+	void BuildEdgesForBuses(const std::set<const Bus*, BusNameComparator>& buses, RouteGraph& graph) const;
+	// Маршрут, найденный поиском по запросу или по иерархии, в том виде, в каком его выдала бы матрица всех пар
+	std::optional<RouteData> BuildRoute(graph::VertexId from, graph::VertexId to) const;
 };
 
 } // namespace transport_catalogue::routing
\ No newline at end of file